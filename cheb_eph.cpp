@@ -0,0 +1,392 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/* Chebyshev ephemerides for a single TLE.  If you need a satellite's
+position at millions of times over a span of a few days or weeks,
+running SGP4 or SDP4 each time is wasteful (particularly with SDP4's
+deep-space terms).  cheby_ephem_compile( ) samples the model over the
+span and fits each coordinate with Chebyshev polynomials,  in segments
+of equal length,  choosing that length so that the fitted positions
+match the model to a given tolerance.  cheby_ephem_eval( ) then costs a
+few dozen multiply-adds.  Velocities come from the derivative of the
+fitted positions,  so they're consistent with them.
+
+The result can be saved to a file and reloaded.  The file is in the
+native byte order;  it's a 48-byte header (see below),  followed by the
+position coefficients:  for each segment,  n_coeffs coefficients for x,
+then y,  then z.  Positions are in km,  velocities in km/minute,  and
+times in minutes from the TLE epoch,  just as for SGP4( ) and SDP4( ).
+The derivative coefficients used for velocity aren't stored in the
+file;  they're recomputed on loading.  Note that SGP4's and SDP4's own
+velocities aren't quite the derivatives of their positions;  for highly
+eccentric deep-space orbits,  the difference can be tens of m/s.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "norad.h"
+#include "norad_in.h"
+
+#define N_CHEBY_COEFFS        12
+#define CHEBY_EPHEM_MAGIC     "SxPxChb1"
+
+typedef struct
+{
+   char magic[8];
+   int norad_number, n_coeffs, n_segments, unused;
+   double epoch, tsince_start, segment_len;
+} cheby_header_t;
+
+            /* 'coeffs' are as stored in the file.  For evaluation,  */
+            /* 'terms' holds,  for each segment and each order,  the  */
+            /* x, y, z position coefficients and their derivatives,   */
+            /* so the six series can be summed side by side.          */
+typedef struct
+{
+   cheby_header_t hdr;
+   double *coeffs, *terms;
+} cheby_ephem_t;
+
+/* Given values of a function at the N Chebyshev nodes
+x[k] = cos( pi * (k + .5) / N),  computes the coefficients of the
+interpolating Chebyshev series,  with the usual halving of the
+zeroth coefficient folded in.  Used here and in 'lun_sol.cpp'.  */
+
+void cheby_fit( const double *fvals, double *coeffs, const int n)
+{
+   int i, j;
+
+   for( j = 0; j < n; j++)
+      {
+      double sum = 0.;
+
+      for( i = 0; i < n; i++)
+         sum += fvals[i] * cos( pi * (double)j * ((double)i + .5) / (double)n);
+      coeffs[j] = sum * (j ? 2. : 1.) / (double)n;
+      }
+}
+
+/* Computes the coefficients of the derivative (with respect to x) of a
+Chebyshev series.  The last coefficient is always zero.  */
+
+static void cheby_deriv( const double *coeffs, double *dcoeffs, const int n)
+{
+   int i;
+
+   dcoeffs[n - 1] = 0.;
+   if( n > 1)
+      dcoeffs[n - 2] = 2. * (double)( n - 1) * coeffs[n - 1];
+   for( i = n - 3; i >= 0; i--)
+      dcoeffs[i] = dcoeffs[i + 2] + 2. * (double)( i + 1) * coeffs[i + 1];
+   dcoeffs[0] /= 2.;
+}
+
+static cheby_ephem_t *alloc_cheby_ephem( const cheby_header_t *hdr)
+{
+   const size_t n_doubles = (size_t)hdr->n_segments * 3 * hdr->n_coeffs;
+   cheby_ephem_t *rval = (cheby_ephem_t *)malloc( sizeof( cheby_ephem_t)
+                        + 3 * n_doubles * sizeof( double));
+
+   if( rval)
+      {
+      rval->hdr = *hdr;
+      rval->coeffs = (double *)( rval + 1);
+      rval->terms = rval->coeffs + n_doubles;
+      }
+   return( rval);
+}
+
+static void set_up_terms( cheby_ephem_t *ephem)
+{
+   const int n = ephem->hdr.n_coeffs;
+   int seg, i, j;
+
+   for( seg = 0; seg < ephem->hdr.n_segments; seg++)
+      {
+      const double *coeffs = ephem->coeffs + seg * 3 * n;
+      double *terms = ephem->terms + seg * 6 * n;
+      double dcoeffs[100];
+
+      for( j = 0; j < 3; j++)
+         {
+         cheby_deriv( coeffs + j * n, dcoeffs, n);
+         for( i = 0; i < n; i++)
+            {
+            terms[i * 6 + j] = coeffs[j * n + i];
+            terms[i * 6 + j + 3] = dcoeffs[i];
+            }
+         }
+      }
+}
+
+/* Fits each segment,  then checks the fit at CHECKS_PER_SEGMENT points
+evenly spread through it.  Returns the largest error found (in km),  or
+a negative value if the model failed.  The fit is abandoned as soon as
+the error exceeds 'tolerance'.  */
+
+#define CHECKS_PER_SEGMENT    (2 * N_CHEBY_COEFFS)
+#define N_SAMPLES             (N_CHEBY_COEFFS + CHECKS_PER_SEGMENT + 1)
+
+static double fit_segments( cheby_ephem_t *ephem, const tle_t *tle,
+               double *params, const int is_deep, const double tolerance)
+{
+   const cheby_header_t *hdr = &ephem->hdr;
+   double max_err = 0.;
+   int seg, i, j;
+
+   for( seg = 0; seg < hdr->n_segments && max_err <= tolerance; seg++)
+      {
+      const double t0 = hdr->tsince_start + (double)seg * hdr->segment_len;
+      double tsince[N_SAMPLES], pos[N_SAMPLES * 3], fvals[N_CHEBY_COEFFS];
+      double *coeffs = ephem->coeffs + seg * 3 * N_CHEBY_COEFFS;
+      int rvals[N_SAMPLES];
+
+                  /* Chebyshev nodes run from +1 down to -1;  keep the */
+                  /* times in increasing order for the sake of SDP4.   */
+      for( i = 0; i < N_CHEBY_COEFFS; i++)
+         tsince[i] = t0 + hdr->segment_len * .5 *
+               (1. - cos( pi * ((double)i + .5) / (double)N_CHEBY_COEFFS));
+      for( i = 0; i <= CHECKS_PER_SEGMENT; i++)
+         tsince[i + N_CHEBY_COEFFS] = t0 + hdr->segment_len
+                        * (double)i / (double)CHECKS_PER_SEGMENT;
+      if( is_deep)
+         SDP4_ephemeris( tsince, N_SAMPLES, tle, params, pos, NULL, rvals);
+      else
+         SGP4_ephemeris( tsince, N_SAMPLES, tle, params, pos, NULL, rvals);
+      for( i = 0; i < N_SAMPLES; i++)
+         if( rvals[i] && rvals[i] != SXPX_WARN_ORBIT_WITHIN_EARTH
+                      && rvals[i] != SXPX_WARN_PERIGEE_WITHIN_EARTH)
+            return( -1.);
+      for( j = 0; j < 3; j++)
+         {
+         for( i = 0; i < N_CHEBY_COEFFS; i++)
+            fvals[N_CHEBY_COEFFS - 1 - i] = pos[i * 3 + j];
+         cheby_fit( fvals, coeffs + j * N_CHEBY_COEFFS, N_CHEBY_COEFFS);
+         }
+      for( i = 0; i <= CHECKS_PER_SEGMENT; i++)
+         {
+         const double x = 2. * (double)i / (double)CHECKS_PER_SEGMENT - 1.;
+         const double *actual = pos + (i + N_CHEBY_COEFFS) * 3;
+         double err2 = 0.;
+
+         for( j = 0; j < 3; j++)
+            {
+            const double delta = actual[j] - cheby_eval(
+                     coeffs + j * N_CHEBY_COEFFS, N_CHEBY_COEFFS, x);
+
+            err2 += delta * delta;
+            }
+         if( max_err < sqrt( err2))
+            max_err = sqrt( err2);
+         }
+      }
+   return( max_err);
+}
+
+/* Starting with segments half an orbit long,  we shrink them until the
+fit is within 'tolerance' everywhere,  or lengthen them as long as it
+stays so.  Returns NULL if the span is empty or the model fails
+(decays,  etc.) anywhere within it.  SGP4 is used for near-earth TLEs
+and SDP4 (Dundee-compliant) for deep-space ones,  as select_ephemeris( )
+says.   */
+
+void * DLL_FUNC cheby_ephem_compile( const tle_t *tle,
+                  const double tsince_start, const double tsince_end,
+                  const double tolerance)
+{
+   const double span = tsince_end - tsince_start;
+   const int is_deep = select_ephemeris( tle);
+   const double period = twopi / tle->xno;
+   double params[N_SAT_PARAMS];
+   cheby_header_t hdr;
+   cheby_ephem_t *rval = NULL, *trial;
+   int n_segments, passed_first_try = -1;
+
+   if( span <= 0. || is_deep < 0)
+      return( NULL);
+   if( !is_deep)
+      SGP4_init( params, tle);
+   else
+      {
+      sxpx_config_t config;
+
+            /* By default,  SDP4 only recomputes the lunisolar terms if */
+            /* the time has changed by 30 minutes or more,  so its      */
+            /* output has small jumps that no smooth fit can follow.    */
+            /* The Dundee-compliant code always recomputes them.        */
+      sxpx_get_default_config( &config);
+      config.is_dundee_compliant = 1;
+      SDP4_init_with_config( params, tle, &config);
+            /* Checkpoints make SDP4's results for resonant orbits */
+            /* independent of the order in which times are given.  */
+      if( tle->ephemeris_type != 'H')
+         sxpx_init_checkpoints( params, tsince_start, tsince_end);
+      }
+   memset( &hdr, 0, sizeof( hdr));
+   memcpy( hdr.magic, CHEBY_EPHEM_MAGIC, 8);
+   hdr.norad_number = tle->norad_number;
+   hdr.n_coeffs = N_CHEBY_COEFFS;
+   hdr.epoch = tle->epoch;
+   hdr.tsince_start = tsince_start;
+   n_segments = (int)ceil( span / (period / 2.));
+   for( ;;)
+      {
+      double err;
+
+      hdr.n_segments = n_segments;
+      hdr.segment_len = span / (double)n_segments;
+      trial = alloc_cheby_ephem( &hdr);
+      if( !trial)
+         break;
+      err = fit_segments( trial, tle, params, is_deep, tolerance);
+      if( err < 0.)
+         {
+         free( trial);
+         break;
+         }
+      if( passed_first_try == -1)
+         passed_first_try = (err <= tolerance);
+      if( err <= tolerance)
+         {
+         free( rval);
+         rval = trial;
+         if( !passed_first_try || n_segments == 1)
+            break;
+         n_segments = n_segments * 4 / 5;
+         }
+      else
+         {
+         free( trial);
+         if( passed_first_try)
+            break;
+         if( hdr.segment_len < 1. / 60.)
+            break;            /* can't get there from here */
+         n_segments = n_segments * 5 / 4 + 1;
+         }
+      }
+   if( is_deep && tle->ephemeris_type != 'H')
+      sxpx_free_checkpoints( params);
+   if( rval)
+      set_up_terms( rval);
+   return( rval);
+}
+
+/* Returns 0,  or -1 if 'tsince' is outside the fitted span,  in which
+case 'pos' and 'vel' are left alone.  'vel' can be NULL.  */
+
+int DLL_FUNC cheby_ephem_eval( const void *ephem, const double tsince,
+                                    double *pos, double *vel)
+{
+   const cheby_ephem_t *eptr = (const cheby_ephem_t *)ephem;
+   const int n = eptr->hdr.n_coeffs;
+   const double dt = (tsince - eptr->hdr.tsince_start) / eptr->hdr.segment_len;
+   const double *terms;
+   double x, two_x, b0[6], b1[6];
+   int seg, i, j;
+
+   if( dt < 0. || dt > (double)eptr->hdr.n_segments)
+      return( -1);
+   seg = (int)dt;
+   if( seg == eptr->hdr.n_segments)      /* right at the end of the span */
+      seg--;
+   x = 2. * (dt - (double)seg) - 1.;
+   two_x = x + x;
+   terms = eptr->terms + seg * 6 * n;
+   for( i = 0; i < 6; i++)
+      b0[i] = b1[i] = 0.;
+               /* Clenshaw's recurrence for all six series at once */
+   for( j = n - 1; j > 0; j--)
+      for( i = 0; i < 6; i++)
+         {
+         const double b2 = b1[i];
+
+         b1[i] = b0[i];
+         b0[i] = terms[j * 6 + i] + two_x * b1[i] - b2;
+         }
+   for( i = 0; i < 3; i++)
+      pos[i] = terms[i] + x * b0[i] - b1[i];
+   if( vel)
+      {
+      const double dx_dt = 2. / eptr->hdr.segment_len;
+
+      for( i = 3; i < 6; i++)
+         vel[i - 3] = dx_dt * (terms[i] + x * b0[i] - b1[i]);
+      }
+   return( 0);
+}
+
+/* Returns the NORAD number,  and (if the pointers are non-NULL) the
+TLE epoch as a JD and the span covered,  in minutes from that epoch. */
+
+int DLL_FUNC cheby_ephem_info( const void *ephem, double *epoch,
+                  double *tsince_start, double *tsince_end)
+{
+   const cheby_ephem_t *eptr = (const cheby_ephem_t *)ephem;
+
+   if( epoch)
+      *epoch = eptr->hdr.epoch;
+   if( tsince_start)
+      *tsince_start = eptr->hdr.tsince_start;
+   if( tsince_end)
+      *tsince_end = eptr->hdr.tsince_start
+                  + (double)eptr->hdr.n_segments * eptr->hdr.segment_len;
+   return( eptr->hdr.norad_number);
+}
+
+/* Returns the number of bytes written,  or -1 on failure. */
+
+long DLL_FUNC cheby_ephem_save( const void *ephem, const char *filename)
+{
+   const cheby_ephem_t *eptr = (const cheby_ephem_t *)ephem;
+   const size_t n_doubles = (size_t)eptr->hdr.n_segments * 3
+                                   * eptr->hdr.n_coeffs;
+   FILE *ofile = fopen( filename, "wb");
+   long rval = -1;
+
+   if( ofile)
+      {
+      if( fwrite( &eptr->hdr, sizeof( cheby_header_t), 1, ofile) == 1
+            && fwrite( eptr->coeffs, sizeof( double), n_doubles, ofile) == n_doubles)
+         rval = (long)( sizeof( cheby_header_t) + n_doubles * sizeof( double));
+      if( fclose( ofile))
+         rval = -1;
+      }
+   return( rval);
+}
+
+/* Returns NULL if the file can't be read,  or isn't a Chebyshev
+ephemeris (or was written on a machine with different byte order). */
+
+void * DLL_FUNC cheby_ephem_load( const char *filename)
+{
+   FILE *ifile = fopen( filename, "rb");
+   cheby_ephem_t *rval = NULL;
+   cheby_header_t hdr;
+
+   if( !ifile)
+      return( NULL);
+   if( fread( &hdr, sizeof( hdr), 1, ifile) == 1
+            && !memcmp( hdr.magic, CHEBY_EPHEM_MAGIC, 8)
+            && hdr.n_coeffs > 0 && hdr.n_coeffs <= 100
+            && hdr.n_segments > 0 && hdr.segment_len > 0.)
+      {
+      const size_t n_doubles = (size_t)hdr.n_segments * 3 * hdr.n_coeffs;
+
+      rval = alloc_cheby_ephem( &hdr);
+      if( rval && fread( rval->coeffs, sizeof( double), n_doubles, ifile)
+                                 != n_doubles)
+         {
+         free( rval);
+         rval = NULL;
+         }
+      if( rval)
+         set_up_terms( rval);
+      }
+   fclose( ifile);
+   return( rval);
+}
+
+void DLL_FUNC cheby_ephem_free( void *ephem)
+{
+   free( ephem);
+}
@@ -1,6 +1,7 @@
 /* Copyright (C) 2018, Project Pluto.  See LICENSE. */
 
 #include <math.h>
+#include <stdlib.h>
 #include "norad.h"
 #include "norad_in.h"
 
@@ -77,6 +78,8 @@ static inline double ThetaG( const double jd)
       /* (25 Aug 2006) INTEGRATION_STEP is now the variable                  */
       /* 'dpsec_integration_step' so I can experiment with different         */
       /* integration techniques & evaluate their errors.                     */
+      /* (Oct 2026) These are now just the defaults copied into each         */
+      /* satellite's 'params' at init;  see sxpx_config_t in norad.h.        */
 
 static double dpsec_integration_step = 720.;
 static int dpsec_integration_order = 2;
@@ -101,6 +104,23 @@ void DLL_FUNC sxpx_set_dpsec_integration_step( const double new_step_size)
    dpsec_integration_step = new_step_size;
 }
 
+void DLL_FUNC sxpx_get_default_config( sxpx_config_t *config)
+{
+   config->dpsec_integration_step = dpsec_integration_step;
+   config->dpsec_integration_order = dpsec_integration_order;
+   config->is_dundee_compliant = is_dundee_compliant;
+}
+
+/* Called at init;  a NULL config means "use the process-wide defaults". */
+
+void Deep_set_config( deep_arg_t *deep_arg, const sxpx_config_t *config)
+{
+   if( config)
+      deep_arg->config = *config;
+   else
+      sxpx_get_default_config( &deep_arg->config);
+}
+
 static inline double eval_cubic_poly( const double x, const double constant,
                const double linear, const double quadratic_term,
                const double cubic_term)
@@ -166,8 +186,6 @@ void Deep_dpinit( const tle_t *tle, deep_arg_t *deep_arg)
       } /* End if( days_since_1900 != deep_arg->preep) */
 
    /* Do solar terms */
-   deep_arg->savtsn = 1E20;
-
    /* There was previously some convoluted logic here,  but it boils    */
    /* down to this:  we compute the solar terms,  then the lunar terms. */
    /* On a second pass,  we recompute the solar terms,  taking advantage */
@@ -411,25 +429,82 @@ void Deep_dpinit( const tle_t *tle, deep_arg_t *deep_arg)
    if( deep_arg->resonance_flag)
       {
       deep_arg->xfact = bfact-deep_arg->xnq;
-
-      /* Initialize integrator */
-      deep_arg->xli = deep_arg->xlamo;
-      deep_arg->xni = deep_arg->xnq;
-      deep_arg->atime = 0;
       }
+   deep_arg->checkpoints = NULL;
+            /* Set up the state used by the 'legacy' SDP4( ) and SDP8( ) : */
+   Deep_init_state( deep_arg, &deep_arg->state);
    /* End case dpinit: */
 }
 
+/* The resonance integrator starts out at epoch,  and there are no
+lunisolar perturbations computed yet (the absurd 'savtsn' ensures
+they'll be computed on the first call to Deep_dpper( )). */
+
+void Deep_init_state( const deep_arg_t *deep_arg, sxpx_state_t *state)
+{
+   state->savtsn = 1E20;
+   state->atime = 0.;
+   state->pe = state->pinc = state->pl = state->pgh = state->ph = 0.;
+   if( deep_arg->resonance_flag)
+      {
+      state->xli = deep_arg->xlamo;
+      state->xni = deep_arg->xnq;
+      }
+   else
+      state->xli = state->xni = 0.;
+}
+
+         /* deep_arg_t has to fit in the space set aside for it in 'params'; */
+         /* if it doesn't,  the array size is negative and this won't compile */
+typedef char deep_arg_t_fits_in_params[
+         sizeof( deep_arg_t) <= DEEP_ARG_T_PARAMS * sizeof( double) ? 1 : -1];
+
+void DLL_FUNC sxpx_init_state( sxpx_state_t *state, const double *params)
+{
+   Deep_init_state( (const deep_arg_t *)( params + 10), state);
+}
+
+#ifdef RETAIN_PERTURBATION_VALUES_AT_EPOCH
+/* Compute the lunisolar perturbations at epoch,  so that Deep_dpper( )
+can subtract them off later.  The state is left with the (zero)
+perturbations at epoch,  just as if Deep_dpper( ) had been called for
+t=0. */
+
+void Deep_init_perturbations_at_epoch( const tle_t *tle, deep_arg_t *deep_arg)
+{
+   deep_vars_t vars;
+
+   deep_arg->pe0 = deep_arg->pinc0 = deep_arg->pl0 = 0.;
+   deep_arg->pgh0 = deep_arg->ph0 = 0.;
+   vars.xll = tle->xmo;
+   vars.omgadf = tle->omegao;
+   vars.xnode = tle->xnodeo;
+   vars.em = tle->eo;
+   vars.xinc = tle->xincl;
+   vars.xn = deep_arg->xnodp;
+   vars.t = 0.;                            /* added 30 Dec 2003 */
+   Deep_dpper( tle, deep_arg, &deep_arg->state, &vars);
+   deep_arg->pe0 = deep_arg->state.pe;
+   deep_arg->pinc0 = deep_arg->state.pinc;
+   deep_arg->pl0 = deep_arg->state.pl;
+   deep_arg->pgh0 = deep_arg->state.pgh;
+   deep_arg->ph0 = deep_arg->state.ph;
+   deep_arg->state.pe = deep_arg->state.pinc = deep_arg->state.pl = 0.;
+   deep_arg->state.pgh = deep_arg->state.ph = 0.;
+}
+#endif
+
 /* 'dpsec' is unavoidably confusing.  See https://projectpluto.com/dpsec.htm
 for some commentary on what's going on here. */
 
 static inline void compute_dpsec_derivs( const deep_arg_t *deep_arg,
-                                           double *derivs)
+                         const sxpx_state_t *state, double *derivs)
 {
-   const double sin_li = sin( deep_arg->xli);
-   const double cos_li = cos( deep_arg->xli);
+   const double sin_li = sin( state->xli);
+   const double cos_li = cos( state->xli);
    const double sin_2li = 2. * sin_li * cos_li;
    const double cos_2li = 2. * cos_li * cos_li - 1.;
+   const sxpx_config_t *config = &deep_arg->config;
    int i;
 
    derivs[0] = 0.;
@@ -456,11 +531,11 @@ static inline void compute_dpsec_derivs( const deep_arg_t *deep_arg,
       double term2b = 2. * deep_arg->del2 * (cos_2li * c_2fasx4 + sin_2li * s_2fasx4);
       double term3b = 3. * deep_arg->del3 * (cos_3li * c_3fasx6 + sin_3li * s_3fasx6);
 
-      for( i = 0; i < dpsec_integration_order; i += 2)
+      for( i = 0; i < config->dpsec_integration_order; i += 2)
          {
          *derivs++ = term1a + term2a + term3a;
          *derivs++ = term1b + term2b + term3b;
-         if( i + 2 < dpsec_integration_order)
+         if( i + 2 < config->dpsec_integration_order)
             {
             term1a = -term1a;
             term2a *= -4.;
@@ -489,7 +564,7 @@ static inline void compute_dpsec_derivs( const deep_arg_t *deep_arg,
       const double c_g54 = -0.29695209575316894;
       const double s_g54 = -0.95489237761529999;
       const double xomi =
-                deep_arg->omegaq + deep_arg->omgdot * deep_arg->atime;
+                deep_arg->omegaq + deep_arg->omgdot * state->atime;
       const double sin_omi = sin( xomi), cos_omi = cos( xomi);
       const double sin_li_m_omi = sin_li * cos_omi - sin_omi * cos_li;
       const double sin_li_p_omi = sin_li * cos_omi + sin_omi * cos_li;
@@ -530,11 +605,11 @@ static inline void compute_dpsec_derivs( const deep_arg_t *deep_arg,
              + deep_arg->d5421 * (cos_2li_p_omi*c_g54 + sin_2li_p_omi*s_g54)
              + deep_arg->d5433 * (cos_2li_m_omi*c_g54 + sin_2li_m_omi*s_g54));
 
-      for( i = 0; i < dpsec_integration_order; i += 2)
+      for( i = 0; i < config->dpsec_integration_order; i += 2)
          {
          *derivs++ = term1a + term2a;
          *derivs++ = term1b + term2b;
-         if( i + 2 < dpsec_integration_order)
+         if( i + 2 < config->dpsec_integration_order)
             {
             term1a = -term1a;
             term2a *= -4.;
@@ -545,16 +620,67 @@ static inline void compute_dpsec_derivs( const deep_arg_t *deep_arg,
       } /* End of 12-hr resonant case */
 }
 
-void Deep_dpsec( const tle_t *tle, deep_arg_t *deep_arg)
+/* One step of the resonance integrator,  from state->atime to
+state->atime + delt,  starting from state->xli and state->xni.  */
+
+static inline void dpsec_integrate( const deep_arg_t *deep_arg,
+                const sxpx_state_t *state, const double delt,
+                double *xli, double *xni)
+{
+   double derivs[20], xlpow = 1., delt_factor;
+   const double xldot = state->xni + deep_arg->xfact;
+   const sxpx_config_t *config = &deep_arg->config;
+   int i;
+
+   compute_dpsec_derivs( deep_arg, state, derivs);
+   *xli = state->xli + delt * xldot;
+   *xni = state->xni + delt * derivs[0];
+   delt_factor = delt;
+   for( i = 2; i <= config->dpsec_integration_order; i++)
+      {
+      xlpow *= xldot;
+      derivs[i - 1] *= xlpow;
+      delt_factor *= delt / (double)i;
+      *xli += delt_factor * derivs[i - 2];
+      *xni += delt_factor * derivs[i - 1];
+      }
+}
+
+/* Finds the node from which Deep_dpsec( ),  starting at epoch,  would
+take its final integration step to reach time t:  the first node (going
+outward from epoch) within one step of t.  If t is beyond the table,
+we get the outermost node on that side,  and Deep_dpsec( ) integrates
+onward from there. */
+
+static const double *find_checkpoint( const dpsec_checkpoints_t *cp,
+                     const double t, const double step)
+{
+   const int dir = (t < 0. ? -1 : 1);
+   const int n_max = (t < 0. ? cp->n_before : cp->n_after);
+   const double est = fabs( t) / step - 1.;
+   int k = (est < 0. ? 0 : (est > (double)n_max ? n_max : (int)est));
+
+   while( k < n_max
+         && (double)dir * (t - cp->nodes[3 * (cp->n_before + dir * k)]) > step)
+      k++;
+   while( k > 0
+         && (double)dir * (t - cp->nodes[3 * (cp->n_before + dir * (k - 1))]) <= step)
+      k--;
+   return( cp->nodes + 3 * (cp->n_before + dir * k));
+}
+
+void Deep_dpsec( const tle_t *tle, const deep_arg_t *deep_arg,
+                         sxpx_state_t *state, deep_vars_t *vars)
 {
    double temp, xni, xli;
    int final_integration_step = 0;
+   const sxpx_config_t *config = &deep_arg->config;
 
-   deep_arg->xll += deep_arg->ssl*deep_arg->t;
-   deep_arg->omgadf += deep_arg->ssg*deep_arg->t;
-   deep_arg->xnode += deep_arg->ssh*deep_arg->t;
-   deep_arg->em = tle->eo+deep_arg->sse*deep_arg->t;
-   deep_arg->xinc = tle->xincl+deep_arg->ssi*deep_arg->t;
+   vars->xll += deep_arg->ssl*vars->t;
+   vars->omgadf += deep_arg->ssg*vars->t;
+   vars->xnode += deep_arg->ssh*vars->t;
+   vars->em = tle->eo+deep_arg->sse*vars->t;
+   vars->xinc = tle->xincl+deep_arg->ssi*vars->t;
    if( !deep_arg->resonance_flag ) return;
 
             /* If we're closer to t=0 than to the currently-stored data
@@ -563,69 +689,129 @@ void Deep_dpsec( const tle_t *tle, deep_arg_t *deep_arg)
                The Dundee code rigs things up to _always_ take 720-minute
                steps from epoch to end time,  except for the final step.
                So if we'd have to integrate "backwards" (toward the epoch),
-               we gotta do a restart if we're to be Dundee-compliant.  */
-   if( fabs( deep_arg->t) < fabs( deep_arg->t - deep_arg->atime)
-            || (is_dundee_compliant && fabs( deep_arg->t) < fabs( deep_arg->atime)))
+               we gotta do a restart if we're to be Dundee-compliant.
+               With a checkpoint table,  we start from the node that the
+               Dundee code would have reached on its way out from epoch. */
+   if( deep_arg->checkpoints)
+      {
+      const double *node = find_checkpoint( deep_arg->checkpoints, vars->t,
+                                      config->dpsec_integration_step);
+
+      state->atime = node[0];
+      xli = node[1];
+      xni = node[2];
+      }
+   else if( fabs( vars->t) < fabs( vars->t - state->atime)
+            || (config->is_dundee_compliant && fabs( vars->t) < fabs( state->atime)))
       {                                    /* Epoch restart */
-      deep_arg->atime = 0.;
+      state->atime = 0.;
       xni = deep_arg->xnq;
       xli = deep_arg->xlamo;
       }
    else                          /* use xni, xli from previous runs: */
       {
-      xni = deep_arg->xni;
-      xli = deep_arg->xli;
+      xni = state->xni;
+      xli = state->xli;
       }
 
    while( !final_integration_step)
       {
-      double xldot, derivs[20], xlpow = 1., delt_factor;
-      double delt = deep_arg->t - deep_arg->atime;
-      int i;
-
-      deep_arg->xni = xni;
-      deep_arg->xli = xli;
-      compute_dpsec_derivs( deep_arg, derivs);
-      if( delt > dpsec_integration_step)
-         delt = dpsec_integration_step;
-      else if( delt < -dpsec_integration_step)
-         delt = -dpsec_integration_step;
+      double delt = vars->t - state->atime;
+
+      state->xni = xni;
+      state->xli = xli;
+      if( delt > config->dpsec_integration_step)
+         delt = config->dpsec_integration_step;
+      else if( delt < -config->dpsec_integration_step)
+         delt = -config->dpsec_integration_step;
       else
          final_integration_step = 1;
-
-      xldot = xni+deep_arg->xfact;
-
-      xli += delt * xldot;
-      xni += delt * derivs[0];
-      delt_factor = delt;
-      for( i = 2; i <= dpsec_integration_order; i++)
-         {
-         xlpow *= xldot;
-         derivs[i - 1] *= xlpow;
-         delt_factor *= delt / (double)i;
-         xli += delt_factor * derivs[i - 2];
-         xni += delt_factor * derivs[i - 1];
-         }
-      if( !is_dundee_compliant || !final_integration_step)
+      dpsec_integrate( deep_arg, state, delt, &xli, &xni);
+      if( !config->is_dundee_compliant || !final_integration_step)
          {
-         deep_arg->xni = xni;
-         deep_arg->xli = xli;
-         deep_arg->atime += delt;
+         state->xni = xni;
+         state->xli = xli;
+         state->atime += delt;
          }
       }
 
-   deep_arg->xn = xni;
+   vars->xn = xni;
 
-   temp = -deep_arg->xnode + deep_arg->thgr + deep_arg->t * thdt;
+   temp = -vars->xnode + deep_arg->thgr + vars->t * thdt;
 
-   deep_arg->xll = xli + temp
-         + (deep_arg->synchronous_flag ? -deep_arg->omgadf : temp);
+   vars->xll = xli + temp
+         + (deep_arg->synchronous_flag ? -vars->omgadf : temp);
    /*End case dpsec: */
 }
 
-void Deep_dpper( const tle_t *tle, deep_arg_t *deep_arg)
+/* Integrates from epoch out to tsince_min and tsince_max (minutes),  in
+the same steps Deep_dpsec( ) would,  and stores the results at each node.
+Returns the number of nodes,  or -1 if the orbit isn't resonant (and
+there's no integration to avoid),  or -2 if memory ran out.   */
+
+int DLL_FUNC sxpx_init_checkpoints( double *params, const double tsince_min,
+                                            const double tsince_max)
+{
+   deep_arg_t *deep_arg = (deep_arg_t *)( params + 10);
+   const double step = deep_arg->config.dpsec_integration_step;
+   dpsec_checkpoints_t *cp;
+   int dir, n_before, n_after, n_nodes;
+
+   sxpx_free_checkpoints( params);
+   if( !deep_arg->resonance_flag)
+      return( -1);
+   n_before = (tsince_min < 0. ? (int)ceil( -tsince_min / step) : 0);
+   n_after = (tsince_max > 0. ? (int)ceil( tsince_max / step) : 0);
+   n_nodes = n_before + n_after + 1;
+   cp = (dpsec_checkpoints_t *)malloc( sizeof( dpsec_checkpoints_t)
+                        + n_nodes * 3 * sizeof( double));
+   if( !cp)
+      return( -2);
+   cp->n_before = n_before;
+   cp->n_after = n_after;
+   cp->nodes = (double *)( cp + 1);
+   for( dir = -1; dir <= 1; dir += 2)
+      {
+      const int n = (dir < 0 ? n_before : n_after);
+      sxpx_state_t state;
+      int k;
+
+      Deep_init_state( deep_arg, &state);
+      for( k = 0; k <= n; k++)
+         {
+         double *node = cp->nodes + 3 * (n_before + dir * k);
+
+         if( k)
+            {
+            double xli, xni;
+
+            dpsec_integrate( deep_arg, &state, (double)dir * step, &xli, &xni);
+            state.xli = xli;
+            state.xni = xni;
+            state.atime += (double)dir * step;
+            }
+         node[0] = state.atime;
+         node[1] = state.xli;
+         node[2] = state.xni;
+         }
+      }
+   deep_arg->checkpoints = cp;
+   return( n_nodes);
+}
+
+void DLL_FUNC sxpx_free_checkpoints( double *params)
+{
+   deep_arg_t *deep_arg = (deep_arg_t *)( params + 10);
+
+   free( deep_arg->checkpoints);
+   deep_arg->checkpoints = NULL;
+}
+
+void Deep_dpper( const tle_t *tle, const deep_arg_t *deep_arg,
+                         sxpx_state_t *state, deep_vars_t *vars)
 {
    double sinis, cosis;
+   const sxpx_config_t *config = &deep_arg->config;
 
             /* If the time didn't change by more than 30 minutes,      */
             /* there's no good reason to recompute the perturbations;  */
@@ -633,15 +819,15 @@ void Deep_dpper( const tle_t *tle, deep_arg_t *deep_arg)
             /* However,  the Dundee code _always_ recomputes,  so if   */
             /* we're attempting to replicate its results,  we've gotta */
             /* recompute everything,  too.                             */
-   if( fabs(deep_arg->savtsn-deep_arg->t) >= 30. || is_dundee_compliant)
+   if( fabs(state->savtsn-vars->t) >= 30. || config->is_dundee_compliant)
       {
       double zf, zm, sinzf, ses, sis, sil, sel, sll, sls;
       double f2, f3, sghl, sghs, shs, sh1;
 
-      deep_arg->savtsn = deep_arg->t;
+      state->savtsn = vars->t;
 
             /* Update solar perturbations for time T: */
-      zm = deep_arg->zmos+zns_per_min*deep_arg->t;
+      zm = deep_arg->zmos+zns_per_min*vars->t;
       zf = zm+2*zes*sin(zm);
       sinzf = sin(zf);
       f2 = 0.5*sinzf*sinzf-0.25;
@@ -653,7 +839,7 @@ void Deep_dpper( const tle_t *tle, deep_arg_t *deep_arg)
       shs = deep_arg->sh2*f2+deep_arg->sh3*f3;
 
             /* Update lunar perturbations for time T: */
-      zm = deep_arg->zmol+znl_per_min*deep_arg->t;
+      zm = deep_arg->zmol+znl_per_min*vars->t;
       zf = zm+2*zel*sin(zm);
       sinzf = sin(zf);
       f2 = 0.5*sinzf*sinzf-0.25;
@@ -665,27 +851,17 @@ void Deep_dpper( const tle_t *tle, deep_arg_t *deep_arg)
       sh1 = deep_arg->xh2*f2+deep_arg->xh3*f3;
 
             /* Sum the solar and lunar contributions: */
-      deep_arg->pe = ses+sel;
-      deep_arg->pinc = sis+sil;
-      deep_arg->pl = sls+sll;
-      deep_arg->pgh = sghs+sghl;
-      deep_arg->ph = shs+sh1;
+      state->pe = ses+sel;
+      state->pinc = sis+sil;
+      state->pl = sls+sll;
+      state->pgh = sghs+sghl;
+      state->ph = shs+sh1;
 #ifdef RETAIN_PERTURBATION_VALUES_AT_EPOCH
-      if( deep_arg->solar_lunar_init_flag)
-         {
-         deep_arg->pe0 = deep_arg->pe;
-         deep_arg->pinc0 = deep_arg->pinc;
-         deep_arg->pl0 = deep_arg->pl;
-         deep_arg->pgh0 = deep_arg->pgh;
-         deep_arg->ph0 = deep_arg->ph;
-         }
-      deep_arg->pe  -= deep_arg->pe0;
-      deep_arg->pinc -= deep_arg->pinc0;
-      deep_arg->pl  -= deep_arg->pl0;
-      deep_arg->pgh -= deep_arg->pgh0;
-      deep_arg->ph  -= deep_arg->ph0;
-      if( deep_arg->solar_lunar_init_flag)
-         return;        /* done all we really need to do here... */
+      state->pe  -= deep_arg->pe0;
+      state->pinc -= deep_arg->pinc0;
+      state->pl  -= deep_arg->pl0;
+      state->pgh -= deep_arg->pgh0;
+      state->ph  -= deep_arg->ph0;
 #endif
       }
 
@@ -693,43 +869,43 @@ void Deep_dpper( const tle_t *tle, deep_arg_t *deep_arg)
                /* _before_ perturbations were added to xinc.  In        */
                /* Spacetrack 6,  it's the other way around (see below). */
 #ifndef SPACETRACK_3
-   deep_arg->xinc += deep_arg->pinc;
+   vars->xinc += state->pinc;
 #endif
-   sinis = sin( deep_arg->xinc);
-   cosis = cos( deep_arg->xinc);
+   sinis = sin( vars->xinc);
+   cosis = cos( vars->xinc);
 #ifdef SPACETRACK_3
-   deep_arg->xinc += deep_arg->pinc;
+   vars->xinc += state->pinc;
 #endif
 
          /* Add solar/lunar perturbation correction to eccentricity: */
-   deep_arg->em += deep_arg->pe;
-   deep_arg->xll += deep_arg->pl;
-   deep_arg->omgadf += deep_arg->pgh;
+   vars->em += state->pe;
+   vars->xll += state->pl;
+   vars->omgadf += state->pgh;
    if( tle->xincl >= 0.2)
       {             /* Apply periodics directly */
       double temp_val;
 
 #ifdef SPACETRACK_3
-      sinis = sin(deep_arg->xinc);
-      cosis = cos(deep_arg->xinc);
+      sinis = sin(vars->xinc);
+      cosis = cos(vars->xinc);
 #endif
-      temp_val = deep_arg->ph / sinis;
-      deep_arg->omgadf -= cosis * temp_val;
-      deep_arg->xnode += temp_val;
+      temp_val = state->ph / sinis;
+      vars->omgadf -= cosis * temp_val;
+      vars->xnode += temp_val;
       }
    else
       {
         /* Apply periodics with Lyddane modification */
-      const double sinok = sin(deep_arg->xnode);
-      const double cosok = cos(deep_arg->xnode);
-      const double alfdp = deep_arg->ph * cosok
-                    + (deep_arg->pinc * cosis + sinis) * sinok;
-      const double betdp = - deep_arg->ph * sinok
-                    + (deep_arg->pinc * cosis + sinis) * cosok;
+      const double sinok = sin(vars->xnode);
+      const double cosok = cos(vars->xnode);
+      const double alfdp = state->ph * cosok
+                    + (state->pinc * cosis + sinis) * sinok;
+      const double betdp = - state->ph * sinok
+                    + (state->pinc * cosis + sinis) * cosok;
       double dls, delta_xnode;
 
-//    deep_arg->xnode = FMod2p(deep_arg->xnode);
-      delta_xnode = atan2(alfdp,betdp) - deep_arg->xnode;
+//    vars->xnode = FMod2p(vars->xnode);
+      delta_xnode = atan2(alfdp,betdp) - vars->xnode;
 
        /* This is a patch to Lyddane modification suggested */
        /* by Rob Matson, streamlined very slightly by BJG, to */
@@ -740,14 +916,14 @@ void Deep_dpper( const tle_t *tle, deep_arg_t *deep_arg)
       else if( delta_xnode > pi)
          delta_xnode -= twopi;
 
-      dls = -deep_arg->xnode * sinis * deep_arg->pinc;
+      dls = -vars->xnode * sinis * state->pinc;
 #ifdef SPACETRACK_3
-      deep_arg->omgadf += dls
-               + cosis * deep_arg->xnode -
-               - cos( deep_arg->xinc) * (deep_arg->xnode + delta_xnode);
+      vars->omgadf += dls
+               + cosis * vars->xnode -
+               - cos( vars->xinc) * (vars->xnode + delta_xnode);
 #else
-      deep_arg->omgadf += dls - cosis * delta_xnode;
+      vars->omgadf += dls - cosis * delta_xnode;
 #endif
-      deep_arg->xnode += delta_xnode;
+      vars->xnode += delta_xnode;
       } /* End case dpper: */
 }
@@ -59,29 +59,34 @@ int main( const int argc, const char **argv)
          {                  /* hey! we got a TLE! */
          int is_deep = select_ephemeris( &tle);
          double sat_params[N_SAT_PARAMS], observer_loc[3];
-         double prev_pos[3];
+         double prev_pos[3], *t_since, *pos;
+         int *err_vals;
 
          if( err_val)
             printf( "WARNING: TLE parsing error %d\n", err_val);
          for( i = 0; i < 3; i++)
             observer_loc[i] = 0.;
+         t_since = (double *)malloc( n_steps * 4 * sizeof( double));
+         pos = t_since + n_steps;
+         err_vals = (int *)malloc( n_steps * sizeof( int));
+         for( i = 0; i < n_steps; i++)
+            t_since[i] = (double)( i - n_steps / 2) * step_size * 1440.;
          if( is_deep)
+            {
             SDP4_init( sat_params, &tle);
+            SDP4_ephemeris( t_since, n_steps, &tle, sat_params, pos, NULL, err_vals);
+            }
          else
+            {
             SGP4_init( sat_params, &tle);
-         for( i = 0; i < n_steps; i++)
+            SGP4_ephemeris( t_since, n_steps, &tle, sat_params, pos, NULL, err_vals);
+            }
+         for( i = 0; i < n_steps; i++, pos += 3)
             {
-            double pos[3]; /* Satellite position vector */
-            double t_since = (double)( i - n_steps / 2) * step_size;
-            double jd = tle.epoch + t_since;
+            double jd = tle.epoch + (double)( i - n_steps / 2) * step_size;
 
-            t_since *= 1440.;
-            if( is_deep)
-               err_val = SDP4( t_since, &tle, sat_params, pos, NULL);
-            else
-               err_val = SGP4( t_since, &tle, sat_params, pos, NULL);
-            if( err_val)
-               printf( "Ephemeris error %d\n", err_val);
+            if( err_vals[i])
+               printf( "Ephemeris error %d\n", err_vals[i]);
             if( show_vectors)
                {
                if( i)
@@ -103,6 +108,8 @@ int main( const int argc, const char **argv)
                printf( "                    TLEs 500\n");
                }
             }
+         free( t_since);
+         free( err_vals);
          }
       strcpy( line1, line2);
       }
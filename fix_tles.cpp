@@ -100,9 +100,7 @@ int main( const int argc, const char **argv)
    *line1 = '\0';
    while( fgets( line2, sizeof( line2), ifile))
       {
-      tle_t unused_tle;
-
-      if( parse_elements( line1, line2, &unused_tle) >= 0)
+      if( tle_validate( line1, line2, 0) >= 0)
          {
          if( norad_desig)
             {
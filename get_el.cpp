@@ -15,6 +15,32 @@
 #define AE 1.0
                              /* distance units, earth radii */
 
+/* Equivalent to atoi( ),  but stops after 'max_len' bytes.  Parsing the
+TLE fields in place with this avoids copying them to null-terminated
+temporary buffers,  and is a good deal faster than the library atoi( ). */
+
+static inline int get_int( const char *buff, int max_len)
+{
+   int rval = 0, is_negative = 0;
+
+   while( max_len && (*buff == ' ' || (*buff >= 9 && *buff <= 13)))
+      {
+      buff++;
+      max_len--;
+      }
+   if( max_len && (*buff == '-' || *buff == '+'))
+      {
+      is_negative = (*buff == '-');
+      buff++;
+      max_len--;
+      }
+   while( max_len-- && *buff >= '0' && *buff <= '9')
+      rval = rval * 10 + (int)( *buff++ - '0');
+   return( is_negative ? -rval : rval);
+}
+
+#define NO_MAX_LEN      100
+
 /* TLEs have four angles on line 2,  given in the form DDD.DDDD.  This
 can be parsed more quickly as an integer,  then cast to double and
 converted to radians,  all in one step.    */
@@ -49,7 +75,7 @@ static double sci( const char *string)
 
    if( string[1] != ' ')
       {
-      const int ival = atoi( string);
+      const int ival = get_int( string, NO_MAX_LEN);
 
       if( ival)
          {
@@ -106,6 +132,106 @@ int DLL_FUNC tle_checksum( const char *buff)
    return( rval);
 }
 
+/* tle_validate( ) checks a pair of lines the same way parse_elements( )
+does,  and returns what parse_elements( ) would return for them,  but
+without parsing anything.  If 'flags' includes TLE_CHECK_FORMAT,  it also
+returns -5 if the decimal points aren't in the standard columns or the
+NORAD numbers on the two lines differ;  real TLEs always pass these tests,
+but parse_elements( ) doesn't check them.
+
+   It's meant for quickly discarding non-TLE lines when scanning large
+files,  and uses SSE2 (where available) to checksum 16 bytes at a time.
+Unlike parse_elements( ),  it always reads the first 70 bytes of each
+line,  even if the line is shorter,  so those bytes must be readable (as
+they will be for lines read into,  say,  100-byte buffers by fgets( )).
+Whatever is past the end of a short line doesn't change the result.  */
+
+#if defined( __SSE2__) || defined( _M_X64) || (defined( _M_IX86_FP) && _M_IX86_FP >= 2)
+   #define USE_SSE2
+   #include <emmintrin.h>
+#endif
+
+#ifdef USE_SSE2
+         /* Returns the checksum (before the mod 10) of bytes 0 to 67 of    */
+         /* 'buff',  or -2 if any of those bytes is invalid.  Bytes 52-63   */
+         /* are read twice,  so the last block is masked to 64-67.          */
+static inline int sse2_checksum( const char *buff)
+{
+   const __m128i zero = _mm_setzero_si128( );
+   const __m128i space = _mm_set1_epi8( ' '), z = _mm_set1_epi8( 'z');
+   const __m128i zero_char = _mm_set1_epi8( '0');
+   const __m128i ten = _mm_set1_epi8( 10), minus = _mm_set1_epi8( '-');
+   const __m128i one = _mm_set1_epi8( 1);
+   __m128i sum = zero, bad = zero;
+   int i;
+
+   for( i = 0; i < 5; i++)
+      {
+      const __m128i mask = (i < 4 ? _mm_set1_epi8( -1) :
+               _mm_setr_epi8( 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1));
+      const __m128i v = _mm_loadu_si128( (const __m128i *)( buff
+                                          + (i < 4 ? i * 16 : 52)));
+      const __m128i digit = _mm_sub_epi8( v, zero_char);
+      const __m128i is_digit = _mm_and_si128( _mm_cmpgt_epi8( digit, zero),
+                                              _mm_cmplt_epi8( digit, ten));
+      const __m128i values = _mm_or_si128( _mm_and_si128( digit, is_digit),
+                         _mm_and_si128( _mm_cmpeq_epi8( v, minus), one));
+
+      bad = _mm_or_si128( bad, _mm_and_si128( mask, _mm_or_si128(
+                  _mm_cmplt_epi8( v, space), _mm_cmpgt_epi8( v, z))));
+      sum = _mm_add_epi64( sum, _mm_sad_epu8( _mm_and_si128( values, mask), zero));
+      }
+   if( _mm_movemask_epi8( bad))
+      return( -2);
+   return( _mm_cvtsi128_si32( sum)
+              + _mm_cvtsi128_si32( _mm_unpackhi_epi64( sum, sum)));
+}
+
+static int fast_tle_checksum( const char *buff)
+{
+   int rval;
+
+   if( (*buff != '1' && *buff != '2') || buff[1] != ' ')
+      return( -1);
+   rval = sse2_checksum( buff);
+   if( rval < 0)
+      return( rval);
+   rval -= buff[68] - '0';
+   if( buff[69] > ' ')              /* line unterminated */
+      rval = -3;
+   else
+      {
+      rval %= 10;
+      if( rval < 0)
+         rval += 10;
+      }
+   return( rval);
+}
+#else
+   #define fast_tle_checksum tle_checksum
+#endif
+
+int DLL_FUNC tle_validate( const char *line1, const char *line2,
+                                          const int flags)
+{
+   int rval1, rval2;
+
+   if( *line1 != '1' || *line2 != '2')
+      return( -4);
+   rval1 = fast_tle_checksum( line1);
+   if( rval1 < 0)
+      return( rval1 - 100);
+   rval2 = fast_tle_checksum( line2);
+   if( rval2 < 0)
+      return( rval2);
+   if( flags & TLE_CHECK_FORMAT)
+      if( line1[23] != '.' || line2[11] != '.' || line2[20] != '.'
+               || line2[37] != '.' || line2[46] != '.' || line2[54] != '.'
+               || memcmp( line1 + 2, line2 + 2, 5))
+         return( -5);
+   return( (rval1 ? 1 : 0) | (rval2 ? 2 : 0));
+}
+
 static inline int mutant_dehex( const char ichar)
 {
    int rval;
@@ -251,14 +377,15 @@ static int get_norad_number( const char *buff)
          if( *buff > 'O')
             digits[0]--;
          }
-      rval = digits[0] * 10000 + atoi( buff + 1);
+      rval = digits[0] * 10000 + get_int( buff + 1, NO_MAX_LEN);
       }
    return( rval);
 }
 
-static inline double get_eight_places( const char *ptr)
+static inline double get_eight_places( const char *ptr, const int max_len)
 {
-   return( (double)atoi( ptr) + (double)atoi(ptr + 4) * 1e-8);
+   return( (double)get_int( ptr, max_len)
+                  + (double)get_int( ptr + 4, max_len - 4) * 1e-8);
 }
 
 /* Meteor 2-08                                                           */
@@ -268,12 +395,79 @@ static inline double get_eight_places( const char *ptr)
 #define J2000 2451545.5
 #define J1900 (J2000 - 36525. - 1.)
 
+/* Sets 'sat' from a pair of lines that have already passed the checksum
+tests in parse_elements( ) (or parse_elements_in_buffer( )).  All fields
+are parsed in place,  without copying.  */
+
+static void parse_tle_fields( const char *line1, const char *line2, tle_t *sat)
+{
+   int year = line1[19] - '0';
+
+   if( line1[18] >= '0')
+      year += (line1[18] - '0') * 10;
+   if( year < 57)          /* cycle around Y2K */
+      year += 100;
+   sat->epoch = get_eight_places( line1 + 20, NO_MAX_LEN) + J1900
+          + (double)( year * 365 + (year - 1) / 4);
+   sat->norad_number = get_norad_number( line1 + 2);
+   sat->bulletin_number = get_int( line1 + 64, 4);
+   sat->classification = line1[7];       /* almost always 'U' */
+   memcpy( sat->intl_desig, line1 + 9, 8);
+   if( !memcmp( sat->intl_desig, "     ", 5))
+      {  /* usually 'analyst' object w/o international (COSPAR) desig; */
+      int i, n = sat->norad_number;      /* set launch 000,  year/part */
+                                         /* data mapped from NORAD #   */
+      for( i = 7; i > 4; i--, n /= 26)
+         sat->intl_desig[i] = 'A' + n % 26;
+      sat->intl_desig[2] = sat->intl_desig[3] = sat->intl_desig[4] = '0';
+      sat->intl_desig[1] = '0' + n % 10;
+      sat->intl_desig[0] = '0' + n / 10;
+      }
+   sat->intl_desig[8] = '\0';
+   sat->revolution_number = get_int( line2 + 63, 5);
+   sat->ephemeris_type = line1[62];
+   if( sat->ephemeris_type == 'H')
+      {
+      size_t i;
+      double *state_vect = &sat->xincl;
+
+      for( i = 0; i < 3; i++)
+         {
+         state_vect[i]     = get_high_value( line1 + 33 + i * 10);
+         state_vect[i + 3] = get_high_value( line2 + 33 + i * 10) * 1e-4;
+         }
+      return;
+      }
+
+   sat->xmo = (double)get_angle( line2 + 43) * (PI / 180e+4);
+   sat->xnodeo = (double)get_angle( line2 + 17) * (PI / 180e+4);
+   sat->omegao = (double)get_angle( line2 + 34) * (PI / 180e+4);
+   sat->xincl = (double)get_angle( line2 + 8) * (PI / 180e+4);
+   sat->eo = get_int( line2 + 26, NO_MAX_LEN) * 1.e-7;
+
+         /* Mean motion is limited to 12 bytes,  since the rev. no.   */
+         /* may immediately follow.                                   */
+         /* Input mean motion,  derivative of mean motion and second  */
+         /* deriv of mean motion,  are all in revolutions and days.   */
+         /* Convert them here to radians and minutes:                 */
+   sat->xno = get_eight_places( line2 + 51, 12) * TWOPI / MINUTES_PER_DAY;
+   sat->xndt2o = (double)get_int( line1 + 35, NO_MAX_LEN)
+                     * 1.e-8 * TWOPI / MINUTES_PER_DAY_SQUARED;
+   if( line1[33] == '-')
+      sat->xndt2o *= -1.;
+   sat->xndd6o = sci( line1 + 44) * TWOPI / MINUTES_PER_DAY_CUBED;
+
+   sat->bstar = sci( line1 + 53) * AE;
+}
+
 /* parse_elements returns:
          0 if the elements are parsed without error;
          1 if they're OK except the first line has a checksum error;
          2 if they're OK except the second line has a checksum error;
          3 if they're OK except both lines have checksum errors;
-         a negative value if the lines aren't at all parseable */
+         a negative value if the lines aren't at all parseable.
+   State vectors (ephemeris type 'H') return 0 even if there are checksum
+errors,  as they always have. */
 
 int DLL_FUNC parse_elements( const char *line1, const char *line2, tle_t *sat)
 {
@@ -305,70 +499,76 @@ int DLL_FUNC parse_elements( const char *line1, const char *line2, tle_t *sat)
 
    if( !rval)
       {
-      char tbuff[13];
-      int year = line1[19] - '0';
-
-      if( line1[18] >= '0')
-         year += (line1[18] - '0') * 10;
-      if( year < 57)          /* cycle around Y2K */
-         year += 100;
-      sat->epoch = get_eight_places( line1 + 20) + J1900
-             + (double)( year * 365 + (year - 1) / 4);
-      sat->norad_number = get_norad_number( line1 + 2);
-      memcpy( tbuff, line1 + 64, 4);
-      tbuff[4] = '\0';
-      sat->bulletin_number = atoi( tbuff);
-      sat->classification = line1[7];       /* almost always 'U' */
-      memcpy( sat->intl_desig, line1 + 9, 8);
-      if( !memcmp( sat->intl_desig, "     ", 5))
-         {  /* usually 'analyst' object w/o international (COSPAR) desig; */
-         int i, n = sat->norad_number;      /* set launch 000,  year/part */
-                                            /* data mapped from NORAD #   */
-         for( i = 7; i > 4; i--, n /= 26)
-            sat->intl_desig[i] = 'A' + n % 26;
-         sat->intl_desig[2] = sat->intl_desig[3] = sat->intl_desig[4] = '0';
-         sat->intl_desig[1] = '0' + n % 10;
-         sat->intl_desig[0] = '0' + n / 10;
-         }
-      sat->intl_desig[8] = '\0';
-      memcpy( tbuff, line2 + 63, 5);
-      tbuff[5] = '\0';
-      sat->revolution_number = atoi( tbuff);
-      sat->ephemeris_type = line1[62];
-      if( sat->ephemeris_type == 'H')
-         {
-         size_t i;
-         double *state_vect = &sat->xincl;
+      parse_tle_fields( line1, line2, sat);
+      if( sat->ephemeris_type == 'H')  /* state vectors have always been */
+         return( 0);                   /* returned without checksum flags */
+      }
+   return( rval ? rval : checksum_problem);
+}
 
-         for( i = 0; i < 3; i++)
+/* parse_elements_in_buffer( ) parses all the TLEs in a buffer,  such as
+an entire memory-mapped or decompressed catalog file,  in one pass,  into
+'tles'.  The result is the same as reading the buffer line by line and
+keeping the pairs for which parse_elements( ) returns a non-negative
+value (i.e.,  TLEs with checksum errors are kept),  but nothing is copied
+and there's no need for null-terminated lines;  'buff' needn't be
+null-terminated,  either.  Lines may end in LF or CR/LF.
+
+   At most 'max_tles' are parsed.  If 'offsets' is non-NULL,  it gets the
+offset within 'buff' of line 1 of each TLE (useful if the TLEs are to be
+output later).  If 'tles' is NULL,  nothing is stored;  the TLEs are just
+counted,  so you can call this function once to see how big an array to
+allocate.  Returns the number of TLEs found.   */
+
+#define MIN_TLE_LINE_LEN 70
+
+int DLL_FUNC parse_elements_in_buffer( const char *buff,
+            const size_t buff_size, tle_t *tles, const int max_tles,
+            size_t *offsets)
+{
+   const char *end = buff + buff_size, *line1 = buff;
+   int n_found = 0;
+
+   while( n_found < max_tles && line1 < end)
+      {
+      const char *line2 = (const char *)memchr( line1, '\n',
+                                                (size_t)( end - line1));
+
+      if( !line2)
+         break;
+      line2++;
+      if( line1[0] == '1' && line1[1] == ' ' && line2 < end
+                          && line2[0] == '2' && line2[1] == ' ')
+         {
+         char padded[2][MIN_TLE_LINE_LEN + 2];
+         const char *l1 = line1, *l2 = line2;
+         int rval;
+
+         if( end - line2 < MIN_TLE_LINE_LEN + 1)
+            {        /* at end of buffer;  copy to null-terminated lines */
+            memset( padded, 0, sizeof( padded));
+            memcpy( padded[0], line1, (line2 - line1 < MIN_TLE_LINE_LEN + 1 ?
+                           line2 - line1 : MIN_TLE_LINE_LEN + 1));
+            memcpy( padded[1], line2, (end - line2 < MIN_TLE_LINE_LEN + 1 ?
+                           end - line2 : MIN_TLE_LINE_LEN + 1));
+            l1 = padded[0];
+            l2 = padded[1];
+            }
+         rval = tle_validate( l1, l2, 0);
+         if( rval >= 0)
             {
-            state_vect[i]     = get_high_value( line1 + 33 + i * 10);
-            state_vect[i + 3] = get_high_value( line2 + 33 + i * 10) * 1e-4;
+            if( tles)
+               parse_tle_fields( l1, l2, tles + n_found);
+            if( offsets)
+               offsets[n_found] = (size_t)( line1 - buff);
+            n_found++;
+            line2 = (const char *)memchr( line2, '\n', (size_t)( end - line2));
+            if( !line2)
+               break;
+            line2++;
             }
-         return( 0);
          }
-
-      sat->xmo = (double)get_angle( line2 + 43) * (PI / 180e+4);
-      sat->xnodeo = (double)get_angle( line2 + 17) * (PI / 180e+4);
-      sat->omegao = (double)get_angle( line2 + 34) * (PI / 180e+4);
-      sat->xincl = (double)get_angle( line2 + 8) * (PI / 180e+4);
-      sat->eo = atoi( line2 + 26) * 1.e-7;
-
-      /* Make sure mean motion is null-terminated, since rev. no.
-          may immediately follow. */
-      memcpy( tbuff, line2 + 51, 12);
-      tbuff[12] = '\0';
-            /* Input mean motion,  derivative of mean motion and second  */
-            /* deriv of mean motion,  are all in revolutions and days.   */
-            /* Convert them here to radians and minutes:                 */
-      sat->xno = get_eight_places( tbuff) * TWOPI / MINUTES_PER_DAY;
-      sat->xndt2o = (double)atoi( line1 + 35)
-                        * 1.e-8 * TWOPI / MINUTES_PER_DAY_SQUARED;
-      if( line1[33] == '-')
-         sat->xndt2o *= -1.;
-      sat->xndd6o = sci( line1 + 44) * TWOPI / MINUTES_PER_DAY_CUBED;
-
-      sat->bstar = sci( line1 + 53) * AE;
+      line1 = line2;
       }
-   return( rval ? rval : checksum_problem);
+   return( n_found);
 }
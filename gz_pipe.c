@@ -0,0 +1,241 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/* Reading a big gzipped TLE file with gzgets( ) means decompressing,
+parsing,  and propagating all take turns on one thread.  Here,  a
+producer thread decompresses the file in large blocks into a small ring
+of buffers,  while the caller takes lines from the filled blocks.  On a
+multi-core machine,  decompression is then (nearly) free;  the caller
+only waits for it if it gets GZ_PIPE_N_BLOCKS blocks behind.
+
+   Lines are returned exactly as gzgets( ) would return them,  including
+lines that straddle blocks,  or that are longer than the buffer.
+
+   The thread and its GZ_PIPE_N_BLOCKS * GZ_PIPE_BLOCK_SIZE bytes of
+buffers only pay off for gzipped files,  or for plain ones big enough
+that reading them takes a while.  Other files (ObsCodes.html,  the short
+files a TLE list #includes) are read with gzgets( ) in the calling
+thread,  using zlib's own small buffer,  as are all files without POSIX
+threads (Windows,  Watcom) or if the thread can't be started.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined( _WIN32) || defined( __WATCOMC__)
+   #include "zlibstub.h"
+#else
+   #include <zlib.h>
+   #include <pthread.h>
+   #include <sys/stat.h>
+   #define USE_PTHREADS
+#endif
+#include "gz_pipe.h"
+
+#define GZ_PIPE_BLOCK_SIZE    (1 << 18)
+#define GZ_PIPE_N_BLOCKS      4
+
+      /* plain (not gzipped) files smaller than this are read unthreaded */
+#define GZ_PIPE_MIN_PLAIN_SIZE   (16L << 20)
+
+struct gz_pipe
+{
+   gzFile ifile;
+#ifdef USE_PTHREADS
+   int threaded;
+   pthread_t thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t filled, emptied;
+   char *blocks[GZ_PIPE_N_BLOCKS];
+   int sizes[GZ_PIPE_N_BLOCKS];     /* zero size = end of file */
+   int head, tail, n_filled;        /* producer fills 'head',  we read 'tail' */
+   int closing, eof, holding_tail;
+   const char *curr;                /* remainder of the 'tail' block */
+   size_t n_left;
+#endif
+};
+
+#ifdef USE_PTHREADS
+static void *producer( void *arg)
+{
+   gz_pipe_t *p = (gz_pipe_t *)arg;
+   int done = 0;
+
+   while( !done)
+      {
+      int n_read;
+
+      pthread_mutex_lock( &p->mutex);
+      while( p->n_filled == GZ_PIPE_N_BLOCKS && !p->closing)
+         pthread_cond_wait( &p->emptied, &p->mutex);
+      done = p->closing;
+      pthread_mutex_unlock( &p->mutex);
+      if( done)
+         break;
+               /* slot 'head' isn't in use by the consumer,  so we can */
+               /* fill it without holding the lock */
+      n_read = gzread( p->ifile, p->blocks[p->head], GZ_PIPE_BLOCK_SIZE);
+      if( n_read <= 0)     /* end of file,  or an error */
+         {
+         n_read = 0;
+         done = 1;
+         }
+      pthread_mutex_lock( &p->mutex);
+      p->sizes[p->head] = n_read;
+      p->head = (p->head + 1) % GZ_PIPE_N_BLOCKS;
+      p->n_filled++;
+      pthread_cond_signal( &p->filled);
+      pthread_mutex_unlock( &p->mutex);
+      }
+   return( NULL);
+}
+
+/* Hands the block we've finished with back to the producer,  and waits
+for the next one.  Returns 0 at the end of the file.  */
+
+static int next_block( gz_pipe_t *p)
+{
+   if( p->eof)
+      return( 0);
+   pthread_mutex_lock( &p->mutex);
+   if( p->holding_tail)
+      {
+      p->tail = (p->tail + 1) % GZ_PIPE_N_BLOCKS;
+      p->n_filled--;
+      pthread_cond_signal( &p->emptied);
+      }
+   while( !p->n_filled)
+      pthread_cond_wait( &p->filled, &p->mutex);
+   p->holding_tail = 1;
+   p->curr = p->blocks[p->tail];
+   p->n_left = (size_t)p->sizes[p->tail];
+   p->eof = !p->n_left;
+   pthread_mutex_unlock( &p->mutex);
+   return( !p->eof);
+}
+
+/* Decides if reading 'filename' from 'offset' on is worth a thread.  Must
+be called before anything is read,  since gzdirect( ) looks at the start
+of the file to see if it's gzipped. */
+
+static int worth_threading( gzFile ifile, const char *filename,
+                                             const long offset)
+{
+   struct stat st;
+
+   if( !gzdirect( ifile))
+      return( 1);
+   return( !stat( filename, &st)
+                  && (long)st.st_size - offset >= GZ_PIPE_MIN_PLAIN_SIZE);
+}
+#endif
+
+/* Opens 'filename' and starts reading at (uncompressed) byte 'offset'.
+For a plain file,  that's a true seek;  for a gzipped one,  zlib has to
+decompress up to that point,  but at least we don't have to read through
+the lines.  Returns NULL if the file can't be opened,  or the seek fails. */
+
+gz_pipe_t *gz_pipe_open_at( const char *filename, const long offset)
+{
+   gz_pipe_t *p;
+   gzFile ifile = gzopen( filename, "rb");
+#ifdef USE_PTHREADS
+   int use_thread;
+#endif
+
+   if( !ifile)
+      return( NULL);
+#ifdef USE_PTHREADS
+   use_thread = worth_threading( ifile, filename, offset);
+#endif
+   if( offset && gzseek( ifile, offset, SEEK_SET) != offset)
+      {
+      gzclose( ifile);
+      return( NULL);
+      }
+   p = (gz_pipe_t *)calloc( 1, sizeof( gz_pipe_t));
+   if( !p)
+      {
+      gzclose( ifile);
+      return( NULL);
+      }
+   p->ifile = ifile;
+#ifdef USE_PTHREADS
+   if( use_thread)
+      p->blocks[0] = (char *)malloc( GZ_PIPE_N_BLOCKS * GZ_PIPE_BLOCK_SIZE);
+   if( p->blocks[0])
+      {
+      int i;
+
+      for( i = 1; i < GZ_PIPE_N_BLOCKS; i++)
+         p->blocks[i] = p->blocks[0] + i * GZ_PIPE_BLOCK_SIZE;
+      pthread_mutex_init( &p->mutex, NULL);
+      pthread_cond_init( &p->filled, NULL);
+      pthread_cond_init( &p->emptied, NULL);
+      p->threaded = !pthread_create( &p->thread, NULL, producer, p);
+      if( !p->threaded)
+         {
+         pthread_mutex_destroy( &p->mutex);
+         pthread_cond_destroy( &p->filled);
+         pthread_cond_destroy( &p->emptied);
+         }
+      }
+#endif
+   return( p);
+}
+
+gz_pipe_t *gz_pipe_open( const char *filename)
+{
+   return( gz_pipe_open_at( filename, 0L));
+}
+
+char *gz_pipe_gets( gz_pipe_t *p, char *buff, const int buff_len)
+{
+#ifdef USE_PTHREADS
+   if( p->threaded)
+      {
+      size_t n = 0;
+
+      while( n + 1 < (size_t)buff_len && (p->n_left || next_block( p)))
+         {
+         size_t len = (size_t)buff_len - 1 - n;
+         const char *eol;
+
+         if( len > p->n_left)
+            len = p->n_left;
+         eol = (const char *)memchr( p->curr, '\n', len);
+         if( eol)
+            len = (size_t)( eol - p->curr) + 1;
+         memcpy( buff + n, p->curr, len);
+         n += len;
+         p->curr += len;
+         p->n_left -= len;
+         if( eol)
+            break;
+         }
+      if( !n)
+         return( NULL);
+      buff[n] = '\0';
+      return( buff);
+      }
+#endif
+   return( gzgets( p->ifile, buff, buff_len));
+}
+
+void gz_pipe_close( gz_pipe_t *p)
+{
+#ifdef USE_PTHREADS
+   if( p->threaded)
+      {
+      pthread_mutex_lock( &p->mutex);
+      p->closing = 1;
+      pthread_cond_signal( &p->emptied);
+      pthread_mutex_unlock( &p->mutex);
+      pthread_join( p->thread, NULL);
+      pthread_mutex_destroy( &p->mutex);
+      pthread_cond_destroy( &p->filled);
+      pthread_cond_destroy( &p->emptied);
+      }
+   free( p->blocks[0]);
+#endif
+   gzclose( p->ifile);
+   free( p);
+}
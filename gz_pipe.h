@@ -0,0 +1,24 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+#ifndef GZ_PIPE_H_INCLUDED
+#define GZ_PIPE_H_INCLUDED
+
+/* Reads (possibly gzipped) text files line by line,  with decompression
+of gzipped or big files running ahead in a separate thread;  see
+'gz_pipe.c'.  gz_pipe_gets( ) works just as gzgets( ) (or fgets( )) does.  */
+
+typedef struct gz_pipe gz_pipe_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+gz_pipe_t *gz_pipe_open( const char *filename);
+gz_pipe_t *gz_pipe_open_at( const char *filename, const long offset);
+char *gz_pipe_gets( gz_pipe_t *pipe, char *buff, const int buff_len);
+void gz_pipe_close( gz_pipe_t *pipe);
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+#endif  /* #ifndef GZ_PIPE_H_INCLUDED */
@@ -45,34 +45,65 @@ different as a result).  So this really works,  at present,  only for
 #define PI \
    3.1415926535897932384626433832795028841971693993751058209749445923
 
+/* The TLE file is read and indexed (see 'tle_idx.cpp') on the first call,
+and again if a different file is asked for;  otherwise,  each lookup is
+a hash table probe instead of a pass through the file.  As before,  the
+first TLE in the file for 'norad_no' is used. */
+
 int find_tle( tle_t *tle, const char *filename, const int norad_no)
 {
-   FILE *ifile = fopen( filename, "rb");
-   char line0[100], line1[100], line2[100];
-   int rval = -1;
+   static tle_t *tles = NULL;
+   static void *index = NULL;
+   static char *indexed_filename = NULL;
+   int idx;
 
-   if( !ifile)
-      {
-      fprintf( stderr, "Couldn't open TLE file '%s'\n", filename);
-      exit( -1);
-      }
-   *line0 = *line1 = '\0';
-   while( rval && fgets( line2, sizeof( line2), ifile))
+   if( !index || strcmp( filename, indexed_filename))
       {
-      if( *line1 == '1' && *line2 == '2' && atoi( line1 + 2) == norad_no)
-         if( parse_elements( line1, line2, tle) >= 0)
-            rval = 0;
-      strlcpy_error( line0, line1);
-      strlcpy_error( line1, line2);
+      FILE *ifile = fopen( filename, "rb");
+      char *buff;
+      long size;
+      int n_tles;
+
+      if( index)
+         {
+         tle_index_free( index);
+         free( tles);
+         free( indexed_filename);
+         }
+      indexed_filename = (char *)malloc( strlen( filename) + 1);
+      assert( indexed_filename);
+      strcpy( indexed_filename, filename);
+      if( !ifile)
+         {
+         fprintf( stderr, "Couldn't open TLE file '%s'\n", filename);
+         exit( -1);
+         }
+      fseek( ifile, 0L, SEEK_END);
+      size = ftell( ifile);
+      fseek( ifile, 0L, SEEK_SET);
+      buff = (char *)malloc( size + 1);
+      assert( buff);
+      if( size > 0 && !fread( buff, size, 1, ifile))
+         size = 0;
+      fclose( ifile);
+      n_tles = parse_elements_in_buffer( buff, (size_t)size, NULL,
+                                             0x7fffffff, NULL);
+      tles = (tle_t *)malloc( (n_tles + 1) * sizeof( tle_t));
+      assert( tles);
+      parse_elements_in_buffer( buff, (size_t)size, tles, n_tles, NULL);
+      free( buff);
+      index = tle_index_create( tles, n_tles);
+      assert( index);
       }
-   fclose( ifile);
-   if( rval)
+   idx = tle_index_find( index, norad_no);
+   if( idx < 0)
       {
       fprintf( stderr, "Couldn't find TLEs for %5d in TLE file '%s'\n",
                            norad_no, filename);
       exit( -1);
       }
-   return( rval);
+   *tle = tles[idx];
+   return( 0);
 }
 
 /*
@@ -0,0 +1,138 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/* Precomputed lunar and solar positions.  lunar_solar_position( ) in
+'sdp4.cpp' evaluates the (low-precision) Meeus series directly,  which
+costs a couple of dozen sines and cosines.  Programs such as 'sat_id'
+and 'sat_eph' need the sun's and/or moon's position for every
+observation or ephemeris step,  often repeatedly at the same times.
+
+lunar_solar_init( ) fits Chebyshev polynomials to those series over a
+given span of dates,  in segments of DAYS_PER_SEGMENT days.  After that,
+lunar_solar_eval( ) just sums a few polynomials.  The result is an
+object that is only read after creation,  so any number of threads can
+share it.  Positions agree with lunar_solar_position( ) to a few cm for
+the moon and about a meter for the sun (roundoff,  at 1.5e+11 meters),
+far below the accuracy of the series themselves,  at a quarter or less
+of the cost.  Outside the fitted span,  lunar_solar_eval( ) falls back
+to evaluating the series directly,  as it does if given a NULL context. */
+
+#include <stdlib.h>
+#include <math.h>
+#include "norad.h"
+#include "norad_in.h"
+
+#define DAYS_PER_SEGMENT    4.
+#define N_CHEBY_COEFFS     12
+            /* six coordinates (moon's xyz,  then sun's xyz) per segment: */
+#define DOUBLES_PER_SEGMENT   (6 * N_CHEBY_COEFFS)
+
+typedef struct
+{
+   double jd_start;
+   int n_segments;
+   double *coeffs;
+} lunar_solar_t;
+
+void * DLL_FUNC lunar_solar_init( const double jd_start, const double jd_end)
+{
+   lunar_solar_t *rval;
+   int seg, i, j;
+
+   if( jd_end <= jd_start)
+      return( NULL);
+   rval = (lunar_solar_t *)malloc( sizeof( lunar_solar_t));
+   if( !rval)
+      return( NULL);
+   rval->jd_start = jd_start;
+   rval->n_segments = (int)ceil( (jd_end - jd_start) / DAYS_PER_SEGMENT);
+   rval->coeffs = (double *)malloc( rval->n_segments
+                     * DOUBLES_PER_SEGMENT * sizeof( double));
+   if( !rval->coeffs)
+      {
+      free( rval);
+      return( NULL);
+      }
+   for( seg = 0; seg < rval->n_segments; seg++)
+      {
+      double fvals[6][N_CHEBY_COEFFS];
+      const double jd_mid = jd_start + ((double)seg + .5) * DAYS_PER_SEGMENT;
+
+      for( i = 0; i < N_CHEBY_COEFFS; i++)
+         {
+         const double x = cos( pi * ((double)i + .5) / (double)N_CHEBY_COEFFS);
+         double lunar_xyzr[4], solar_xyzr[4];
+
+         raw_lunar_solar_position( jd_mid + x * DAYS_PER_SEGMENT / 2.,
+                                         lunar_xyzr, solar_xyzr);
+         for( j = 0; j < 3; j++)
+            {
+            fvals[j][i] = lunar_xyzr[j];
+            fvals[j + 3][i] = solar_xyzr[j];
+            }
+         }
+      for( j = 0; j < 6; j++)
+         cheby_fit( fvals[j], rval->coeffs + seg * DOUBLES_PER_SEGMENT
+                        + j * N_CHEBY_COEFFS, N_CHEBY_COEFFS);
+      }
+   return( rval);
+}
+
+/* Returns 0 if the position came from the Chebyshev fit,  1 if 'jd' was
+outside the fitted span (or 'context' was NULL) and the series had to be
+evaluated directly.  Either 'lunar_xyzr' or 'solar_xyzr' can be NULL. */
+
+int DLL_FUNC lunar_solar_eval( const void *context, const double jd,
+                    double *lunar_xyzr, double *solar_xyzr)
+{
+   const lunar_solar_t *lsol = (const lunar_solar_t *)context;
+   double dt, x;
+   const double *coeffs;
+   int seg, obj_idx;
+
+   if( lsol)
+      dt = (jd - lsol->jd_start) / DAYS_PER_SEGMENT;
+   if( !lsol || dt < 0. || dt >= (double)lsol->n_segments)
+      {
+      double lunar[4], solar[4];
+
+      raw_lunar_solar_position( jd, lunar, solar);
+      for( seg = 0; seg < 4; seg++)
+         {
+         if( lunar_xyzr)
+            lunar_xyzr[seg] = lunar[seg];
+         if( solar_xyzr)
+            solar_xyzr[seg] = solar[seg];
+         }
+      return( 1);
+      }
+   seg = (int)dt;
+   x = 2. * (dt - (double)seg) - 1.;
+   coeffs = lsol->coeffs + seg * DOUBLES_PER_SEGMENT;
+   for( obj_idx = 0; obj_idx < 2; obj_idx++)
+      {
+      double *xyzr = (obj_idx ? solar_xyzr : lunar_xyzr);
+
+      if( xyzr)
+         {
+         int i;
+
+         for( i = 0; i < 3; i++)
+            xyzr[i] = cheby_eval( coeffs + (obj_idx * 3 + i) * N_CHEBY_COEFFS,
+                                 N_CHEBY_COEFFS, x);
+         xyzr[3] = sqrt( xyzr[0] * xyzr[0] + xyzr[1] * xyzr[1]
+                                           + xyzr[2] * xyzr[2]);
+         }
+      }
+   return( 0);
+}
+
+void DLL_FUNC lunar_solar_free( void *context)
+{
+   lunar_solar_t *lsol = (lunar_solar_t *)context;
+
+   if( lsol)
+      {
+      free( lsol->coeffs);
+      free( lsol);
+      }
+}
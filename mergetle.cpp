@@ -7,30 +7,58 @@ orbital period,  etc.)   */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
+#if !defined( _WIN32) && !defined( __WATCOMC__)
+   #include <unistd.h>
+   #include <pthread.h>
+   #define USE_PTHREADS
+#endif
+#include "norad.h"
 
 #define TLE struct tle
-#define MAX_TLES 200000
+#define DEFAULT_RUN_SIZE 100000
 
-/* As of late 2020,  NORAD numbers are stored in five digits.  There's
-some possibility of that being bumped up to nine digits,  in which
-case I'll have to revisit this code.         */
+/* Duplicates are found with a tle_index (see 'tle_idx.cpp'),  keyed by
+the full NORAD number as decoded by parse_elements( ),  so that Alpha-5
+and Super-5 numbers past 99999 work.
 
-#define MAX_NORAD_NUMBER 100000
+   The sort key for each TLE is computed once,  when it's read,  and
+packed into a pair of unsigned 64-bit integers (see set_sort_key( )),  so
+that comparisons never look at the text again.  Ties are broken by the
+order in which TLEs were read ('seq'),  so sorting is stable. */
 
 TLE
    {
    char name_line[80], line1[80], line2[80];
+   int norad_number;
+   uint64_t sort_key, sort_key2;
+   long seq;
    };
 
-int n_duplicates = 0, heavens_above_html_tles = 0;
+int n_duplicates = 0, heavens_above_html_tles = 0, strip_names = 0;
+
+/* Gets the NORAD number and international designation as decoded by
+parse_elements( ).  If the lines can't be parsed,  we fall back to reading
+the number as a plain integer.  */
 
-int load_tles_from_file( FILE *ifile, TLE *tles, char *already_found)
+static void get_ids( const char *line1, const char *line2, tle_t *tle)
 {
-   int rval = 0;
-   char buff[80], prev_line[80];
+   if( parse_elements( line1, line2, tle) < 0)
+      {
+      tle->norad_number = atoi( line1 + 2);
+      memcpy( tle->intl_desig, line1 + 9, 8);
+      tle->intl_desig[8] = '\0';
+      }
+}
+
+/* Reads the next TLE from 'ifile',  with the line before it as its name.
+'prev_line' must be kept between calls.  Returns 0 at the end of the file. */
+
+static int read_next_tle( FILE *ifile, TLE *tle, tle_t *ids, char *prev_line)
+{
+   char buff[80];
 
-   *prev_line = '\0';
    while( fgets( buff, sizeof( buff), ifile))
       {
       if( *buff == '1' && heavens_above_html_tles &&
@@ -39,48 +67,30 @@ int load_tles_from_file( FILE *ifile, TLE *tles, char *already_found)
       if( *buff == '1' && strlen( buff) > 69 && buff[69] < ' ')
          {
          char buff2[80];
-         const int norad_number = atoi( buff + 2);
 
          if( fgets( buff2, sizeof( buff2), ifile))
             if( *buff2 == '2' && strlen( buff2) > 69 && buff2[69] < ' ')
                {
-               if( !already_found[norad_number])
-                  {
-                  if( heavens_above_html_tles)     /* can't use HA names */
-                     *prev_line = '\0';
-                  strcpy( tles[rval].name_line, prev_line);
-                  strcpy( tles[rval].line1, buff);
-                  strcpy( tles[rval].line2, buff2);
-                  already_found[norad_number] = 1;
-                  rval++;
-                  *buff = '\0';
-                  }
-               else
-                  n_duplicates++;
+               get_ids( buff, buff2, ids);
+               if( heavens_above_html_tles || strip_names)
+                  *prev_line = '\0';      /* can't use HA names */
+               strcpy( tle->name_line, prev_line);
+               strcpy( tle->line1, buff);
+               strcpy( tle->line2, buff2);
+               tle->norad_number = ids->norad_number;
+               *prev_line = '\0';
+               return( 1);
                }
          }
       strcpy( prev_line, buff);
       }
-   return( rval);
+   return( 0);
 }
 
-FILE *test_fopen( const char *filename, const char *permits)
+static void fail( const char *message)
 {
-   FILE *rval = fopen( filename, permits);
-
-   if( !rval)
-      {
-      printf( "%s not opened\n", filename);
-      exit( -1);
-      }
-   return( rval);
-}
-
-void show_tle( FILE *ofile, const TLE *tle)
-{
-   fprintf( ofile, "%s", tle->name_line);
-   fprintf( ofile, "%s", tle->line1);
-   fprintf( ofile, "%s", tle->line2);
+   fprintf( stderr, "%s\n", message);
+   exit( -1);
 }
 
 static double get_perigee( const TLE *tle)
@@ -92,90 +102,644 @@ static double get_perigee( const TLE *tle)
    return( semimajor * (1. - ecc));
 }
 
-static int compare_doubles( const char *buff1, const char *buff2)
+/* Maps a double to an unsigned integer in the same order.  For positive
+values,  setting the sign bit suffices;  negative ones are complemented. */
+
+static uint64_t double_key( const double value)
 {
-   const double d1 = atof( buff1);
-   const double d2 = atof( buff2);
-   int rval;
+   uint64_t rval;
 
-   if( d1 < d2)
-      rval = -1;
-   else if( d1 > d2)
-      rval = 1;
-   else
-      rval = 0;
-   return( rval);
+   memcpy( &rval, &value, sizeof( rval));
+   if( rval >> 63)
+      return( ~rval);
+   return( rval | ((uint64_t)1 << 63));
 }
 
-int tle_compare( const TLE *tle1, const TLE *tle2, const char sort_method)
+/* Packs up to eight characters into an integer that sorts as memcmp( )
+would sort the text. */
+
+static uint64_t text_key( const char *text, const int n_bytes)
+{
+   uint64_t rval = 0;
+   int i;
+
+   for( i = 0; i < n_bytes; i++)
+      rval = (rval << 8) | (unsigned char)text[i];
+   return( rval << (8 * (8 - n_bytes)));
+}
+
+/* 'YYDDD.DDDDDDDD' becomes YYYYDDDDDDDDDDD as an integer,  so that 1999
+sorts before 2000 and equal keys mean equal epoch text. */
+
+static uint64_t epoch_key( const char *epoch)
 {
-   int i, rval = 0;
+   const int year = (epoch[0] - '0') * 10 + epoch[1] - '0';
+   uint64_t rval = (uint64_t)(year + (year >= 57 ? 1900 : 2000));
+   int i;
+
+   for( i = 2; i < 14; i++)
+      if( i != 5)
+         rval = rval * 10 + (uint64_t)(epoch[i] - '0') % 10;
+   return( rval);
+}
+
+/* Sets 'sort_key' and 'sort_key2' for the given sort method.  For
+descending sorts,  the keys are complemented,  so every sort is just
+an ascending sort on (sort_key, sort_key2, seq).  For NORAD number sorts,
+the epoch breaks ties;  that puts TLEs for the same object and epoch
+next to each other in the streaming mode.  */
 
+static void set_sort_key( TLE *tle, const char sort_method)
+{
+   tle->sort_key = tle->sort_key2 = 0;
    switch( sort_method)
       {
       case 'n': case 'N':        /* sort by NORAD number */
-         rval = atoi( tle1->line1 + 2) - atoi( tle2->line1 + 2);
+         tle->sort_key = (uint64_t)(uint32_t)tle->norad_number;
+         tle->sort_key2 = epoch_key( tle->line1 + 18);
+         break;
+      case 'p': case 'P':        /* sort by epoch */
+         tle->sort_key = epoch_key( tle->line1 + 18);
          break;
       case 'c': case 'C':        /* sort by COSPAR (international) desig */
-         if( tle1->line1[9] >= '5' && tle2->line1[9] < '5')
-            rval = -1;
-         else if( tle2->line1[9] >= '5' && tle1->line1[9] < '5')
-            rval = 1;
-         else        /* COSPAR IDs are from the same century */
-            rval = memcmp( tle1->line1 + 9, tle2->line1 + 9, 8);
+         tle->sort_key = ((uint64_t)(tle->line1[9] >= '5' ? 0 : 1) << 56)
+                                  | (text_key( tle->line1 + 9, 7) >> 8);
+         tle->sort_key2 = text_key( tle->line1 + 16, 1);
          break;
       case 'm': case 'M':        /* sort by mean motion */
-         rval = compare_doubles( tle1->line2 + 52, tle2->line2 + 52);
+         tle->sort_key = double_key( atof( tle->line2 + 52));
          break;
       case 'e': case 'E':        /* sort by eccentricity */
-         for( i = 26; !rval && i < 33; i++)
-            rval = tle1->line2[i] - tle2->line2[i];
-         break;
-      case 'p': case 'P':        /* sort by epoch */
-         for( i = 18; !rval && i < 32; i++)
-            rval = tle1->line1[i] - tle2->line1[i];
+         tle->sort_key = text_key( tle->line2 + 26, 7);
          break;
       case 'i': case 'I':        /* sort by incl */
-         rval = compare_doubles( tle1->line2 + 8, tle2->line2 + 8);
+         tle->sort_key = double_key( atof( tle->line2 + 8));
          break;
       case 'o': case 'O':        /* sort by ascending node */
-         rval = compare_doubles( tle1->line2 + 17, tle2->line2 + 17);
+         tle->sort_key = double_key( atof( tle->line2 + 17));
          break;
       case 'q':
+         tle->sort_key = double_key( get_perigee( tle));
+         break;
+      }
+   if( sort_method >= 'A' && sort_method <= 'Z')
+      {
+      tle->sort_key = ~tle->sort_key;
+      tle->sort_key2 = ~tle->sort_key2;
+      }
+}
+
+/* Sorting is done on an array of these,  rather than on the (much larger)
+TLEs themselves.  Since the keys already include the sort direction,  one
+comparison function serves for every sort method.  */
+
+typedef struct
+   {
+   uint64_t key, key2;
+   long seq;
+   int index;
+   } sort_item_t;
+
+static int compare_items( const void *a, const void *b)
+{
+   const sort_item_t *item1 = (const sort_item_t *)a;
+   const sort_item_t *item2 = (const sort_item_t *)b;
+
+   if( item1->key != item2->key)
+      return( item1->key > item2->key ? 1 : -1);
+   if( item1->key2 != item2->key2)
+      return( item1->key2 > item2->key2 ? 1 : -1);
+   return( (item1->seq > item2->seq) - (item1->seq < item2->seq));
+}
+
+static int tle_compare( const TLE *tle1, const TLE *tle2)
+{
+   sort_item_t item1, item2;
+
+   item1.key = tle1->sort_key;
+   item1.key2 = tle1->sort_key2;
+   item1.seq = tle1->seq;
+   item2.key = tle2->sort_key;
+   item2.key2 = tle2->sort_key2;
+   item2.seq = tle2->seq;
+   return( compare_items( &item1, &item2));
+}
+
+/* The items are (key, key2, seq) triples of unsigned integers,  so they
+can be radix-sorted :  a stable counting sort on each byte,  from the
+least significant byte of 'seq' to the most significant one of 'key'.
+Histograms for all 24 bytes are gathered in one pass;  bytes that are
+the same for every item (most of 'key2' and 'seq',  usually) are skipped.
+The result ends up in 'items';  'temp' must have room for n_items.  */
+
+#define N_RADIX_BYTES   24
+
+static unsigned radix_byte( const sort_item_t *item, const int byte_no)
+{
+   const uint64_t value = (byte_no < 8 ? (uint64_t)item->seq :
+                           (byte_no < 16 ? item->key2 : item->key));
+
+   return( (unsigned)( value >> ((byte_no % 8) * 8)) & 0xff);
+}
+
+static void radix_sort_items( sort_item_t *items, sort_item_t *temp,
+                                 const size_t n_items)
+{
+   size_t counts[N_RADIX_BYTES][256], i;
+   sort_item_t *src = items, *dest = temp;
+   int byte_no;
+
+   memset( counts, 0, sizeof( counts));
+   for( i = 0; i < n_items; i++)
+      {
+      uint64_t value = (uint64_t)items[i].seq;
+
+      for( byte_no = 0; byte_no < N_RADIX_BYTES; byte_no++, value >>= 8)
          {
-         const double q1 = get_perigee( tle1);
-         const double q2 = get_perigee( tle2);
+         if( byte_no == 8)
+            value = items[i].key2;
+         else if( byte_no == 16)
+            value = items[i].key;
+         counts[byte_no][value & 0xff]++;
+         }
+      }
+   for( byte_no = 0; byte_no < N_RADIX_BYTES; byte_no++)
+      if( n_items && counts[byte_no][radix_byte( items, byte_no)] != n_items)
+         {
+         size_t *count = counts[byte_no], total = 0;
+         sort_item_t *tptr;
+
+         for( i = 0; i < 256; i++)
+            {
+            const size_t n = count[i];
+
+            count[i] = total;
+            total += n;
+            }
+         for( i = 0; i < n_items; i++)
+            dest[count[radix_byte( src + i, byte_no)]++] = src[i];
+         tptr = src;
+         src = dest;
+         dest = tptr;
+         }
+   if( src != items)
+      memcpy( items, src, n_items * sizeof( sort_item_t));
+}
+
+/* A parallel sort :  each of 'n_threads' threads radix-sorts a slice of
+the items,  then pairs of slices are merged (again in parallel) until one
+is left.  Without POSIX threads,  or for small arrays,  there's just the
+one slice.  */
+
+#define MAX_SORT_THREADS      16
+#define MIN_ITEMS_PER_THREAD  20000
+
+typedef struct
+   {
+   sort_item_t *items, *temp;
+   size_t start, mid, end;
+   } sort_task_t;
+
+static void merge_slices( const sort_task_t *task)
+{
+   size_t i = task->start, j = task->mid, k = task->start;
+
+   while( i < task->mid && j < task->end)
+      if( compare_items( task->items + j, task->items + i) < 0)
+         task->temp[k++] = task->items[j++];
+      else
+         task->temp[k++] = task->items[i++];
+   while( i < task->mid)
+      task->temp[k++] = task->items[i++];
+   while( j < task->end)
+      task->temp[k++] = task->items[j++];
+   memcpy( task->items + task->start, task->temp + task->start,
+                  (task->end - task->start) * sizeof( sort_item_t));
+}
+
+#ifdef USE_PTHREADS
+static void *sort_slice_thread( void *arg)
+{
+   const sort_task_t *task = (const sort_task_t *)arg;
+
+   radix_sort_items( task->items + task->start, task->temp + task->start,
+                  task->end - task->start);
+   return( NULL);
+}
+
+static void *merge_slices_thread( void *arg)
+{
+   merge_slices( (const sort_task_t *)arg);
+   return( NULL);
+}
+
+static int n_sort_threads( const size_t n_items)
+{
+   const long n_cpus = sysconf( _SC_NPROCESSORS_ONLN);
+   int rval = 1;
 
-         rval = ( q1 > q2 ? 1 : -1);
+   while( rval * 2 <= n_cpus && rval * 2 <= MAX_SORT_THREADS
+                 && (size_t)rval * 2 * MIN_ITEMS_PER_THREAD <= n_items)
+      rval *= 2;
+   return( rval);
+}
+
+/* Runs 'func' on each task in its own thread.  If a thread can't be
+started,  we just run that task on this one.  */
+
+static void run_tasks( sort_task_t *tasks, const int n_tasks,
+                           void *(*func)( void *))
+{
+   pthread_t threads[MAX_SORT_THREADS];
+   int started[MAX_SORT_THREADS], i;
+
+   for( i = 0; i < n_tasks; i++)
+      started[i] = !pthread_create( threads + i, NULL, func, tasks + i);
+   for( i = 0; i < n_tasks; i++)
+      if( started[i])
+         pthread_join( threads[i], NULL);
+      else
+         func( tasks + i);
+}
+#endif
+
+static void sort_items( sort_item_t *items, const size_t n_items)
+{
+   sort_item_t *temp = (sort_item_t *)malloc( n_items * sizeof( sort_item_t));
+#ifdef USE_PTHREADS
+   const int n_threads = n_sort_threads( n_items);
+
+   if( temp && n_threads > 1)
+      {
+      sort_task_t tasks[MAX_SORT_THREADS];
+      size_t bounds[MAX_SORT_THREADS + 1];
+      int i, n_slices = n_threads;
+
+      for( i = 0; i <= n_threads; i++)
+         bounds[i] = n_items * (size_t)i / (size_t)n_threads;
+      for( i = 0; i < n_threads; i++)
+         {
+         tasks[i].items = items;
+         tasks[i].temp = temp;
+         tasks[i].start = bounds[i];
+         tasks[i].end = bounds[i + 1];
          }
+      run_tasks( tasks, n_threads, sort_slice_thread);
+      while( n_slices > 1)
+         {
+         for( i = 0; i < n_slices / 2; i++)
+            {
+            tasks[i].start = bounds[i * 2];
+            tasks[i].mid = bounds[i * 2 + 1];
+            tasks[i].end = bounds[i * 2 + 2];
+            }
+         run_tasks( tasks, n_slices / 2, merge_slices_thread);
+         n_slices /= 2;
+         for( i = 0; i <= n_slices; i++)
+            bounds[i] = bounds[i * 2];
+         }
+      free( temp);
+      return;
+      }
+#endif
+   if( temp)
+      radix_sort_items( items, temp, n_items);
+   else        /* not enough memory for the radix sort */
+      qsort( items, n_items, sizeof( sort_item_t), compare_items);
+   free( temp);
+}
+
+/* Returns an array giving the sorted order of the 'n_tles' TLEs.  */
+
+static int *sort_tles( const TLE *tles, const int n_tles)
+{
+   sort_item_t *items = (sort_item_t *)malloc( n_tles * sizeof( sort_item_t));
+   int *order = (int *)malloc( n_tles * sizeof( int));
+   int i;
+
+   if( !items || !order)
+      fail( "Out of memory sorting TLEs");
+   for( i = 0; i < n_tles; i++)
+      {
+      items[i].key = tles[i].sort_key;
+      items[i].key2 = tles[i].sort_key2;
+      items[i].seq = tles[i].seq;
+      items[i].index = i;
+      }
+   sort_items( items, (size_t)n_tles);
+   for( i = 0; i < n_tles; i++)
+      order[i] = items[i].index;
+   free( items);
+   return( order);
+}
+
+FILE *test_fopen( const char *filename, const char *permits)
+{
+   FILE *rval = fopen( filename, permits);
+
+   if( !rval)
+      {
+      printf( "%s not opened\n", filename);
+      exit( -1);
+      }
+   return( rval);
+}
+
+void show_tle( FILE *ofile, const TLE *tle)
+{
+   fprintf( ofile, "%s", tle->name_line);
+   fprintf( ofile, "%s", tle->line1);
+   fprintf( ofile, "%s", tle->line2);
+}
+
+/* The streaming ('-x') mode,  for archives too big to fit in memory.  TLEs
+are gathered into runs of 'run_size' TLEs;  each run is sorted and written
+to a temporary file as raw TLE structs (sort keys included).  Whenever
+MERGE_WAY runs pile up at a given level,  they're merged into one run at
+the next level up,  so at most MERGE_WAY * MAX_LEVELS temporary files are
+open at once,  and each TLE is rewritten about log(n_runs) / log(MERGE_WAY)
+times.  At the end,  all remaining runs are merged in one pass.
+
+   Deduplication happens in a first pass,  sorted by NORAD number and
+epoch:  copies of the same TLE are then adjacent,  and the one read first
+is kept.  If some other sort order was requested,  the deduplicated TLEs
+are fed to a second sorter,  still carrying their original 'seq' values,
+so ties come out in input order just as they would in memory.  Memory use
+is fixed by 'run_size',  however big the input is.  */
+
+#define MERGE_WAY       16
+#define MAX_LEVELS       8
+
+typedef void (*tle_sink_t)( const TLE *tle, void *context);
+
+typedef struct
+   {
+   TLE *buff;
+   int n_buff, run_size;
+   char sort_method;
+   FILE *runs[MAX_LEVELS][MERGE_WAY];
+   int n_runs[MAX_LEVELS];
+   } sorter_t;
+
+static void write_tle_to_run( const TLE *tle, void *context)
+{
+   if( fwrite( tle, sizeof( TLE), 1, (FILE *)context) != 1)
+      fail( "Error writing temporary file");
+}
+
+static void sift_down( int *heap, const int n_heap, int i, const TLE *curr)
+{
+   const int item = heap[i];
+
+   while( 2 * i + 1 < n_heap)
+      {
+      int child = 2 * i + 1;
+
+      if( child + 1 < n_heap
+                  && tle_compare( curr + heap[child + 1], curr + heap[child]) < 0)
+         child++;
+      if( tle_compare( curr + heap[child], curr + item) >= 0)
          break;
+      heap[i] = heap[child];
+      i = child;
       }
-   if( sort_method >= 'A' && sort_method <= 'Z')
-      rval = -rval;
+   heap[i] = item;
+}
+
+/* Merges 'n_runs' sorted runs,  passing each TLE in order to 'sink';  the
+run files are closed (and therefore deleted) afterward.  */
+
+static void merge_runs( FILE **runs, const int n_runs, tle_sink_t sink,
+                  void *context)
+{
+   TLE *curr = (TLE *)malloc( n_runs * sizeof( TLE));
+   int *heap = (int *)malloc( n_runs * sizeof( int));
+   int n_heap = 0, i;
+
+   if( !curr || !heap)
+      fail( "Out of memory merging runs");
+   for( i = 0; i < n_runs; i++)
+      {
+      rewind( runs[i]);
+      if( fread( curr + i, sizeof( TLE), 1, runs[i]) == 1)
+         heap[n_heap++] = i;
+      }
+   for( i = n_heap / 2 - 1; i >= 0; i--)
+      sift_down( heap, n_heap, i, curr);
+   while( n_heap)
+      {
+      const int top = heap[0];
+
+      sink( curr + top, context);
+      if( fread( curr + top, sizeof( TLE), 1, runs[top]) != 1)
+         heap[0] = heap[--n_heap];
+      sift_down( heap, n_heap, 0, curr);
+      }
+   for( i = 0; i < n_runs; i++)
+      fclose( runs[i]);
+   free( curr);
+   free( heap);
+}
+
+static void add_run( sorter_t *sorter, FILE *run, const int level)
+{
+   sorter->runs[level][sorter->n_runs[level]++] = run;
+   if( sorter->n_runs[level] == MERGE_WAY)
+      {
+      FILE *merged = tmpfile( );
+
+      if( level == MAX_LEVELS - 1)
+         fail( "Too many runs;  try a larger run size");
+      if( !merged)
+         fail( "Couldn't create a temporary file");
+      merge_runs( sorter->runs[level], MERGE_WAY, write_tle_to_run, merged);
+      sorter->n_runs[level] = 0;
+      add_run( sorter, merged, level + 1);
+      }
+}
+
+static void spill_run( sorter_t *sorter)
+{
+   FILE *run = tmpfile( );
+   int *order, i;
+
+   if( !run)
+      fail( "Couldn't create a temporary file");
+   order = sort_tles( sorter->buff, sorter->n_buff);
+   for( i = 0; i < sorter->n_buff; i++)
+      write_tle_to_run( sorter->buff + order[i], run);
+   free( order);
+   sorter->n_buff = 0;
+   add_run( sorter, run, 0);
+}
+
+static sorter_t *sorter_create( const int run_size, const char sort_method)
+{
+   sorter_t *rval = (sorter_t *)calloc( 1, sizeof( sorter_t));
+
+   if( rval)
+      rval->buff = (TLE *)malloc( run_size * sizeof( TLE));
+   if( !rval || !rval->buff)
+      fail( "Out of memory allocating run buffer");
+   rval->run_size = run_size;
+   rval->sort_method = sort_method;
    return( rval);
 }
 
-      /* MS Windows lacks the re-entrant qsort_r;  we have to use  */
-      /* plain old non-re-entrant qsort and a global variable.     */
-      /* BSD has it,  but with the wrong order of arguments.       */
-#ifdef __linux
-#define HAVE_REENTRANT_QSORT
-#endif
+static void sorter_add( sorter_t *sorter, const TLE *tle)
+{
+   TLE *new_tle = sorter->buff + sorter->n_buff++;
 
-#ifdef HAVE_REENTRANT_QSORT
-int tle_compare_for_qsort_r( const void *a, const void *b, void *c)
+   *new_tle = *tle;
+   set_sort_key( new_tle, sorter->sort_method);
+   if( sorter->n_buff == sorter->run_size)
+      spill_run( sorter);
+}
+
+/* Passes all TLEs added to the sorter to 'sink',  in sorted order,  then
+frees the sorter.  If everything fit in one run,  no temporary files are
+used at all.  */
+
+static void sorter_finish( sorter_t *sorter, tle_sink_t sink, void *context)
 {
-   return( tle_compare( (const TLE *)a, (const TLE *)b, *(char *)c));
+   FILE *runs[MAX_LEVELS * MERGE_WAY];
+   int i, n_runs = 0;
+
+   for( i = 0; i < MAX_LEVELS; i++)
+      n_runs += sorter->n_runs[i];
+   if( !n_runs)
+      {
+      int *order = sort_tles( sorter->buff, sorter->n_buff);
+
+      for( i = 0; i < sorter->n_buff; i++)
+         sink( sorter->buff + order[i], context);
+      free( order);
+      }
+   else
+      {
+      if( sorter->n_buff)
+         spill_run( sorter);
+      n_runs = 0;
+      for( i = 0; i < MAX_LEVELS; i++)
+         {
+         memcpy( runs + n_runs, sorter->runs[i], sorter->n_runs[i] * sizeof( FILE *));
+         n_runs += sorter->n_runs[i];
+         }
+      merge_runs( runs, n_runs, sink, context);
+      }
+   free( sorter->buff);
+   free( sorter);
 }
-#else
-static char comparison_method;
 
-int tle_compare_for_qsort( const void *a, const void *b)
+typedef struct
+   {
+   FILE *ofile;
+   sorter_t *next;         /* NULL if output is already in final order */
+   TLE prev;
+   long n_written, n_duplicates;
+   } dedup_t;
+
+static void dedup_tle( const TLE *tle, void *context)
 {
-   return( tle_compare( (const TLE *)a, (const TLE *)b, comparison_method));
+   dedup_t *dedup = (dedup_t *)context;
+
+   if( dedup->n_written && tle->sort_key == dedup->prev.sort_key
+                        && tle->sort_key2 == dedup->prev.sort_key2)
+      dedup->n_duplicates++;
+   else
+      {
+      dedup->prev = *tle;
+      dedup->n_written++;
+      if( dedup->next)
+         sorter_add( dedup->next, tle);
+      else
+         show_tle( dedup->ofile, tle);
+      }
 }
-#endif
 
+static void output_tle( const TLE *tle, void *context)
+{
+   show_tle( (FILE *)context, tle);
+}
+
+static void streaming_merge( const int argc, const char **argv,
+            const int run_size, const char sort_method, FILE *ofile)
+{
+   sorter_t *sorter = sorter_create( run_size, 'n');
+   dedup_t dedup;
+   long seq = 0;
+   int i;
+
+   memset( &dedup, 0, sizeof( dedup));
+   dedup.ofile = ofile;
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] != '-')
+         {
+         FILE *ifile = test_fopen( argv[i], "rb");
+         char prev_line[80];
+         const long prev_seq = seq;
+         TLE tle;
+         tle_t ids;
+
+         *prev_line = '\0';
+         while( read_next_tle( ifile, &tle, &ids, prev_line))
+            {
+            tle.seq = seq++;
+            sorter_add( sorter, &tle);
+            }
+         printf( "%ld TLEs read from %s\n", seq - prev_seq, argv[i]);
+         fclose( ifile);
+         }
+   if( sort_method != 'n')
+      dedup.next = sorter_create( run_size, sort_method);
+   sorter_finish( sorter, dedup_tle, &dedup);
+   if( dedup.next)
+      sorter_finish( dedup.next, output_tle, ofile);
+   printf( "%ld TLEs written,  with %ld duplicates removed\n",
+                  dedup.n_written, dedup.n_duplicates);
+}
+
+/* Adds TLEs from 'ifile' that aren't already in 'index' to the array
+'*tles',  which already holds 'n_prev' TLEs and is grown as needed.
+Returns the number of TLEs added.  */
+
+int load_tles_from_file( FILE *ifile, TLE **tles, int *n_alloced,
+                  void *index, const int n_prev, const char sort_method)
+{
+   int rval = 0;
+   char prev_line[80];
+   tle_t ids;
+
+   *prev_line = '\0';
+   for( ;;)
+      {
+      TLE *tle;
+      int prev_idx;
+
+      if( n_prev + rval == *n_alloced)
+         {
+         *n_alloced = *n_alloced * 2 + 1000;
+         *tles = (TLE *)realloc( *tles, *n_alloced * sizeof( TLE));
+         if( !*tles)
+            fail( "Too many TLEs to sort in memory;  try '-x'");
+         }
+      tle = *tles + n_prev + rval;
+      if( !read_next_tle( ifile, tle, &ids, prev_line))
+         break;
+      prev_idx = tle_index_add( index, &ids, n_prev + rval);
+      if( prev_idx == -2)
+         fail( "Out of memory indexing TLEs");
+      if( prev_idx == -1)           /* new NORAD number */
+         {
+         tle->seq = n_prev + rval;
+         set_sort_key( tle, sort_method);
+         rval++;
+         }
+      else
+         n_duplicates++;
+      }
+   return( rval);
+}
 
 static void error_exit( void)
 {
@@ -198,14 +762,18 @@ static void error_exit( void)
    printf( "-n             Remove names from input TLEs\n");
    printf( "-h             Remove HTML tags from input.  This allows you to extract\n");
    printf( "                 TLEs from certain Web pages.\n");
+   printf( "-x(n)          Streaming merge,  for archives too big for memory.  TLEs\n");
+   printf( "                 are sorted in runs of n (default %d) in temporary\n", DEFAULT_RUN_SIZE);
+   printf( "                 files,  then merged.  All epochs are kept;  only TLEs\n");
+   printf( "                 with the same NORAD number _and_ epoch are duplicates.\n");
    exit( -1);
 }
 
 int main( const int argc, const char **argv)
 {
-   TLE *tles = (TLE *)calloc( MAX_TLES, sizeof( TLE));
-   char *already_found = (char *)calloc( MAX_NORAD_NUMBER, sizeof( char));
-   int n_found = 0, i, strip_names = 0;
+   TLE *tles = NULL;
+   void *index;
+   int n_found = 0, n_alloced = 0, i, run_size = 0, *order;
    char sort_method = 0;
    const char *output_filename = "out.tle";
    FILE *ofile;
@@ -230,33 +798,46 @@ int main( const int argc, const char **argv)
                heavens_above_html_tles = 1;
                printf( "HTML tags will be removed from input\n");
                break;
+            case 'x':
+               run_size = atoi( argv[i] + 2);
+               if( run_size <= 0)
+                  run_size = DEFAULT_RUN_SIZE;
+               break;
             default:
                printf( "Ignoring unknown option '%s'\n", argv[i]);
                break;
             }
-      else
+   if( run_size)
+      {
+      ofile = test_fopen( output_filename, "wb");
+      streaming_merge( argc, argv, run_size, sort_method, ofile);
+      fclose( ofile);
+      return( 0);
+      }
+   index = tle_index_create( NULL, 0);
+   if( !index)
+      fail( "Out of memory indexing TLEs");
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] != '-')
          {
          FILE *ifile = test_fopen( argv[i], "rb");
          int n;
 
          n_duplicates = 0;
-         n = load_tles_from_file( ifile, tles + n_found, already_found);
+         n = load_tles_from_file( ifile, &tles, &n_alloced, index, n_found,
+                                             sort_method);
          printf( "%d TLEs added from %s,  with %d duplicates found\n",
                             n, argv[i], n_duplicates);
          n_found += n;
          fclose( ifile);
          }
-   free( already_found);
-   if( strip_names)
-      for( i = 0; i < n_found; i++)
-         tles[i].name_line[0] = '\0';
-#ifndef HAVE_REENTRANT_QSORT
-   comparison_method = sort_method;
-   qsort( tles, n_found, sizeof( TLE), tle_compare_for_qsort);
-#else
-   qsort_r( tles, n_found, sizeof( TLE), tle_compare_for_qsort_r, &sort_method);
-#endif
+   tle_index_free( index);
+   order = sort_tles( tles, n_found);
    ofile = test_fopen( output_filename, "wb");
    for( i = 0; i < n_found; i++)
-      show_tle( ofile, tles + i);
+      show_tle( ofile, tles + order[i]);
+   fclose( ofile);
+   free( order);
+   free( tles);
+   return( 0);
 }
@@ -1,7 +1,8 @@
 # Makefile for MSVC
 all:  dropouts.exe fix_tles.exe line2.exe mergetle.exe obs_test.exe \
-   obs_tes2.exe out_comp.exe sat_eph.exe sat_id.exe  \
-   test2.exe test_out.exe test_sat.exe tle2mpc.exe
+   obs_tes2.exe out_comp.exe sat_bench.exe sat_eph.exe sat_id.exe  \
+   test2.exe test_bat.exe test_mrg.exe test_out.exe test_sat.exe tle2cat.exe \
+   tle2cheb.exe tle2mpc.exe
 
 COMMON_FLAGS=-nologo -W3 -EHsc -c -FD -D_CRT_SECURE_NO_WARNINGS
 RM=del
@@ -16,7 +17,8 @@ CFLAGS=-MT -O1 -D "NDEBUG" $(COMMON_FLAGS)
 LINK=link /nologo /stack:0x8800
 
 OBJS= sgp.obj sgp4.obj sgp8.obj sdp4.obj sdp8.obj deep.obj \
-     basics.obj get_el.obj common.obj tle_out.obj
+     basics.obj get_el.obj common.obj tle_out.obj lun_sol.obj \
+     cheb_eph.obj sat_cat.obj tle_idx.obj
 
 dropouts.exe: dropouts.obj
    $(LINK) dropouts.obj
@@ -27,8 +29,8 @@ fix_tles.exe: fix_tles.obj sat_code$(BITS).lib
 line2.exe: line2.obj observe.obj sat_code$(BITS).lib
    $(LINK) line2.obj observe.obj sat_code$(BITS).lib lunar$(BITS).lib
 
-mergetle.exe: mergetle.obj
-   $(LINK) mergetle.obj
+mergetle.exe: mergetle.obj sat_code$(BITS).lib
+   $(LINK) mergetle.obj sat_code$(BITS).lib
 
 obs_test.exe: obs_test.obj observe.obj sat_code$(BITS).lib
    $(LINK)    obs_test.obj observe.obj sat_code$(BITS).lib
@@ -43,21 +45,36 @@ sat_code$(BITS).lib: $(OBJS)
    del sat_code$(BITS).lib
    lib /OUT:sat_code$(BITS).lib $(OBJS)
 
-sat_id.exe: sat_id.obj sat_util.obj observe.obj sat_code$(BITS).lib
-   $(LINK)  sat_id.obj sat_util.obj observe.obj sat_code$(BITS).lib lunar$(BITS).lib
+sat_bench.exe: sat_bench.obj sat_code$(BITS).lib
+   $(LINK)    sat_bench.obj sat_code$(BITS).lib
 
-sat_eph.exe: sat_eph.obj sat_util.obj observe.obj sat_code$(BITS).lib
-    $(LINK)  sat_eph.obj sat_util.obj observe.obj sat_code$(BITS).lib lunar$(BITS).lib
+sat_id.exe: sat_id.obj sat_util.obj gz_pipe.obj tle_tree.obj observe.obj sat_code$(BITS).lib
+   $(LINK)  sat_id.obj sat_util.obj gz_pipe.obj tle_tree.obj observe.obj sat_code$(BITS).lib lunar$(BITS).lib
+
+sat_eph.exe: sat_eph.obj sat_util.obj gz_pipe.obj tle_tree.obj observe.obj sat_code$(BITS).lib
+    $(LINK)  sat_eph.obj sat_util.obj gz_pipe.obj tle_tree.obj observe.obj sat_code$(BITS).lib lunar$(BITS).lib
 
 test2.exe: test2.obj sat_code$(BITS).lib
    $(LINK) test2.obj sat_code$(BITS).lib
 
+test_bat.exe: test_bat.obj sat_code$(BITS).lib
+   $(LINK)    test_bat.obj sat_code$(BITS).lib
+
+test_mrg.exe: test_mrg.obj
+   $(LINK)    test_mrg.obj
+
 test_out.exe: test_out.obj sat_code$(BITS).lib
    $(LINK)    test_out.obj sat_code$(BITS).lib
 
 test_sat.exe: test_sat.obj sat_code$(BITS).lib
    $(LINK)    test_sat.obj sat_code$(BITS).lib
 
+tle2cat.exe: tle2cat.obj sat_code$(BITS).lib
+   $(LINK)    tle2cat.obj sat_code$(BITS).lib
+
+tle2cheb.exe: tle2cheb.obj sat_code$(BITS).lib
+   $(LINK)    tle2cheb.obj sat_code$(BITS).lib
+
 tle2mpc.exe: tle2mpc.obj observe.obj sat_code$(BITS).lib
    $(LINK)   tle2mpc.obj observe.obj sat_code$(BITS).lib lunar$(BITS).lib
 
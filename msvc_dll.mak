@@ -22,16 +22,18 @@ obs_test.exe: obs_test.obj observe.obj sat_code.lib
 obs_tes2.exe: obs_tes2.obj observe.obj sat_code.lib
    cl -nologo obs_tes2.obj observe.obj sat_code.lib
 
-sat_id.exe:   sat_id.obj sat_util.obj sat_code.lib
-   cl -nologo sat_id.obj sat_util.obj sat_code.lib
+sat_id.exe:   sat_id.obj sat_util.obj gz_pipe.obj tle_tree.obj sat_code.lib
+   cl -nologo sat_id.obj sat_util.obj gz_pipe.obj tle_tree.obj sat_code.lib
 
 sat_code.lib: sgp.obj sgp4.obj sgp8.obj sdp4.obj sdp8.obj deep.obj \
-   basics.obj get_el.obj observe.obj common.obj
+   basics.obj get_el.obj observe.obj common.obj lun_sol.obj cheb_eph.obj \
+   sat_cat.obj tle_idx.obj
    del sat_code.lib
    del sat_code.dll
    link /DLL /IMPLIB:sat_code.lib /DEF:sat_code.def /MAP:sat_code.map \
             sgp.obj sgp4.obj sgp8.obj sdp4.obj sdp8.obj deep.obj \
-            basics.obj get_el.obj observe.obj common.obj
+            basics.obj get_el.obj observe.obj common.obj lun_sol.obj cheb_eph.obj \
+            sat_cat.obj tle_idx.obj
 
 sm_sat.dll: sgp4.obj basics.obj get_el.obj common.obj
    del sm_sat.lib
@@ -9,6 +9,8 @@
 #ifndef NORAD_H
 #define NORAD_H 1
 
+#include <stddef.h>        /* for size_t */
+
 /* #define RETAIN_PERTURBATION_VALUES_AT_EPOCH 1 */
 
 /* Two-line-element satellite orbital data */
@@ -40,6 +42,9 @@ typedef struct
 #define N_SDP4_PARAMS        (10 + DEEP_ARG_T_PARAMS)
 #define N_SDP8_PARAMS        (11 + DEEP_ARG_T_PARAMS)
 
+/* SGP4_batch_init( ) needs this many doubles _per satellite_ : */
+#define N_SGP4_BATCH_PARAMS   30
+
 /* 94 = maximum possible size of the 'deep_arg_t' structure,  in 8-byte units */
 /* You can use the above constants to minimize the amount of memory used,
    but if you use the following constant,  you can be assured of having
@@ -60,11 +65,51 @@ typedef struct
 #define TLE_EPHEMERIS_TYPE_SGP8              4
 #define TLE_EPHEMERIS_TYPE_SDP8              5
 
+/* The deep-space models (SDP4 and SDP8) carry some state from one call
+to the next:  where the resonance integrator left off,  and the most
+recently computed lunisolar perturbations.  SDP4( ) and SDP8( ) keep it
+within 'params',  so despite the 'const',  they modify 'params' and one
+set of params can't safely be shared between threads.  SDP4_r( ) and
+SDP8_r( ) keep it in a caller-supplied sxpx_state_t instead,  and don't
+write to 'params' at all;  each thread can have its own state for the
+same (read-only) params.  Set up the state with sxpx_init_state( ) after
+calling SDP4_init( ) or SDP8_init( ),  and otherwise treat it as opaque.
+Results are identical to those from SDP4( ) and SDP8( ),  given the same
+sequence of times.   */
+
+typedef struct
+{
+   double atime, xli, xni, savtsn;
+   double pe, pinc, pl, pgh, ph;
+} sxpx_state_t;
+
+/* Settings for the deep-space resonance integrator,  and whether to
+replicate the Dundee code's results exactly (at some cost in speed).
+These used to be process-wide,  set with sxpx_set_implementation_param( )
+and sxpx_set_dpsec_integration_step( ) and read during propagation.  Now
+SDP4_init( ) and SDP8_init( ) copy them into 'params',  so changing the
+process-wide settings only affects satellites initialized afterward.
+SDP4_init_with_config( ) and SDP8_init_with_config( ) let you give the
+settings explicitly,  so (say) Dundee-compliant validation and fast
+production runs can go on side by side,  in different threads.  Use
+sxpx_get_default_config( ) to get the current process-wide settings. */
+
+typedef struct
+{
+   double dpsec_integration_step;      /* in minutes;  default 720 */
+   int dpsec_integration_order;        /* default 2 */
+   int is_dundee_compliant;            /* default 0 */
+} sxpx_config_t;
+
 #define SXPX_DPSEC_INTEGRATION_ORDER         0
 #define SXPX_DUNDEE_COMPLIANCE               1
 #define SXPX_ZERO_PERTURBATIONS_AT_EPOCH     2
 
 
+         /* tle_validate( ) flag to also check decimal point positions */
+         /* and that both lines have the same NORAD number :          */
+#define TLE_CHECK_FORMAT       1
+
 /* SDP4 and SGP4 can return zero,  or any of the following error/warning codes.
 The 'warnings' result in a mathematically reasonable value being returned,
 and perigee within the earth is completely reasonable for an object that's
@@ -106,28 +151,119 @@ void DLL_FUNC SGP4_init( double *params, const tle_t *tle);
 int  DLL_FUNC SGP4( const double tsince, const tle_t *tle, const double *params,
                                      double *pos, double *vel);
 
+int  DLL_FUNC SGP4_ephemeris( const double *tsince, const int n_times,
+               const tle_t *tle, const double *params, double *pos,
+               double *vel, int *rvals);
+void DLL_FUNC SGP4_batch_init( double *batch_params, const tle_t *tles,
+                                       const int n_sats);
+int  DLL_FUNC SGP4_batch( const double *tsince, const double *batch_params,
+                 const int n_sats, double *pos, double *vel, int *rvals);
+
 void DLL_FUNC SGP8_init( double *params, const tle_t *tle);
 int  DLL_FUNC SGP8( const double tsince, const tle_t *tle, const double *params,
                                      double *pos, double *vel);
 
 void DLL_FUNC SDP4_init( double *params, const tle_t *tle);
+void DLL_FUNC SDP4_init_with_config( double *params, const tle_t *tle,
+                                       const sxpx_config_t *config);
 int  DLL_FUNC SDP4( const double tsince, const tle_t *tle, const double *params,
                                      double *pos, double *vel);
 
+int  DLL_FUNC SDP4_r( const double tsince, const tle_t *tle,
+               const double *params, sxpx_state_t *state,
+               double *pos, double *vel);
+
+int  DLL_FUNC SDP4_ephemeris( const double *tsince, const int n_times,
+               const tle_t *tle, const double *params, double *pos,
+               double *vel, int *rvals);
+
 void DLL_FUNC SDP8_init( double *params, const tle_t *tle);
+void DLL_FUNC SDP8_init_with_config( double *params, const tle_t *tle,
+                                       const sxpx_config_t *config);
 int  DLL_FUNC SDP8( const double tsince, const tle_t *tle, const double *params,
                                      double *pos, double *vel);
+int  DLL_FUNC SDP8_r( const double tsince, const tle_t *tle,
+               const double *params, sxpx_state_t *state,
+               double *pos, double *vel);
+void DLL_FUNC sxpx_init_state( sxpx_state_t *state, const double *params);
+
+/* For resonant (12-hour or geosynchronous) deep-space orbits,  SDP4 and
+SDP8 integrate in 720-minute steps from epoch,  or from wherever the
+previous call left off.  Jumping around in time therefore costs
+O(|t|/720) steps per call.  sxpx_init_checkpoints( ) integrates once over
+the given span (minutes from epoch) and stores the result at each step
+in 'params';  after that,  any call within the span takes at most one
+step,  and the results no longer depend on the order of calls.  With
+Dundee compliance on,  they're bit-for-bit what you'd have gotten
+without the checkpoints.  Call it after SDP4_init( ) or SDP8_init( ) (not
+for 'H' ephemerides) and before sharing the params between threads;
+call sxpx_free_checkpoints( ) before discarding or re-initializing them.
+Copies of 'params' share the table,  so free it only once.  */
+
+int DLL_FUNC sxpx_init_checkpoints( double *params, const double tsince_min,
+                                            const double tsince_max);
+void DLL_FUNC sxpx_free_checkpoints( double *params);
 
 int DLL_FUNC select_ephemeris( const tle_t *tle);
 int DLL_FUNC parse_elements( const char *line1, const char *line2, tle_t *sat);
+int DLL_FUNC parse_elements_in_buffer( const char *buff,
+            const size_t buff_size, tle_t *tles, const int max_tles,
+            size_t *offsets);
 int DLL_FUNC tle_checksum( const char *buff);
+int DLL_FUNC tle_validate( const char *line1, const char *line2,
+                                          const int flags);
 void DLL_FUNC write_elements_in_tle_format( char *buff, const tle_t *tle);
+long DLL_FUNC write_tles_in_tle_format( char *buff, const tle_t *tles,
+                                                   const int n_tles);
 
 void DLL_FUNC sxpx_set_implementation_param( const int param_index,
                                               const int new_param);
 void DLL_FUNC sxpx_set_dpsec_integration_step( const double new_step_size);
+void DLL_FUNC sxpx_get_default_config( sxpx_config_t *config);
 void DLL_FUNC lunar_solar_position( const double jd,
                     double *lunar_xyzr, double *solar_xyzr);
+void * DLL_FUNC lunar_solar_init( const double jd_start, const double jd_end);
+int DLL_FUNC lunar_solar_eval( const void *context, const double jd,
+                    double *lunar_xyzr, double *solar_xyzr);
+void DLL_FUNC lunar_solar_free( void *context);
+
+/* Chebyshev fits to SGP4/SDP4 output for one TLE over a span of times
+(minutes from epoch),  to a given tolerance in km;  see 'cheb_eph.cpp'. */
+
+void * DLL_FUNC cheby_ephem_compile( const tle_t *tle,
+                  const double tsince_start, const double tsince_end,
+                  const double tolerance);
+int DLL_FUNC cheby_ephem_eval( const void *ephem, const double tsince,
+                                    double *pos, double *vel);
+int DLL_FUNC cheby_ephem_info( const void *ephem, double *epoch,
+                  double *tsince_start, double *tsince_end);
+long DLL_FUNC cheby_ephem_save( const void *ephem, const char *filename);
+void * DLL_FUNC cheby_ephem_load( const char *filename);
+void DLL_FUNC cheby_ephem_free( void *ephem);
+
+/* Precomputed catalogs:  the TLEs in a file,  already initialized for
+SGP4/SDP4,  in a binary file that can be memory-mapped;  see 'sat_cat.cpp'.
+The params are read-only;  use SDP4_r( ),  not SDP4( ),  on them. */
+
+long DLL_FUNC sat_catalog_create( const char *filename, const char *text,
+                                             const size_t text_size);
+void * DLL_FUNC sat_catalog_open( const char *filename);
+void * DLL_FUNC sat_catalog_build( const char *text, const size_t text_size);
+int DLL_FUNC sat_catalog_n_entries( const void *catalog);
+const char * DLL_FUNC sat_catalog_text( const void *catalog,
+                                             size_t *text_size);
+int DLL_FUNC sat_catalog_entry( const void *catalog, const int idx,
+            const tle_t **tle, const double **params, size_t *line2_offset);
+void DLL_FUNC sat_catalog_close( void *catalog);
+
+/* Index for finding TLEs by NORAD number (including Alpha-5/Super-5 ones)
+or international designation;  see 'tle_idx.cpp'.  */
+
+void * DLL_FUNC tle_index_create( const tle_t *tles, const int n_tles);
+int DLL_FUNC tle_index_add( void *index, const tle_t *tle, const int idx);
+int DLL_FUNC tle_index_find( const void *index, const int norad_number);
+int DLL_FUNC tle_index_find_desig( const void *index, const char *intl_desig);
+void DLL_FUNC tle_index_free( void *index);
 
 #ifdef __cplusplus
 }                       /* end of 'extern "C"' section */
@@ -6,6 +6,17 @@
 /* Common "internal" arguments between deep-space functions;  users of  */
 /* the satellite routines shouldn't need to bother with any of this     */
 
+/* Resonance integrator values (atime, xli, xni) at each integration node
+from n_before steps before epoch to n_after steps after it,  as set up by
+sxpx_init_checkpoints( ).  Node i (-n_before <= i <= n_after) is at
+nodes + 3 * (n_before + i).   */
+
+typedef struct
+{
+   int n_before, n_after;
+   double *nodes;
+} dpsec_checkpoints_t;
+
 typedef struct
 {
   double
@@ -14,16 +25,13 @@ typedef struct
   /* Used by dpinit part of Deep() */
   eosq, betao, cosio2, sing, cosg, betao2,
 
-  /* Used by dpsec and dpper parts of Deep() */
-  xll, omgadf, xnode, em, xinc, xn, t,
-
        /* 'd####' secular coeffs for 12-hour, e>.5 orbits: */
    d2201, d2211, d3210, d3222, d4410, d4422, d5220, d5232, d5421, d5433,
       /* formerly static to Deep( ),   but more logically part of this struct: */
-   atime, del1, del2, del3, e3, ee2, omegaq, pe, pgh, ph, pinc, pl, preep,
-   savtsn, se2, se3, sgh2, sgh3, sgh4, sh2, sh3, si2, si3, sl2, sl3,
+   del1, del2, del3, e3, ee2, omegaq, preep,
+   se2, se3, sgh2, sgh3, sgh4, sh2, sh3, si2, si3, sl2, sl3,
    sl4, sse, ssg, ssh, ssi, ssl, thgr, xfact, xgh2, xgh3, xgh4, xh2,
-   xh3, xi2, xi3, xl2, xl3, xl4, xlamo, xli, xni, xnq,
+   xh3, xi2, xi3, xl2, xl3, xl4, xlamo, xnq,
    zmol, zmos;
 
          /* Epoch offsets,  described by Rob Matson,  added by BJG, */
@@ -31,20 +39,77 @@ typedef struct
          /* be used... */
 #ifdef RETAIN_PERTURBATION_VALUES_AT_EPOCH
     double pe0, pinc0, pl0, pgh0, ph0;
-    int solar_lunar_init_flag;
 #endif
     int resonance_flag, synchronous_flag;
+    sxpx_config_t config;
+    dpsec_checkpoints_t *checkpoints;     /* usually NULL */
+         /* Everything above is set at initialization and then only read. */
+         /* The following is the state used by SDP4( ) and SDP8( ),  which */
+         /* (despite the 'const' params) modify it.  SDP4_r( ) and SDP8_r( ) */
+         /* use a caller-supplied state instead,  and leave this alone.    */
+    sxpx_state_t state;
 } deep_arg_t;
 
+/* Values passed between SDP4( )/SDP8( ) and Deep_dpsec( )/Deep_dpper( )
+for a single call.  These used to be in deep_arg_t,  which meant the
+(supposedly constant) 'params' got modified on every call.   */
+
+typedef struct
+{
+   double xll, omgadf, xnode, em, xinc, xn, t;
+} deep_vars_t;
+
 double FMod2p( const double x);
+void raw_lunar_solar_position( const double jd, double *lunar_xyzr,
+                                                double *solar_xyzr);
+void Deep_set_config( deep_arg_t *deep_arg, const sxpx_config_t *config);
 void Deep_dpinit( const tle_t *tle, deep_arg_t *deep_arg);
-void Deep_dpsec( const tle_t *tle, deep_arg_t *deep_arg);
-void Deep_dpper( const tle_t *tle, deep_arg_t *deep_arg);
+void Deep_init_state( const deep_arg_t *deep_arg, sxpx_state_t *state);
+void Deep_dpsec( const tle_t *tle, const deep_arg_t *deep_arg,
+                         sxpx_state_t *state, deep_vars_t *vars);
+void Deep_dpper( const tle_t *tle, const deep_arg_t *deep_arg,
+                         sxpx_state_t *state, deep_vars_t *vars);
+#ifdef RETAIN_PERTURBATION_VALUES_AT_EPOCH
+void Deep_init_perturbations_at_epoch( const tle_t *tle, deep_arg_t *deep_arg);
+#endif
 
 int sxpx_posn_vel( const double xnode, const double a, const double e,
       const double cosio, const double sinio,
       const double xincl, const double omega,
       const double xl, double *pos, double *vel);
+int sxpx_posn( const double xnode, const double a, const double e,
+      const double cosio, const double sinio,
+      const double xincl, const double omega,
+      const double xl, double *pos);
+
+         /* The 'block' version of sxpx_posn_vel( ) handles up to this many */
+         /* satellites (or times) at once,  in structure-of-arrays form.   */
+#define SXPX_BLOCK_SIZE   32
+
+void sxpx_posn_vel_block( const int n, const double *xnode, const double *a,
+      const double *e, const double *cosio, const double *sinio,
+      const double *xincl, const double *omega, const double *xl,
+      double *pos, double *vel, int *rvals);
+
+void cheby_fit( const double *fvals, double *coeffs, const int n);
+
+/* Clenshaw's recurrence for sum( coeffs[i] * T_i( x)),  -1 <= x <= 1 */
+
+static inline double cheby_eval( const double *coeffs, const int n,
+                                          const double x)
+{
+   double b0 = 0., b1 = 0., b2;
+   const double two_x = x + x;
+   int i;
+
+   for( i = n - 1; i > 0; i--)
+      {
+      b2 = b1;
+      b1 = b0;
+      b0 = coeffs[i] + two_x * b1 - b2;
+      }
+   return( coeffs[0] + x * b0 - b1);
+}
 
 typedef struct
 {
@@ -85,4 +150,41 @@ void sxpx_common_init( double *params, const tle_t *tle,
 
 #define a3ovk2   (minus_xj3/ck2*ae*ae*ae)
 
+/* Branch-free sine and cosine,  used in the 'block' (batch) code so    */
+/* that loops over satellites or times can be auto-vectorized;  libm's  */
+/* sin( ) and cos( ) can't be.  The argument is reduced modulo pi/2     */
+/* with a three-part Cody-Waite reduction,  and the polynomials are     */
+/* those of fdlibm's __kernel_sin( ) and __kernel_cos( ).  Results are  */
+/* within a couple of units in the last place for |x| < 1e+5 or so;    */
+/* don't expect bit-for-bit agreement with libm.                        */
+
+static inline void sxpx_sincos( const double x, double *sin_x, double *cos_x)
+{
+   const double round_magic = 6755399441055744.;     /* 1.5 * 2^52 */
+   const double two_over_pi = 0.636619772367581343075535053490057;
+   const double q = (x * two_over_pi + round_magic) - round_magic;
+   const int quadrant = (int)q;
+   const double r = ((x - q * 1.57079632673412561417e+00)
+                        - q * 6.07710050630396597660e-11)
+                        - q * 2.02226624871116645580e-21;
+   const double r2 = r * r;
+   const double sin_r = r + r * r2 * (-1.66666666666666324348e-01
+                  + r2 * (8.33333333332248946124e-03
+                  + r2 * (-1.98412698298579493134e-04
+                  + r2 * (2.75573137070700676789e-06
+                  + r2 * (-2.50507602534068634195e-08
+                  + r2 * 1.58969099521155010221e-10)))));
+   const double cos_r = 1. - .5 * r2 + r2 * r2 * (4.16666666666666019037e-02
+                  + r2 * (-1.38888888888741095749e-03
+                  + r2 * (2.48015872894767294178e-05
+                  + r2 * (-2.75573143513906633035e-07
+                  + r2 * (2.08757232129817482790e-09
+                  + r2 * -1.13596475577881948265e-11)))));
+   const double s = ((quadrant & 1) ? cos_r : sin_r);
+   const double c = ((quadrant & 1) ? sin_r : cos_r);
+
+   *sin_x = ((quadrant & 2) ? -s : s);
+   *cos_x = (((quadrant + 1) & 2) ? -c : c);
+}
+
 #endif         /* #ifndef NORAD_IN_H */
@@ -0,0 +1,397 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/* Propagation throughput benchmark,  run with 'make bench'.  By default,
+this makes up a synthetic catalog (so it needs no input files),  writes
+it out as TLEs,  and times parse_elements( ) reading them back in,  and
+parse_elements_in_buffer( ) doing the same (checking that the results
+are identical),  and times tle_checksum( ) and tle_validate( ) for each
+pair of lines,  and write_elements_in_tle_format( ) and the batch
+write_tles_in_tle_format( ) writing the TLEs back out.  Then
+it times initialization and propagation for each model :  SGP,  SGP4 and
+SGP8 on the near-earth TLEs,  SDP4 and SDP8 on the deep-space ones,  the
+latter split into resonant (12- and 24-hour) and non-resonant orbits.
+Propagation is timed 'near epoch' (within a day) and 'far from epoch'
+(within a month;  the resonance integrator has to work much harder).
+
+Output is meant to be machine-readable,  for tracking changes between
+versions :  lines starting with '#' are comments,  and every other line
+is five whitespace-separated fields :
+
+(model or function) (operation) (subset) (number of calls) (ns per call)
+
+Options are :
+
+   -n(number)   Make a synthetic catalog of this many TLEs (default 20000)
+   -f(filename) Read TLEs from this file instead
+   -s(number)   Random number seed (default 1)
+   -r(number)   Propagate each TLE to this many times (default 10)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "norad.h"
+#include "norad_in.h"
+
+#define PI 3.141592653589793238462643383279502884197169399375105
+#define MINUTES_PER_DAY 1440.
+
+#define SUBSET_NEAR_EARTH       0
+#define SUBSET_NON_RESONANT     1
+#define SUBSET_RESONANT         2
+
+static const char *subset_names[3] = { "near_earth", "non_resonant",
+                                       "resonant" };
+
+static double rand_range( const double low, const double high)
+{
+   return( low + (high - low) * (double)rand( ) / (double)RAND_MAX);
+}
+
+/* The synthetic catalog is roughly the mix seen in actual catalogs :
+mostly LEO,  with some GEO (24-hour resonant),  Molniya (12-hour
+resonant),  and non-resonant deep-space objects (GTO,  GPS-like,  and
+higher orbits).   */
+
+static void make_synthetic_tle( tle_t *tle, const int norad_number)
+{
+   const int orbit_type = rand( ) % 100;
+   double period, ecc, incl;       /* minutes,  unitless,  degrees */
+
+   memset( tle, 0, sizeof( tle_t));
+   tle->norad_number = norad_number;
+   tle->classification = 'U';
+   tle->ephemeris_type = '0';
+   snprintf( tle->intl_desig, sizeof( tle->intl_desig), "%02d%03d%c",
+                     norad_number % 60, norad_number % 365 + 1,
+                     'A' + norad_number % 26);
+   tle->epoch = 2460000.5 + rand_range( 0., 365.);
+   tle->bulletin_number = 999;
+   tle->revolution_number = rand( ) % 50000;
+   if( orbit_type < 70)             /* LEO */
+      {
+      period = rand_range( 88., 125.);
+      ecc = rand_range( 0., .02);
+      incl = rand_range( 0., 100.);
+      tle->bstar = rand_range( -1e-5, 5e-4);
+      tle->xndt2o = rand_range( -1e-5, 1e-4) * 2. * PI
+                                 / (MINUTES_PER_DAY * MINUTES_PER_DAY);
+      }
+   else if( orbit_type < 80)        /* GEO */
+      {
+      period = rand_range( 1430., 1442.);
+      ecc = rand_range( 0., .005);
+      incl = rand_range( 0., 15.);
+      }
+   else if( orbit_type < 85)        /* Molniya */
+      {
+      period = rand_range( 715., 720.);
+      ecc = rand_range( .68, .74);
+      incl = rand_range( 62., 65.);
+      }
+   else if( orbit_type < 92)        /* GTO */
+      {
+      period = rand_range( 600., 650.);
+      ecc = rand_range( .70, .73);
+      incl = rand_range( 0., 30.);
+      tle->bstar = rand_range( 0., 1e-4);
+      }
+   else if( orbit_type < 97)        /* GPS-like;  e too low for resonance */
+      {
+      period = rand_range( 700., 740.);
+      ecc = rand_range( 0., .02);
+      incl = rand_range( 50., 65.);
+      }
+   else                             /* HEO and graveyard */
+      {
+      period = rand_range( 1500., 15000.);
+      ecc = rand_range( 0., .6);
+      incl = rand_range( 0., 90.);
+      }
+   tle->xno = 2. * PI / period;
+   tle->eo = ecc;
+   tle->xincl = incl * PI / 180.;
+   tle->xnodeo = rand_range( 0., 2. * PI);
+   tle->omegao = rand_range( 0., 2. * PI);
+   tle->xmo = rand_range( 0., 2. * PI);
+}
+
+static double ns_per_call( const clock_t t0, const long n_calls)
+{
+   return( (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC
+                     / (double)( n_calls ? n_calls : 1));
+}
+
+static void show_result( const char *name, const char *operation,
+                 const char *subset, const long n_calls, const double ns)
+{
+   printf( "%-14s %-14s %-12s %8ld %10.1f\n", name, operation, subset,
+                              n_calls, ns);
+}
+
+static void init_model( const int model, double *params, const tle_t *tle)
+{
+   switch( model)
+      {
+      case 0:
+         SGP_init( params, tle);
+         break;
+      case 1:
+         SGP4_init( params, tle);
+         break;
+      case 2:
+         SGP8_init( params, tle);
+         break;
+      case 3:
+         SDP4_init( params, tle);
+         break;
+      case 4:
+         SDP8_init( params, tle);
+         break;
+      }
+}
+
+static int run_model( const int model, const double tsince, const tle_t *tle,
+                        const double *params, double *pos, double *vel)
+{
+   int rval = 0;
+
+   switch( model)
+      {
+      case 0:
+         rval = SGP( tsince, tle, params, pos, vel);
+         break;
+      case 1:
+         rval = SGP4( tsince, tle, params, pos, vel);
+         break;
+      case 2:
+         rval = SGP8( tsince, tle, params, pos, vel);
+         break;
+      case 3:
+         rval = SDP4( tsince, tle, params, pos, vel);
+         break;
+      case 4:
+         rval = SDP8( tsince, tle, params, pos, vel);
+         break;
+      }
+   return( rval);
+}
+
+/* Times one model on one subset of the catalog :  initialization,  then
+propagation to 'n_reps' random times per TLE near epoch,  then (after
+re-initializing,  untimed) the same far from epoch.  */
+
+static void time_model( const int model, const tle_t **tles, const int n_tles,
+                  const char *subset, const int n_reps, double *params)
+{
+   static const char *model_names[5] = { "SGP", "SGP4", "SGP8",
+                                         "SDP4", "SDP8" };
+   const long n_calls = (long)n_tles * (long)n_reps;
+   double *tsince = (double *)malloc( n_reps * sizeof( double));
+   double pos[3], vel[3];
+   int i, j, pass;
+   clock_t t0;
+
+   t0 = clock( );
+   for( i = 0; i < n_tles; i++)
+      init_model( model, params + i * N_SAT_PARAMS, tles[i]);
+   show_result( model_names[model], "init", subset, (long)n_tles,
+                                 ns_per_call( t0, (long)n_tles));
+   for( pass = 0; pass < 2; pass++)
+      {
+      const double max_t = (pass ? 30. : 1.) * MINUTES_PER_DAY;
+
+      if( pass)
+         for( i = 0; i < n_tles; i++)
+            init_model( model, params + i * N_SAT_PARAMS, tles[i]);
+      srand( 1);
+      for( j = 0; j < n_reps; j++)
+         tsince[j] = rand_range( -max_t, max_t);
+      t0 = clock( );
+      for( i = 0; i < n_tles; i++)
+         for( j = 0; j < n_reps; j++)
+            run_model( model, tsince[j], tles[i],
+                              params + i * N_SAT_PARAMS, pos, vel);
+      show_result( model_names[model],
+                  (pass ? "far_from_epoch" : "near_epoch"),
+                  subset, n_calls, ns_per_call( t0, n_calls));
+      }
+   free( tsince);
+}
+
+int main( const int argc, const char **argv)
+{
+   const char *filename = NULL;
+   int n_synthetic = 20000, n_reps = 10, seed = 1;
+   int i, pass, n_lines = 0, n_tles = 0, n_bulk, n_in_subset[3];
+   char *text, *tptr, *out_text;
+   const char **lines;
+   tle_t *tles, *bulk_tles;
+   const tle_t **subsets[3];
+   double *params, t_bulk;
+   long text_size;
+   clock_t t0;
+
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] == '-')
+         switch( argv[i][1])
+            {
+            case 'n':
+               n_synthetic = atoi( argv[i] + 2);
+               break;
+            case 'f':
+               filename = argv[i] + 2;
+               break;
+            case 's':
+               seed = atoi( argv[i] + 2);
+               break;
+            case 'r':
+               n_reps = atoi( argv[i] + 2);
+               break;
+            default:
+               printf( "Unrecognized option '%s'\n", argv[i]);
+               return( -1);
+            }
+   if( filename)
+      {
+      FILE *ifile = fopen( filename, "rb");
+
+      if( !ifile)
+         {
+         printf( "Couldn't open '%s'\n", filename);
+         return( -1);
+         }
+      fseek( ifile, 0L, SEEK_END);
+      text_size = ftell( ifile);
+      fseek( ifile, 0L, SEEK_SET);
+      text = (char *)calloc( text_size + 80, 1);
+      if( !fread( text, text_size, 1, ifile))
+         text_size = 0;
+      text[text_size] = '\0';
+      fclose( ifile);
+      }
+   else
+      {
+      char buff[200];
+      tle_t tle;
+
+      srand( seed);
+      text_size = (long)n_synthetic * (long)sizeof( buff);
+      text = (char *)calloc( text_size + 80, 1);
+      *text = '\0';
+      for( i = 0, tptr = text; i < n_synthetic; i++)
+         {
+         make_synthetic_tle( &tle, i + 1);
+         write_elements_in_tle_format( buff, &tle);
+         strcpy( tptr, buff);
+         tptr += strlen( tptr);
+         }
+      text_size = (long)( tptr - text);
+      }
+            /* Time parse_elements_in_buffer( ) on the whole text,  before */
+            /* splitting it into lines for parse_elements( ) :           */
+   n_bulk = parse_elements_in_buffer( text, (size_t)text_size, NULL,
+                                          text_size, NULL);
+   bulk_tles = (tle_t *)malloc( (n_bulk + 1) * sizeof( tle_t));
+   memset( bulk_tles, 0, (n_bulk + 1) * sizeof( tle_t));
+   t0 = clock( );
+   n_bulk = parse_elements_in_buffer( text, (size_t)text_size, bulk_tles,
+                                          n_bulk, NULL);
+   t_bulk = ns_per_call( t0, (long)n_bulk);
+            /* Split the text into lines,  in place : */
+   lines = (const char **)malloc( (text_size / 2 + 2) * sizeof( char *));
+   for( tptr = text; *tptr; )
+      {
+      lines[n_lines++] = tptr;
+      while( *tptr && *tptr != 10 && *tptr != 13)
+         tptr++;
+      while( *tptr == 10 || *tptr == 13)
+         *tptr++ = '\0';
+      }
+   tles = (tle_t *)malloc( (n_lines / 2 + 1) * sizeof( tle_t));
+   memset( tles, 0, (n_lines / 2 + 1) * sizeof( tle_t));
+   t0 = clock( );
+   for( i = 1; i < n_lines; i++)
+      if( parse_elements( lines[i - 1], lines[i], tles + n_tles) >= 0)
+         {
+         n_tles++;
+         i++;
+         }
+   printf( "# sat_code propagation benchmark\n");
+   printf( "# source %s;  %d TLEs;  %d times per TLE;  seed %d\n",
+                  (filename ? filename : "synthetic"), n_tles, n_reps, seed);
+   printf( "# name          operation      subset        n_calls  ns/call\n");
+   show_result( "parse_elements", "parse", "all", (long)n_tles,
+                                 ns_per_call( t0, (long)n_tles));
+   show_result( "parse_buffer", "parse", "all", (long)n_bulk, t_bulk);
+   if( n_bulk != n_tles || memcmp( tles, bulk_tles, n_tles * sizeof( tle_t)))
+      printf( "# parse_elements_in_buffer( ) results differ!\n");
+   free( bulk_tles);
+   for( pass = 0; pass < 2; pass++)
+      {
+      int n_valid = 0;
+
+      t0 = clock( );
+      for( i = 1; i < n_lines; i++)
+         if( pass ? tle_validate( lines[i - 1], lines[i], 0) >= 0 :
+                   tle_checksum( lines[i - 1]) >= 0 && tle_checksum( lines[i]) >= 0)
+            n_valid++;
+      show_result( (pass ? "tle_validate" : "tle_checksum"), "check", "all",
+                  (long)n_lines, ns_per_call( t0, (long)n_lines));
+      }
+   if( !n_tles)
+      return( -1);
+   out_text = (char *)malloc( (size_t)n_tles * 142 + 1);
+   t0 = clock( );
+   for( i = 0; i < n_tles; i++)
+      write_elements_in_tle_format( out_text, tles + i);
+   show_result( "write_elements", "write", "all", (long)n_tles,
+                                 ns_per_call( t0, (long)n_tles));
+   t0 = clock( );
+   write_tles_in_tle_format( out_text, tles, n_tles);
+   show_result( "write_tles", "write", "all", (long)n_tles,
+                                 ns_per_call( t0, (long)n_tles));
+   free( out_text);
+
+   params = (double *)malloc( n_tles * N_SAT_PARAMS * sizeof( double));
+   for( i = 0; i < 3; i++)
+      {
+      subsets[i] = (const tle_t **)malloc( n_tles * sizeof( tle_t *));
+      n_in_subset[i] = 0;
+      }
+   for( i = 0; i < n_tles; i++)
+      {
+      int subset = SUBSET_NEAR_EARTH;
+
+      if( select_ephemeris( tles + i))
+         {
+         SDP4_init( params, tles + i);
+         subset = (((deep_arg_t *)( params + 10))->resonance_flag ?
+                        SUBSET_RESONANT : SUBSET_NON_RESONANT);
+         }
+      subsets[subset][n_in_subset[subset]++] = tles + i;
+      }
+   for( i = 0; i < 5; i++)
+      if( i < 3)
+         time_model( i, subsets[SUBSET_NEAR_EARTH],
+                     n_in_subset[SUBSET_NEAR_EARTH],
+                     subset_names[SUBSET_NEAR_EARTH], n_reps, params);
+      else
+         {
+         time_model( i, subsets[SUBSET_NON_RESONANT],
+                     n_in_subset[SUBSET_NON_RESONANT],
+                     subset_names[SUBSET_NON_RESONANT], n_reps, params);
+         time_model( i, subsets[SUBSET_RESONANT],
+                     n_in_subset[SUBSET_RESONANT],
+                     subset_names[SUBSET_RESONANT], n_reps, params);
+         }
+   for( i = 0; i < 3; i++)
+      free( (void *)subsets[i]);
+   free( params);
+   free( tles);
+   free( (void *)lines);
+   free( text);
+   return( 0);
+}
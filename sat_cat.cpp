@@ -0,0 +1,357 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/* Precomputed TLE catalogs.  Reading a big TLE file means parsing each
+TLE and then running SGP4_init( ) or SDP4_init( ) on it;  for SDP4,  the
+initialization (lunisolar terms,  resonance coefficients) can cost more
+than a few dozen propagations.  If the same file is used over and over
+(as sat_id does with its TLE archive),  that work can be done once:
+sat_catalog_create( ) parses the text of a TLE file,  initializes each
+TLE,  and writes the results to a binary file.  sat_catalog_open( ) maps
+that file into memory (read-only),  and sat_catalog_entry( ) hands back
+pointers to each TLE and its params,  ready for SGP4( ) or SDP4_r( ).
+(Not SDP4( ) :  that writes to its params,  and these are read-only.
+Use SDP4_r( ) with an sxpx_state_t set up by sxpx_init_state( ).)
+sat_catalog_build( ) makes the same thing in memory,  for a program
+that keeps its TLEs loaded (such as sat_id in server mode) and doesn't
+want to write a file.
+
+   The text of the file is stored too,  so that comments,  object names,
+and the like are still available,  along with the offset of each TLE's
+second line within that text.
+
+   The file is in native byte order,  and depends on sizeof( tle_t) and
+N_SAT_PARAMS;  sat_catalog_open( ) refuses files that don't match.  It's
+a 64-byte header (see below),  followed by 'n_entries' entries,  then
+the text.  The header and entries are multiples of eight bytes,  so
+everything is suitably aligned when mapped.  Deep-space params are
+initialized with the process-wide settings at the time of creation (see
+sxpx_get_default_config( )),  and have no resonance checkpoints.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "norad.h"
+
+#ifdef _WIN32
+   #include <windows.h>
+#elif defined( __unix__) || defined( __APPLE__)
+   #include <fcntl.h>
+   #include <unistd.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #define USE_MMAP
+#endif
+
+#define SAT_CATALOG_MAGIC        "SxPxCat1"
+#define SAT_CATALOG_VERSION      1
+#define SAT_CATALOG_BYTE_ORDER   0x01020304
+
+typedef struct
+{
+   char magic[8];
+   int32_t version, header_size, tle_size, n_params;
+   int32_t entry_size, byte_order;
+   int64_t n_entries, entries_offset, text_offset, text_size;
+} sat_catalog_header_t;
+
+typedef struct
+{
+   tle_t tle;
+   int64_t line2_offset;      /* within the text */
+   int32_t is_deep, unused;
+   double params[N_SAT_PARAMS];
+} sat_catalog_entry_t;
+
+typedef struct
+{
+   const char *data;          /* the entire file */
+   size_t size;
+   int is_allocated;          /* 1 if 'data' was malloc( )ed,  not mapped */
+   const sat_catalog_header_t *hdr;
+   const sat_catalog_entry_t *entries;
+#ifdef _WIN32
+   HANDLE file, mapping;
+#endif
+} sat_catalog_t;
+
+/* Parses 'text',  initializes all the TLEs in it,  and returns the
+catalog (header,  entries,  and text) in a malloc( )ed buffer,  with its
+size in '*catalog_size'.  Returns NULL if memory runs out.  */
+
+static char *build_catalog( const char *text, const size_t text_size,
+                                             size_t *catalog_size)
+{
+   const int n_tles = parse_elements_in_buffer( text, text_size, NULL,
+                                                   0x7fffffff, NULL);
+   const size_t entries_size = (size_t)n_tles * sizeof( sat_catalog_entry_t);
+   const size_t size = sizeof( sat_catalog_header_t) + entries_size + text_size;
+   char *rval = (char *)malloc( size);
+   tle_t *tles = (tle_t *)calloc( n_tles + 1, sizeof( tle_t));
+   size_t *offsets = (size_t *)calloc( n_tles + 1, sizeof( size_t));
+   sat_catalog_header_t *hdr = (sat_catalog_header_t *)rval;
+   sat_catalog_entry_t *entries =
+                  (sat_catalog_entry_t *)( rval + sizeof( sat_catalog_header_t));
+   int i;
+
+   if( !rval || !tles || !offsets)
+      {
+      free( rval);
+      free( tles);
+      free( offsets);
+      return( NULL);
+      }
+   memset( rval, 0, sizeof( sat_catalog_header_t) + entries_size);
+   parse_elements_in_buffer( text, text_size, tles, n_tles, offsets);
+   for( i = 0; i < n_tles; i++)
+      {
+      sat_catalog_entry_t *eptr = entries + i;
+      const char *line2 = (const char *)memchr( text + offsets[i], '\n',
+                                  text_size - offsets[i]);
+
+      eptr->tle = tles[i];
+      eptr->line2_offset = (int64_t)( line2 + 1 - text);
+      eptr->is_deep = select_ephemeris( tles + i);
+      if( eptr->is_deep)
+         SDP4_init( eptr->params, tles + i);
+      else
+         SGP4_init( eptr->params, tles + i);
+      }
+   memcpy( hdr->magic, SAT_CATALOG_MAGIC, 8);
+   hdr->version = SAT_CATALOG_VERSION;
+   hdr->header_size = (int32_t)sizeof( sat_catalog_header_t);
+   hdr->tle_size = (int32_t)sizeof( tle_t);
+   hdr->n_params = N_SAT_PARAMS;
+   hdr->entry_size = (int32_t)sizeof( sat_catalog_entry_t);
+   hdr->byte_order = SAT_CATALOG_BYTE_ORDER;
+   hdr->n_entries = n_tles;
+   hdr->entries_offset = hdr->header_size;
+   hdr->text_offset = hdr->entries_offset + n_tles * hdr->entry_size;
+   hdr->text_size = (int64_t)text_size;
+   if( text_size)
+      memcpy( rval + hdr->text_offset, text, text_size);
+   free( tles);
+   free( offsets);
+   *catalog_size = size;
+   return( rval);
+}
+
+/* Parses 'text',  initializes all the TLEs in it,  and writes the result
+to 'filename'.  Returns the number of bytes written,  or -1 on failure. */
+
+long DLL_FUNC sat_catalog_create( const char *filename, const char *text,
+                                             const size_t text_size)
+{
+   size_t size;
+   char *data = build_catalog( text, text_size, &size);
+   FILE *ofile = (data ? fopen( filename, "wb") : NULL);
+   long rval = -1;
+
+   if( ofile)
+      {
+      if( fwrite( data, 1, size, ofile) == size)
+         rval = (long)size;
+      if( fclose( ofile))
+         rval = -1;
+      }
+   free( data);
+   return( rval);
+}
+
+static int header_is_valid( const sat_catalog_header_t *hdr,
+                                       const size_t file_size)
+{
+   return( file_size >= sizeof( sat_catalog_header_t)
+         && !memcmp( hdr->magic, SAT_CATALOG_MAGIC, 8)
+         && hdr->version == SAT_CATALOG_VERSION
+         && hdr->header_size == (int32_t)sizeof( sat_catalog_header_t)
+         && hdr->tle_size == (int32_t)sizeof( tle_t)
+         && hdr->n_params == N_SAT_PARAMS
+         && hdr->entry_size == (int32_t)sizeof( sat_catalog_entry_t)
+         && hdr->byte_order == SAT_CATALOG_BYTE_ORDER
+         && hdr->n_entries >= 0 && hdr->text_size >= 0
+         && hdr->entries_offset == hdr->header_size
+         && hdr->text_offset == hdr->entries_offset
+                              + hdr->n_entries * hdr->entry_size
+         && (uint64_t)( hdr->text_offset + hdr->text_size) <= file_size);
+}
+
+static void unmap_catalog( sat_catalog_t *cat)
+{
+   if( cat->is_allocated)
+      free( (void *)cat->data);
+   else if( cat->data)
+      {
+#ifdef _WIN32
+      UnmapViewOfFile( cat->data);
+#elif defined( USE_MMAP)
+      munmap( (void *)cat->data, cat->size);
+#else
+      free( (void *)cat->data);
+#endif
+      }
+#ifdef _WIN32
+   if( cat->mapping)
+      CloseHandle( cat->mapping);
+   if( cat->file != INVALID_HANDLE_VALUE)
+      CloseHandle( cat->file);
+#endif
+}
+
+/* Maps 'filename' into memory (or,  on systems without mmap( ) or
+MapViewOfFile( ),  reads it in).  Returns NULL if the file can't be read,
+or isn't a catalog written by a compatible build of this code.  */
+
+void * DLL_FUNC sat_catalog_open( const char *filename)
+{
+   sat_catalog_t *cat = (sat_catalog_t *)calloc( 1, sizeof( sat_catalog_t));
+
+   if( !cat)
+      return( NULL);
+#ifdef _WIN32
+   cat->file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if( cat->file != INVALID_HANDLE_VALUE)
+      {
+      LARGE_INTEGER size;
+
+      if( GetFileSizeEx( cat->file, &size) && size.QuadPart > 0)
+         {
+         cat->size = (size_t)size.QuadPart;
+         cat->mapping = CreateFileMapping( cat->file, NULL, PAGE_READONLY,
+                                             0, 0, NULL);
+         }
+      if( cat->mapping)
+         cat->data = (const char *)MapViewOfFile( cat->mapping,
+                                          FILE_MAP_READ, 0, 0, 0);
+      }
+#elif defined( USE_MMAP)
+   {
+   const int fd = open( filename, O_RDONLY);
+   struct stat stat_buff;
+
+   if( fd >= 0)
+      {
+      if( !fstat( fd, &stat_buff) && stat_buff.st_size > 0)
+         {
+         void *addr = mmap( NULL, (size_t)stat_buff.st_size, PROT_READ,
+                                     MAP_PRIVATE, fd, 0);
+
+         if( addr != MAP_FAILED)
+            {
+            cat->data = (const char *)addr;
+            cat->size = (size_t)stat_buff.st_size;
+            }
+         }
+      close( fd);
+      }
+   }
+#else
+   {
+   FILE *ifile = fopen( filename, "rb");
+
+   if( ifile)
+      {
+      long size;
+
+      if( !fseek( ifile, 0L, SEEK_END) && (size = ftell( ifile)) > 0)
+         {
+         char *buff = (char *)malloc( (size_t)size);
+
+         fseek( ifile, 0L, SEEK_SET);
+         if( buff && fread( buff, 1, (size_t)size, ifile) == (size_t)size)
+            {
+            cat->data = buff;
+            cat->size = (size_t)size;
+            }
+         else
+            free( buff);
+         }
+      fclose( ifile);
+      }
+   }
+#endif
+   if( cat->data)
+      cat->hdr = (const sat_catalog_header_t *)cat->data;
+   if( !cat->data || !header_is_valid( cat->hdr, cat->size))
+      {
+      unmap_catalog( cat);
+      free( cat);
+      return( NULL);
+      }
+   cat->entries = (const sat_catalog_entry_t *)
+                              ( cat->data + cat->hdr->entries_offset);
+   return( cat);
+}
+
+/* Makes a catalog from 'text' in memory,  without writing it to a file.
+It's used exactly as one from sat_catalog_open( ) would be,  and freed
+with sat_catalog_close( ).  Returns NULL if memory runs out.  */
+
+void * DLL_FUNC sat_catalog_build( const char *text, const size_t text_size)
+{
+   sat_catalog_t *cat = (sat_catalog_t *)calloc( 1, sizeof( sat_catalog_t));
+
+   if( !cat)
+      return( NULL);
+#ifdef _WIN32
+   cat->file = INVALID_HANDLE_VALUE;
+#endif
+   cat->data = build_catalog( text, text_size, &cat->size);
+   if( !cat->data)
+      {
+      free( cat);
+      return( NULL);
+      }
+   cat->is_allocated = 1;
+   cat->hdr = (const sat_catalog_header_t *)cat->data;
+   cat->entries = (const sat_catalog_entry_t *)
+                              ( cat->data + cat->hdr->entries_offset);
+   return( cat);
+}
+
+int DLL_FUNC sat_catalog_n_entries( const void *catalog)
+{
+   return( (int)( (const sat_catalog_t *)catalog)->hdr->n_entries);
+}
+
+/* Returns the text from which the catalog was made.  It's _not_
+null-terminated;  the size is stored in 'text_size'.  */
+
+const char * DLL_FUNC sat_catalog_text( const void *catalog, size_t *text_size)
+{
+   const sat_catalog_t *cat = (const sat_catalog_t *)catalog;
+
+   if( text_size)
+      *text_size = (size_t)cat->hdr->text_size;
+   return( cat->data + cat->hdr->text_offset);
+}
+
+/* Sets pointers to the TLE and params of entry 'idx' (either pointer may
+be NULL,  if you don't want it),  and the offset of the TLE's second line
+within the text.  Returns 1 if the params are for SDP4,  0 if they're for
+SGP4,  or -1 if 'idx' is out of range.  */
+
+int DLL_FUNC sat_catalog_entry( const void *catalog, const int idx,
+            const tle_t **tle, const double **params, size_t *line2_offset)
+{
+   const sat_catalog_t *cat = (const sat_catalog_t *)catalog;
+   const sat_catalog_entry_t *eptr;
+
+   if( idx < 0 || idx >= cat->hdr->n_entries)
+      return( -1);
+   eptr = cat->entries + idx;
+   if( tle)
+      *tle = &eptr->tle;
+   if( params)
+      *params = eptr->params;
+   if( line2_offset)
+      *line2_offset = (size_t)eptr->line2_offset;
+   return( eptr->is_deep);
+}
+
+void DLL_FUNC sat_catalog_close( void *catalog)
+{
+   unmap_catalog( (sat_catalog_t *)catalog);
+   free( catalog);
+}
@@ -6,11 +6,7 @@
 #include <assert.h>
 #include <math.h>
 #include <time.h>
-#if defined( _WIN32) || defined( __WATCOMC__)
-   #include "zlibstub.h"
-#else
-   #include <zlib.h>
-#endif
+#include <sys/stat.h>
 #include "watdefs.h"
 #include "afuncs.h"
 #include "comets.h"
@@ -19,6 +15,8 @@
 #include "mpc_func.h"
 #include "stringex.h"
 #include "observe.h"
+#include "gz_pipe.h"
+#include "tle_tree.h"
 
 /* Code to generate topocentric ephemerides from TLE data,  mostly focussed
 on the TLEs provided in https://www.github.com/Bill-Gray/tles. The program
@@ -37,9 +35,9 @@ typedef struct
 
 static int verbose = 0;
 
-static char *gzgets_trimmed( char *buff, const int buffsize, gzFile ifile)
+static char *gzgets_trimmed( char *buff, const int buffsize, gz_pipe_t *ifile)
 {
-   char *rval = gzgets( ifile, buff, buffsize);
+   char *rval = gz_pipe_gets( ifile, buff, buffsize);
 
    if( rval)
       {
@@ -106,6 +104,36 @@ static inline bool desig_match( const tle_t *tle, const char *desig)
    return( rval);
 }
 
+/* Archives hold many TLEs for many objects,  and we want just one of
+them.  Rather than run parse_elements( ) on every TLE and then check it
+with desig_match( ),  we first check the NORAD number or international
+designation where they sit in line 1.  Returns false only if desig_match( )
+would be false,  too.  (Alpha-5 numbers are all past 99999,  so they
+can't match a five-digit 'desig'.  A blank designation on line 1 gets one
+made up from the NORAD number,  so we can't rule those out here.)  */
+
+static inline bool line1_may_match( const char *line1, const char *desig)
+{
+   size_t i = 0;
+
+   while( isdigit( desig[i]))
+      i++;
+   if( i != 5)
+      return( false);
+   if( !desig[i])
+      {
+      for( i = 0; i < 5; i++)
+         if( (line1[i + 2] == ' ' ? '0' : line1[i + 2]) != desig[i])
+            return( false);
+      return( true);
+      }
+   if( !memcmp( line1 + 9, "     ", 5))
+      return( true);
+   i = strlen( desig);
+   return( i > 5 && i < 9 && !memcmp( line1 + 9, desig, i)
+                      && (line1[9 + i] <= ' ' || i == 8));
+}
+
 /* Generates unit vector in the direction of ivect and stores it in z_vect;
 a unit vector perpendicular to that in the xy plane,  stored in x_vect;
 and a unit vector perpendicular to both,  stored in y_vect.   */
@@ -165,14 +193,27 @@ static bool show_separate_motions = false;
 static bool output_state_vectors = false;
 static bool output_mjd = false;
 
+/* If there's a 'tle_list.txt.sxi' index (see 'tle_tree.c'),  and a TLE
+file's '# MJD' blocks are in order,  we can binary-search for the first
+block that covers the ephemeris,  start reading there,  and stop at the
+first block after the ephemeris ends.  That's only safe if there are no
+TLEs before the first block,  and no magnitude (' H ') lines we might
+skip over;  otherwise,  the file is read from the top,  as usual. */
+
+static tle_tree_t *tle_tree = NULL;
+
 static int show_ephems_from( const char *path_to_tles, const ephem_t *e,
                                   const char *filename, int start_line)
 {
-   gzFile ifile;
+   gz_pipe_t *ifile = NULL;
    char line0[100], line1[100], line2[100];
+   const tle_tree_entry_t *entry;
+   const int seek_flags = TLE_TREE_SORTED_BLOCKS | TLE_TREE_TLES_IN_BLOCKS;
+   bool seeking = false;
    int show_it = 1, header_shown = 0;
    double jd_tle = 0., tle_range = 1e+10, abs_mag = 0.;
    const bool is_geocentric = (e->rho_sin_phi == 0. && e->rho_cos_phi == 0.);
+   void *lunar_solar;
    static const char *header_text =
            "Date (UTC)  Time       R.A. (J2000)  decl   Azim   Alt  Elong"
            "  LuElo  Dist(km) \"/sec     PA";
@@ -182,11 +223,31 @@ static int show_ephems_from( const char *path_to_tles, const ephem_t *e,
    if( verbose)
       printf( "Should examine '%s'; start line %d\n", filename, start_line);
    snprintf( line0, sizeof( line0), "%s/%s", path_to_tles, filename);
-   ifile = gzopen( line0, "rb");
+   entry = (tle_tree ? tle_tree_find( tle_tree, line0) : NULL);
+   if( entry && (entry->flags & (seek_flags | TLE_TREE_H_LINES)) == seek_flags)
+      {
+      const int idx = tle_tree_first_block( entry, 2400000.5, 1., e->jd_start);
+
+      if( idx == entry->n_blocks)
+         {
+         if( verbose)
+            printf( "No TLEs in '%s' for our time span\n", filename);
+         return( start_line);
+         }
+      strlcpy_error( line2, line0);
+      if( entry->is_gz)
+         strlcat_error( line2, ".gz");
+      ifile = gz_pipe_open_at( line2, (long)entry->blocks[idx].offset);
+      seeking = (ifile != NULL);
+      if( verbose && seeking)
+         printf( "Starting at block %d of %d\n", idx, entry->n_blocks);
+      }
+   if( !ifile)
+      ifile = gz_pipe_open( line0);
    if( !ifile)       /* maybe it's compressed */
       {
       strlcat_error( line0, ".gz");
-      ifile = gzopen( line0, "rb");
+      ifile = gz_pipe_open( line0);
       }
    if( !ifile)
       {
@@ -194,6 +255,8 @@ static int show_ephems_from( const char *path_to_tles, const ephem_t *e,
       exit( 0);
       }
    *line0 = *line1 = '\0';
+            /* Sun & moon positions come from Chebyshev fits over the span */
+   lunar_solar = lunar_solar_init( e->jd_start - 1., e->jd_end + 1.);
    while( gzgets_trimmed( line2, sizeof( line2), ifile))
       {
       tle_t tle;
@@ -207,6 +270,8 @@ static int show_ephems_from( const char *path_to_tles, const ephem_t *e,
             jd_tle = atof( line2 + 6) + 2400000.5;
             tle_range = 1.;
             show_it = (jd_tle < e->jd_end && jd_tle + tle_range > e->jd_start);
+            if( seeking && jd_tle >= e->jd_end)
+               break;         /* blocks are in order;  we're past the end */
             }
          else if( tptr)
             {
@@ -215,11 +280,13 @@ static int show_ephems_from( const char *path_to_tles, const ephem_t *e,
                printf( "H = %.3f\n", abs_mag);
             }
          }
-      else if( show_it && parse_elements( line1, line2, &tle) >= 0
+      else if( show_it && *line1 == '1' && line1_may_match( line1, e->desig)
+                     && parse_elements( line1, line2, &tle) >= 0
                      && desig_match( &tle, e->desig))
          {
          double sat_params[N_SAT_PARAMS], jd = e->jd_start;
-         size_t i, j;
+         double *t_since, *all_pos, *all_vel;
+         size_t i, j, n_times = 0;
          const int is_deep_type = select_ephemeris( &tle);
 
          if( is_deep_type)
@@ -231,13 +298,30 @@ static int show_ephems_from( const char *path_to_tles, const ephem_t *e,
             printf( "Got TLEs for %f :\n", jd);
             printf( "%s\n%s\n%s\n", line0, line1, line2);
             }
+               /* Gather the times this TLE covers,  and compute all the   */
+               /* positions and velocities for them in a single call :    */
+         t_since = (double *)malloc( (size_t)e->n_steps * 7 * sizeof( double));
+         assert( t_since);
+         all_pos = t_since + e->n_steps;
+         all_vel = all_pos + 3 * e->n_steps;
+         for( i = 0; i < (size_t)e->n_steps; i++,
+                                         jd = e->jd_start + (double)i * e->step_size)
+            if( (int)i >= start_line && jd >= jd_tle && jd < jd_tle + tle_range)
+               t_since[n_times++] = (jd - tle.epoch) * minutes_per_day;
+         if( is_deep_type)
+            SDP4_ephemeris( t_since, (int)n_times, &tle, sat_params,
+                                         all_pos, all_vel, NULL);
+         else
+            SGP4_ephemeris( t_since, (int)n_times, &tle, sat_params,
+                                         all_pos, all_vel, NULL);
+         n_times = 0;
+         jd = e->jd_start;
          for( i = 0; i < (size_t)e->n_steps; i++,
                                          jd = e->jd_start + (double)i * e->step_size)
             if( (int)i >= start_line && jd >= jd_tle && jd < jd_tle + tle_range)
                {
                char buff[90], dec_buff[20], ra_buff[20], alt_buff[17];
                double pos[3], vel[3], obs_pos[3], ra, dec, dist;
-               const double t_since = (jd - tle.epoch) * minutes_per_day;
                double solar_xyzr[4], lunar_xyzr[4], topo_posn[3], elong;
                double motion_rate, motion_pa;
                double ra_motion, dec_motion;
@@ -271,10 +355,9 @@ static int show_ephems_from( const char *path_to_tles, const ephem_t *e,
                else
                   full_ctime( buff, jd, FULL_CTIME_YMD | FULL_CTIME_MONTHS_AS_DIGITS
                                  | FULL_CTIME_LEADING_ZEROES);
-               if( is_deep_type)
-                  SDP4( t_since, &tle, sat_params, pos, vel);
-               else
-                  SGP4( t_since, &tle, sat_params, pos, vel);
+               memcpy( pos, all_pos + n_times * 3, 3 * sizeof( double));
+               memcpy( vel, all_vel + n_times * 3, 3 * sizeof( double));
+               n_times++;
                observer_cartesian_coords( jd, e->lon, e->rho_cos_phi,
                                         e->rho_sin_phi, obs_pos);
                get_satellite_ra_dec_delta( obs_pos, pos, &ra, &dec, &dist);
@@ -298,7 +381,7 @@ static int show_ephems_from( const char *path_to_tles, const ephem_t *e,
                   topo_posn[j] = pos[j] - obs_pos[j];
                motion_rate = compute_angular_rates( obs_pos, topo_posn, vel, &motion_pa,
                            &ra_motion, &dec_motion);
-               lunar_solar_position( jd, lunar_xyzr, solar_xyzr);
+               lunar_solar_eval( lunar_solar, jd, lunar_xyzr, solar_xyzr);
                ecliptic_to_equatorial( solar_xyzr);
                ecliptic_to_equatorial( lunar_xyzr);
                if( !is_geocentric)
@@ -355,11 +438,13 @@ static int show_ephems_from( const char *path_to_tles, const ephem_t *e,
                   }
                start_line = (int)i + 1;
                }
+         free( t_since);
          }
       strcpy( line0, line1);
       strcpy( line1, line2);
       }
-   gzclose( ifile);
+   gz_pipe_close( ifile);
+   lunar_solar_free( lunar_solar);
    return( start_line);
 }
 
@@ -367,18 +452,18 @@ static const char *tle_list_filename = "tle_list.txt";
 
 int generate_artsat_ephems( const char *path_to_tles, const ephem_t *e)
 {
-   gzFile ifile;
+   gz_pipe_t *ifile;
    char buff[100];
    int is_in_range = 0, id_matches = 1, start_line = 0;
 
    snprintf( buff, sizeof( buff), "%s/%s", path_to_tles, tle_list_filename);
    if( verbose > 1)
       printf( "Opening '%s', looking for '%s'\n", buff, e->desig);
-   ifile = gzopen( buff, "rb");
+   ifile = gz_pipe_open( buff);
    if( !ifile)
       {
       strlcat_error( buff, ".gz");
-      ifile = gzopen( buff, "rb");
+      ifile = gz_pipe_open( buff);
       }
    if( !ifile)
       {
@@ -421,7 +506,7 @@ int generate_artsat_ephems( const char *path_to_tles, const ephem_t *e)
          id_matches = 1;
          }
       }
-   gzclose( ifile);
+   gz_pipe_close( ifile);
    if( start_line)
       printf( "%s", _header);
    return( start_line);
@@ -434,7 +519,7 @@ static int set_location( ephem_t *e, const char *mpc_code, const char *obscode_f
 
    if( rval)
       {
-      gzFile ifile = gzopen( obscode_file_name, "rb");
+      gz_pipe_t *ifile = gz_pipe_open( obscode_file_name);
       char buff[200];
 
       if( !ifile)
@@ -456,7 +541,7 @@ static int set_location( ephem_t *e, const char *mpc_code, const char *obscode_f
             rval = 0;
             printf( "%s\n", c.name);
             }
-      gzclose( ifile);
+      gz_pipe_close( ifile);
       }
    if( !rval)
       {
@@ -547,6 +632,8 @@ int dummy_main( const int argc, const char **argv)
    bool round_to_nearest_step = true;
    const char *mpc_code = "500";
    const char *override_tle_filename = NULL;
+   char tree_name[255];
+   struct stat stat_buff;
 
    if( argc < 2)
       {
@@ -634,6 +721,10 @@ int dummy_main( const int argc, const char **argv)
    e.jd_end   = e.jd_start + (double)e.n_steps * e.step_size;
    if( verbose)
       printf( "arguments parsed;  JDs %f to %f\n", e.jd_start, e.jd_end);
+   snprintf( tree_name, sizeof( tree_name), "%s/%s.sxi", PATH_TO_TLES,
+                                       tle_list_filename);
+   if( !stat( tree_name, &stat_buff))
+      tle_tree = tle_tree_open( tree_name);
    for( i = 1; i < argc; i++)
       if( argv[i][0] == '-' && argv[i][1] == 'o')
          {
@@ -647,6 +738,8 @@ int dummy_main( const int argc, const char **argv)
          else
             generate_artsat_ephems( PATH_TO_TLES, &e);
          }
+   if( tle_tree)
+      tle_tree_close( tle_tree);
    return( 0);
 }
 
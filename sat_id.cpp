@@ -65,12 +65,18 @@ should be used,  and the others are suppressed.       */
 #include <ctype.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <sys/stat.h>
 #if defined( _WIN32) || defined( __WATCOMC__)
    #include <malloc.h>     /* for alloca() prototype */
-   #include "zlibstub.h"
 #else
    #include <unistd.h>
-   #include <zlib.h>
+   #include <errno.h>
+   #include <signal.h>
+   #include <sys/socket.h>
+   #include <sys/un.h>
+   #include <sys/wait.h>
+   #include <pthread.h>
+   #define USE_PTHREADS
 #endif
 
 #if defined(_MSC_VER) && _MSC_VER < 1900
@@ -98,6 +104,8 @@ int snprintf( char *string, const size_t max_len, const char *format, ...);
 #include "afuncs.h"
 #include "date.h"
 #include "sat_util.h"
+#include "gz_pipe.h"
+#include "tle_tree.h"
 #include "stringex.h"
 
 #define OBSERVATION struct observation
@@ -149,6 +157,12 @@ typedef struct
    'classified' or Space-Watch TLEs) to be used.  This is invoked with -s. */
 static bool my_tles_only = false;
 
+/* Solar positions are needed for every TLE/observation pair,  for the
+shadow test.  They're computed from Chebyshev fits covering all the
+observations (see 'lun_sol.cpp').  This is created before any TLEs are
+examined,  and only read thereafter. */
+static void *lunar_solar = NULL;
+
 #if !defined( ON_LINE_VERSION) && !defined( _WIN32)
    #define CSI "\x1b["
    #define OSC "\x1b]"
@@ -424,6 +438,44 @@ static int set_observer_location( OBSERVATION *obs)
    return( rval);
 }
 
+/* Sets 'toff' from the 'second line' of a spacecraft ('s') or roving
+('v') observation.  Errors are reported,  up to a total of ten.  */
+
+static void get_offset_data( offset_t *toff, const char *buff, const double jd,
+                              int *n_errors_found)
+{
+   toff->jd = jd;
+   strlcpy_error( toff->mpc_code, buff + 77);
+   if( buff[14] == 's')
+      {
+      int err_code = get_satellite_offset( buff, toff->posn);
+      size_t i;
+
+      for( i = 0; i < 3; i++)
+         toff->posn[i] *= AU_IN_KM;
+      ecliptic_to_equatorial( toff->posn);
+      if( err_code < 0 && (*n_errors_found)++ < 10)
+            fprintf( stderr, REVERSE_VIDEO
+                           "Malformed satellite offset; err %d\n%s\n"
+                           NORMAL_VIDEO, err_code, buff);
+      }
+   else
+      {
+      double lat, lon, alt_in_meters, rho_sin_phi, rho_cos_phi;
+
+      if( sscanf( buff + 34, "%lf %lf %lf", &lon, &lat, &alt_in_meters) != 3)
+         if( (*n_errors_found)++ < 10)
+            fprintf( stderr, "Couldn't parse roving observer:\n%s\n", buff);
+      lon *= PI / 180.;
+      lat *= PI / 180.;
+      lat_alt_to_parallax( lat, alt_in_meters,
+                 &rho_cos_phi, &rho_sin_phi,
+                 EARTH_MAJOR_AXIS, EARTH_MINOR_AXIS);
+      observer_cartesian_coords( jd, lon, rho_cos_phi,
+                               rho_sin_phi, toff->posn);
+      }
+}
+
 /* Loads up MPC-formatted 80-column observations from a file.  Makes
 a pass to find out how many observations there are,  allocates space
 for them,  then reads them again to actually load the observations. */
@@ -451,34 +503,7 @@ static OBSERVATION *get_observations_from_file( FILE *ifile, size_t *n_found,
             {                 /* satellite obs or roving observer */
             offset_t toff;
 
-            toff.jd = obs.jd;
-            strlcpy_error( toff.mpc_code, buff + 77);
-            if( buff[14] == 's')
-               {
-               int err_code = get_satellite_offset( buff, toff.posn);
-               for( i = 0; i < 3; i++)
-                  toff.posn[i] *= AU_IN_KM;
-               ecliptic_to_equatorial( toff.posn);
-               if( err_code < 0 && n_errors_found++ < 10)
-                     fprintf( stderr, REVERSE_VIDEO
-                                    "Malformed satellite offset; err %d\n%s\n"
-                                    NORMAL_VIDEO, err_code, buff);
-               }
-            else
-               {
-               double lat, lon, alt_in_meters, rho_sin_phi, rho_cos_phi;
-
-               if( sscanf( buff + 34, "%lf %lf %lf", &lon, &lat, &alt_in_meters) != 3)
-                  if( n_errors_found++ < 10)
-                     fprintf( stderr, "Couldn't parse roving observer:\n%s\n", buff);
-               lon *= PI / 180.;
-               lat *= PI / 180.;
-               lat_alt_to_parallax( lat, alt_in_meters,
-                          &rho_cos_phi, &rho_sin_phi,
-                          EARTH_MAJOR_AXIS, EARTH_MINOR_AXIS);
-               observer_cartesian_coords( obs.jd, lon, rho_cos_phi,
-                                        rho_sin_phi, toff.posn);
-               }
+            get_offset_data( &toff, buff, obs.jd, &n_errors_found);
             n_offsets++;
             offsets = (offset_t *)realloc( offsets, n_offsets * sizeof( offset_t));
             offsets[n_offsets - 1] = toff;
@@ -764,6 +789,10 @@ Additional command-line arguments are:\n\
    -a YYYYMMDD  Only use observations after this time\n\
    -b YYYYMMDD  Only use observations before this time\n\
    -c           Check all TLEs for existence\n\
+   -C (socket)  Send the request to a server started with -D\n\
+   -D (socket)  Run as a server,  with TLEs loaded once (see sat_id.txt)\n\
+   -F (minutes) Identify tracklets as observations arrive ('-' = stdin)\n\
+   -j (n)       Use n threads (-j0 = one per CPU)\n\
    -m (nrevs)   Only consider objects with fewer # revs/day (default=6)\n\
    -n (NORAD)   Only consider objects with this NORAD identifier\n\
    -r (radius)  Only show matches within this radius in degrees (default=4)\n\
@@ -776,9 +805,12 @@ Additional command-line arguments are:\n\
    exit( exit_code);
 }
 
+/* 'state' is used for deep-space TLEs,  so that 'sat_params' (which may
+be memory-mapped from a precomputed catalog) are only read.  */
+
 static int compute_artsat_ra_dec( double *ra, double *dec, double *dist,
-         const OBSERVATION *optr, tle_t *tle,
-         const double *sat_params, bool *in_shadow)
+         const OBSERVATION *optr, tle_t *tle, const double *sat_params,
+         sxpx_state_t *state, bool *in_shadow)
 {
    double pos[3]; /* Satellite position vector */
    double sun_xyzr[4], tval;
@@ -787,7 +819,7 @@ static int compute_artsat_ra_dec( double *ra, double *dec, double *dist,
    int sxpx_rval;
 
    if( select_ephemeris( tle))
-      sxpx_rval = SDP4( t_since, tle, sat_params, pos, NULL);
+      sxpx_rval = SDP4_r( t_since, tle, sat_params, state, pos, NULL);
    else
       sxpx_rval = SGP4( t_since, tle, sat_params, pos, NULL);
 
@@ -797,7 +829,7 @@ static int compute_artsat_ra_dec( double *ra, double *dec, double *dist,
       printf( "TLE failed for JD %f: %d\n", optr->jd, sxpx_rval);
    get_satellite_ra_dec_delta( optr->observer_loc, pos, ra, dec, dist);
    compute_aberration( (optr->jd - j2000) / 36525., ra, dec);
-   lunar_solar_position( optr->jd, NULL, sun_xyzr);
+   lunar_solar_eval( lunar_solar, optr->jd, NULL, sun_xyzr);
    ecliptic_to_equatorial( sun_xyzr);
    tval = dot_product( sun_xyzr, pos);
    if( tval < 0. && in_shadow)    /* elongation greater than 90 degrees; */
@@ -846,6 +878,434 @@ static bool got_obs_in_range( const object_t *objs, size_t n_objects,
    return( false);
 }
 
+/* Most TLEs are nowhere near most observations,  so we avoid computing a
+topocentric position for every TLE/object pair.  The first observation of
+each object (the one TLEs are tested against) goes into an index,  by time
+bucket and observing station,  and within those 'groups',  by declination
+band and then by RA.  For each TLE,  we compute its position once per
+time bucket,  at the bucket center.  We then find how far the satellite
+could have moved,  as seen from any observer in the group,  over half a
+bucket :  its velocity times that time,  plus a bound on the acceleration,
+plus the spread of observer positions within the group.  Only objects
+within the search radius plus that much of the predicted position need
+be checked in full.  If that bound is too big to be useful (close-in
+objects,  observations from spacecraft),  the whole group is checked.
+
+   Observations with the same station code are from the same place,  but
+the earth rotates during the bucket.  Spacecraft-based observations can
+be anywhere;  'loc_spread' accounts for both.  The candidate list comes
+out in object order,  so output is the same as checking every object. */
+
+#define OBS_BUCKET_DAYS       (5. / minutes_per_day)
+#define DEC_BAND_WIDTH        (PI / 180.)
+#define MAX_ACCEL             35.3     /* 1 g,  in km/min^2 */
+#define MAX_CONE_RADIUS       (PI / 4.)
+
+typedef struct
+{
+   double ra;                 /* epoch of date,  0 to 2pi */
+   int dec_band;
+   size_t obj_idx;
+} obs_index_entry_t;
+
+typedef struct
+{
+   int bucket;                /* index into obs_index_t.bucket_jds */
+   double observer_loc[3], loc_spread;
+   size_t start, n_entries;
+} obs_group_t;
+
+typedef struct
+{
+   obs_index_entry_t *entries;
+   obs_group_t *groups;
+   double *bucket_jds;        /* centers of occupied time buckets */
+   size_t n_groups, n_buckets, n_objects;
+} obs_index_t;
+
+static obs_index_t *obs_index = NULL;
+
+static const OBSERVATION *first_obs( const object_t *obj)
+{
+   return( obj->obs + obj->idx1);
+}
+
+static int dec_band( const double dec)
+{
+   return( (int)floor( (dec + PI / 2.) / DEC_BAND_WIDTH));
+}
+
+static double bucket_number( const double jd)
+{
+   return( floor( jd / OBS_BUCKET_DAYS));
+}
+
+static int compare_index_entries( const void *a, const void *b, void *context)
+{
+   const object_t *objects = (const object_t *)context;
+   const obs_index_entry_t *e1 = (const obs_index_entry_t *)a;
+   const obs_index_entry_t *e2 = (const obs_index_entry_t *)b;
+   const OBSERVATION *obs1 = first_obs( objects + e1->obj_idx);
+   const OBSERVATION *obs2 = first_obs( objects + e2->obj_idx);
+   const double bucket1 = bucket_number( obs1->jd);
+   const double bucket2 = bucket_number( obs2->jd);
+   int rval;
+
+   if( bucket1 != bucket2)
+      return( bucket1 > bucket2 ? 1 : -1);
+   rval = memcmp( obs1->text + 77, obs2->text + 77, 3);
+   if( !rval)
+      rval = e1->dec_band - e2->dec_band;
+   if( !rval && e1->ra != e2->ra)
+      rval = (e1->ra > e2->ra ? 1 : -1);
+   return( rval);
+}
+
+static obs_index_t *create_obs_index( const object_t *objects,
+                                             const size_t n_objects)
+{
+   obs_index_t *index = (obs_index_t *)calloc( 1, sizeof( obs_index_t));
+   size_t i, j;
+
+   if( !index || !n_objects)
+      return( index);
+   index->n_objects = n_objects;
+   index->entries = (obs_index_entry_t *)malloc( n_objects * sizeof( obs_index_entry_t));
+   index->groups = (obs_group_t *)malloc( n_objects * sizeof( obs_group_t));
+   index->bucket_jds = (double *)malloc( n_objects * sizeof( double));
+   assert( index->entries && index->groups && index->bucket_jds);
+   for( i = 0; i < n_objects; i++)
+      {
+      const OBSERVATION *optr = first_obs( objects + i);
+
+      index->entries[i].ra = fmod( optr->ra, PI + PI);
+      if( index->entries[i].ra < 0.)
+         index->entries[i].ra += PI + PI;
+      index->entries[i].dec_band = dec_band( optr->dec);
+      index->entries[i].obj_idx = i;
+      }
+   shellsort_r( index->entries, n_objects, sizeof( obs_index_entry_t),
+                     compare_index_entries, (void *)objects);
+   for( i = 0; i < n_objects; i = j)
+      {
+      const OBSERVATION *optr = first_obs( objects + index->entries[i].obj_idx);
+      obs_group_t *group = index->groups + index->n_groups;
+      const double bucket = bucket_number( optr->jd);
+
+      if( !index->n_buckets ||
+               bucket_number( index->bucket_jds[index->n_buckets - 1]) != bucket)
+         index->bucket_jds[index->n_buckets++] = (bucket + .5) * OBS_BUCKET_DAYS;
+      group->bucket = (int)index->n_buckets - 1;
+      memcpy( group->observer_loc, optr->observer_loc, 3 * sizeof( double));
+      group->loc_spread = 0.;
+      group->start = i;
+      for( j = i; j < n_objects; j++)
+         {
+         const OBSERVATION *optr2 =
+                     first_obs( objects + index->entries[j].obj_idx);
+         double delta[3], dist;
+         size_t k;
+
+         if( bucket_number( optr2->jd) != bucket
+                     || memcmp( optr->text + 77, optr2->text + 77, 3))
+            break;
+         for( k = 0; k < 3; k++)
+            delta[k] = optr2->observer_loc[k] - optr->observer_loc[k];
+         dist = vector3_length( delta);
+         if( group->loc_spread < dist)
+            group->loc_spread = dist;
+         }
+      group->n_entries = j - i;
+      index->n_groups++;
+      }
+   return( index);
+}
+
+static void free_obs_index( obs_index_t *index)
+{
+   if( index)
+      {
+      free( index->entries);
+      free( index->groups);
+      free( index->bucket_jds);
+      free( index);
+      }
+}
+
+/* Before propagating a TLE at all,  we can rule out much of the sky with
+its mean elements alone.  The object stays between 'r_min' and 'r_max'
+from the geocenter,  and its distance from the equatorial plane is at
+most r_max * sin( incl).  As seen by an observer at height z_obs above
+that plane,  something at distance s and declination dec is at height
+z_obs + s * sin( dec),  with s between r_min - |observer| and r_max +
+|observer|.  That gives a range of declinations (depending on where the
+observer is,  but not on RA) in which the object can appear;  for a
+geosynchronous object,  it's a band a few degrees wide.  For observers
+outside the shell (spacecraft),  the line of sight must also pass within
+r_max of the geocenter.
+
+   All of this is for declination bands of a given group,  widened by
+the search radius and by the spread of observer locations.  The margins
+on the elements allow for perturbations over a month or so;  farther
+from the TLE epoch,  we don't screen at all.  If no group can see the
+object,  the TLE needn't even be initialized.  */
+
+#define SHELL_MAX_DAYS        30.
+#define SHELL_INCL_MARGIN     (PI / 90.)
+#define EARTH_GM              (398600.4418 * 3600.)   /* km^3/min^2 */
+
+typedef struct
+{
+   double r_min, r_max, z_max;      /* km */
+   double radius;                   /* search radius,  radians */
+   bool active;
+} orbit_shell_t;
+
+static void set_orbit_shell( orbit_shell_t *shell, const obs_index_t *index,
+                  const tle_t *tle, const double radius)
+{
+   const double a = cbrt( EARTH_GM / (tle->xno * tle->xno));
+   double incl = (tle->xincl > PI / 2. ? PI - tle->xincl : tle->xincl);
+
+   shell->active = (tle->ephemeris_type != 'H' && tle->xno > 0.
+         && index->n_buckets
+         && fabs( index->bucket_jds[0] - tle->epoch) < SHELL_MAX_DAYS
+         && fabs( index->bucket_jds[index->n_buckets - 1] - tle->epoch)
+                                                         < SHELL_MAX_DAYS);
+   shell->r_min = a * (1. - tle->eo) * .9 - 100.;
+   shell->r_max = a * (1. + tle->eo) * 1.1 + 100.;
+   incl += SHELL_INCL_MARGIN;
+   shell->z_max = (incl < PI / 2. ? shell->r_max * sin( incl) : shell->r_max);
+   shell->radius = radius;
+}
+
+static bool orbit_may_be_in_band( const orbit_shell_t *shell,
+            const obs_group_t *group, double dec1, double dec2)
+{
+   const double rho = vector3_length( group->observer_loc);
+   const double spread = group->loc_spread;
+   const double z_obs = group->observer_loc[2];
+   const double s_max = shell->r_max + rho + spread;
+   double s_min = shell->r_min - rho - spread;
+   double sin1, sin2;
+
+   if( !shell->active)
+      return( true);
+   if( s_min < 0.)
+      s_min = 0.;
+   dec1 = (dec1 - shell->radius < -PI / 2. ? -PI / 2. : dec1 - shell->radius);
+   dec2 = (dec2 + shell->radius >  PI / 2. ?  PI / 2. : dec2 + shell->radius);
+   sin1 = sin( dec1);
+   sin2 = sin( dec2);
+   if( z_obs - spread + (sin1 < 0. ? s_max : s_min) * sin1 > shell->z_max)
+      return( false);
+   if( z_obs + spread + (sin2 > 0. ? s_max : s_min) * sin2 < -shell->z_max)
+      return( false);
+   if( rho - spread > shell->r_max && spread < rho / 2.)
+      {                 /* observer is outside the orbit;  must look inward */
+      const double anti_dec = -asin( z_obs / rho);
+      double theta = 0.;      /* angle from band to direction to geocenter */
+
+      if( anti_dec < dec1)
+         theta = dec1 - anti_dec;
+      else if( anti_dec > dec2)
+         theta = anti_dec - dec2;
+      theta -= asin( spread / rho);
+      if( theta > 0. && (theta >= PI / 2.
+                        || (rho - spread) * sin( theta) > shell->r_max))
+         return( false);
+      }
+   return( true);
+}
+
+static bool orbit_may_be_in_group( const orbit_shell_t *shell,
+            const obs_index_t *index, const obs_group_t *group)
+{
+   const int band1 = index->entries[group->start].dec_band;
+   const int band2 = index->entries[group->start + group->n_entries - 1].dec_band;
+
+   return( orbit_may_be_in_band( shell, group, band1 * DEC_BAND_WIDTH - PI / 2.,
+                                   (band2 + 1) * DEC_BAND_WIDTH - PI / 2.));
+}
+
+static bool orbit_may_be_in_band_no( const orbit_shell_t *shell,
+            const obs_group_t *group, const int band)
+{
+   return( orbit_may_be_in_band( shell, group, band * DEC_BAND_WIDTH - PI / 2.,
+                                   (band + 1) * DEC_BAND_WIDTH - PI / 2.));
+}
+
+/* Returns false if the TLE can't be near any observation,  in which case
+we needn't initialize or propagate it.  */
+
+static bool tle_may_be_observed( const obs_index_t *index, const tle_t *tle,
+                        const double radius)
+{
+   orbit_shell_t shell;
+   size_t i;
+
+   set_orbit_shell( &shell, index, tle, radius);
+   for( i = 0; i < index->n_groups; i++)
+      if( orbit_may_be_in_group( &shell, index, index->groups + i))
+         return( true);
+   return( false);
+}
+
+/* Adds the objects in 'group' with dec band 'band' and RA between ra1
+and ra2 (which must be in 0 to 2pi) to the candidate list.  */
+
+static size_t add_candidates_in_band( const obs_index_t *index,
+         const obs_group_t *group, size_t *candidates, size_t n_found,
+         const int band, const double ra1, const double ra2)
+{
+   const obs_index_entry_t *entries = index->entries + group->start;
+   size_t lo = 0, hi = group->n_entries;
+
+   while( lo < hi)      /* find first entry with (band, ra) >= (band, ra1) */
+      {
+      const size_t mid = (lo + hi) / 2;
+
+      if( entries[mid].dec_band < band
+               || (entries[mid].dec_band == band && entries[mid].ra < ra1))
+         lo = mid + 1;
+      else
+         hi = mid;
+      }
+   while( lo < group->n_entries && entries[lo].dec_band == band
+                              && entries[lo].ra <= ra2)
+      candidates[n_found++] = entries[lo++].obj_idx;
+   return( n_found);
+}
+
+static size_t add_candidates_in_cone( const obs_index_t *index,
+         const obs_group_t *group, const orbit_shell_t *shell,
+         size_t *candidates, size_t n_found, const double ra,
+         const double dec, const double radius)
+{
+   double delta_ra = PI;
+   int band;
+   const int band1 = dec_band( dec - radius), band2 = dec_band( dec + radius);
+
+   if( fabs( dec) + radius < PI / 2.)
+      delta_ra = asin( sin( radius) / cos( dec));
+   for( band = band1; band <= band2; band++)
+      if( !orbit_may_be_in_band_no( shell, group, band))
+         continue;
+      else if( delta_ra >= PI)
+         n_found = add_candidates_in_band( index, group, candidates, n_found,
+                                 band, 0., PI + PI);
+      else
+         {
+         double ra1 = ra - delta_ra, ra2 = ra + delta_ra;
+
+         if( ra1 < 0.)
+            {
+            n_found = add_candidates_in_band( index, group, candidates,
+                                 n_found, band, ra1 + PI + PI, PI + PI);
+            ra1 = 0.;
+            }
+         if( ra2 > PI + PI)
+            {
+            n_found = add_candidates_in_band( index, group, candidates,
+                                 n_found, band, 0., ra2 - PI - PI);
+            ra2 = PI + PI;
+            }
+         n_found = add_candidates_in_band( index, group, candidates, n_found,
+                                 band, ra1, ra2);
+         }
+   return( n_found);
+}
+
+static int compare_sizes( const void *a, const void *b)
+{
+   const size_t size1 = *(const size_t *)a, size2 = *(const size_t *)b;
+
+   return( (size1 > size2) - (size1 < size2));
+}
+
+/* Sets 'candidates' to the (sorted) indices of objects that might
+be within 'radius' (in radians) of where the TLE puts them,  and returns
+the number of such objects.  Time buckets outside the TLE's range,  if
+it has one (see is_in_range( )),  are skipped.  Deep-space TLEs get their
+own integrator state here;  results from SDP4_r( ) depend slightly on the
+times it was previously called for,  and we don't want to change those
+computed for the objects themselves.  */
+
+static size_t find_candidate_objects( const obs_index_t *index,
+            const tle_t *tle, const double *sat_params, const double radius,
+            const double range_start, const double range_len,
+            size_t *candidates)
+{
+   const double half_bucket = OBS_BUCKET_DAYS * minutes_per_day / 2.;
+   size_t n_found = 0, i, bucket = (size_t)-1;
+   double pos[3], vel[3], motion = 0.;
+   bool posn_ok = false;
+   sxpx_state_t state;
+   orbit_shell_t shell;
+
+   if( select_ephemeris( tle))
+      sxpx_init_state( &state, sat_params);
+   set_orbit_shell( &shell, index, tle, radius);
+
+   for( i = 0; i < index->n_groups; i++)
+      {
+      const obs_group_t *group = index->groups + i;
+      double ra, dec, dist, max_shift;
+
+      if( !orbit_may_be_in_group( &shell, index, group))
+         continue;
+      if( (size_t)group->bucket != bucket)
+         {
+         const double jd = index->bucket_jds[group->bucket];
+         const double t_since = (jd - tle->epoch) * minutes_per_day;
+         int sxpx_rval;
+
+         bucket = (size_t)group->bucket;
+         if( range_len && range_start && (jd + OBS_BUCKET_DAYS / 2. < range_start
+                     || jd - OBS_BUCKET_DAYS / 2. > range_start + range_len))
+            {        /* bucket is outside the TLE's range */
+            while( i + 1 < index->n_groups
+                        && (size_t)index->groups[i + 1].bucket == bucket)
+               i++;
+            continue;
+            }
+         if( select_ephemeris( tle))
+            sxpx_rval = SDP4_r( t_since, tle, sat_params, &state, pos, vel);
+         else
+            sxpx_rval = SGP4( t_since, tle, sat_params, pos, vel);
+         posn_ok = (!sxpx_rval || sxpx_rval == SXPX_WARN_PERIGEE_WITHIN_EARTH);
+         motion = vector3_length( vel) * half_bucket
+                        + MAX_ACCEL * half_bucket * half_bucket / 2.;
+         }
+      get_satellite_ra_dec_delta( group->observer_loc, pos, &ra, &dec, &dist);
+      max_shift = motion + group->loc_spread;
+      if( posn_ok && max_shift < dist * sin( MAX_CONE_RADIUS))
+         {
+         const double pad = 0.001;   /* aberration,  roundoff */
+
+         n_found = add_candidates_in_cone( index, group, &shell, candidates,
+                  n_found, ra, dec, radius + asin( max_shift / dist) + pad);
+         }
+      else           /* can't limit the search;  use every object that */
+         {           /* passes the declination screen */
+         const obs_index_entry_t *entries = index->entries + group->start;
+         size_t j;
+         bool band_ok = false;
+
+         for( j = 0; j < group->n_entries; j++)
+            {
+            if( !j || entries[j].dec_band != entries[j - 1].dec_band)
+               band_ok = orbit_may_be_in_band_no( &shell, group,
+                                                    entries[j].dec_band);
+            if( band_ok)
+               candidates[n_found++] = entries[j].obj_idx;
+            }
+         }
+      }
+   qsort( candidates, n_found, sizeof( size_t), compare_sizes);
+   return( n_found);
+}
+
 static int _pack_intl_desig( char *desig_out, const char *desig)
 {
    size_t i = 0;
@@ -953,9 +1413,9 @@ static void remove_redundant_desig( char *name, const char *desig)
          }
 }
 
-static char *gzgets_trimmed( gzFile ifile, char *buff, const size_t buff_len)
+static char *gzgets_trimmed( gz_pipe_t *ifile, char *buff, const size_t buff_len)
 {
-   char *rval = gzgets( ifile, buff, buff_len);
+   char *rval = gz_pipe_gets( ifile, buff, (int)buff_len);
 
    if( rval)
       {
@@ -968,6 +1428,282 @@ static char *gzgets_trimmed( gzFile ifile, char *buff, const size_t buff_len)
    return( rval);
 }
 
+/* If 'tle_file_name.sxc' exists and is at least as new as the TLE file,
+we use it (see 'tle2cat.cpp' and 'sat_cat.cpp') to skip parsing and
+initializing each TLE.  Its text is read line by line,  just as the TLE
+file itself would have been,  so names and '#' directives are handled
+the same way.  */
+
+static void *open_tle_catalog( const char *tle_file_name)
+{
+   char cat_name[255], gz_name[255];
+   struct stat cat_stat, tle_stat;
+
+   snprintf_err( cat_name, sizeof( cat_name), "%s.sxc", tle_file_name);
+   snprintf_err( gz_name, sizeof( gz_name), "%s.gz", tle_file_name);
+   if( stat( cat_name, &cat_stat))
+      return( NULL);
+   if( !stat( tle_file_name, &tle_stat) && tle_stat.st_mtime >= cat_stat.st_mtime)
+      return( NULL);
+   if( !stat( gz_name, &tle_stat) && tle_stat.st_mtime >= cat_stat.st_mtime)
+      return( NULL);
+   return( sat_catalog_open( cat_name));
+}
+
+/* Equivalent of gzgets_trimmed( ) for the catalog text (which has
+already been trimmed).  '*offset' is advanced to the next line;
+'*line_start' is set to the start of this one.   */
+
+static bool catalog_gets( const char *text, const size_t text_size,
+            size_t *offset, size_t *line_start, char *buff, const size_t buff_len)
+{
+   const char *tptr = text + *offset;
+   const char *eol;
+   size_t len;
+
+   if( *offset >= text_size)
+      return( false);
+   eol = (const char *)memchr( tptr, '\n', text_size - *offset);
+   len = (eol ? (size_t)( eol - tptr) : text_size - *offset);
+   *line_start = *offset;
+   *offset += len + 1;
+   if( len > buff_len - 1)
+      len = buff_len - 1;
+   memcpy( buff, tptr, len);
+   buff[len] = '\0';
+   return( true);
+}
+
+/* Catalog entries are in the order of their second lines within the
+text.  If the line starting at 'line_start' is the second line of a
+TLE,  we get that TLE and its params.  Entries for TLEs we passed over
+(not looking for TLEs at the time) are skipped.  */
+
+static bool get_catalog_tle( const void *catalog, const size_t line_start,
+                     int *idx, tle_t *tle, const double **params)
+{
+   const tle_t *cat_tle = NULL;
+   size_t line2_offset = 0;
+   int is_deep;
+
+   while( (is_deep = sat_catalog_entry( catalog, *idx, &cat_tle, params,
+                     &line2_offset)) >= 0 && line2_offset < line_start)
+      (*idx)++;
+   if( is_deep < 0 || line2_offset != line_start)
+      return( false);
+   *tle = *cat_tle;
+   (*idx)++;
+   return( true);
+}
+
+/* If 'tle_list.txt.sxi' exists,  it's used as an index of the files in
+the include tree (see 'tle_tree.c').  If a file's '# Ephem range:' shows
+it has nothing for our observations,  we read the file's header from the
+index,  instead of the file itself;  the effect is the same,  but we don't
+have to open and decompress the file.   */
+
+static tle_tree_t *tle_tree = NULL;
+static char tle_tree_name[260];
+
+static void open_tle_tree( const char *tle_file_name)
+{
+   struct stat stat_buff;
+
+   snprintf_err( tle_tree_name, sizeof( tle_tree_name), "%s.sxi", tle_file_name);
+   if( !stat( tle_tree_name, &stat_buff))
+      tle_tree = tle_tree_open( tle_tree_name);
+}
+
+/* Closing the tree writes out any entries that were rebuilt.  */
+
+static void close_tle_tree( void)
+{
+   if( tle_tree)
+      tle_tree_close( tle_tree);
+   tle_tree = NULL;
+}
+
+/* In server mode (-D;  see run_server( )),  every file reachable from
+the TLE list through '# Include' lines is read and its TLEs initialized
+once,  as an in-memory catalog (see 'sat_cat.cpp'),  or mapped from its
+precomputed '.sxc' catalog if that's up to date.  add_tle_to_obs( ) then
+uses those instead of reading the files.  Before each request,  files
+that have changed on disk (judged by the sizes and times of 'filename',
+'filename.gz',  and 'filename.sxc') are loaded again.  */
+
+typedef struct
+{
+   char *filename;            /* as add_tle_to_obs( ) will ask for it */
+   void *catalog;
+   time_t mtimes[3];          /* of filename,  filename.gz,  filename.sxc */
+   off_t sizes[3];
+} preloaded_t;
+
+static preloaded_t *preloaded = NULL;
+static size_t n_preloaded = 0;
+
+static void *find_preloaded( const char *filename)
+{
+   size_t i;
+
+   for( i = 0; i < n_preloaded; i++)
+      if( !strcmp( preloaded[i].filename, filename))
+         return( preloaded[i].catalog);
+   return( NULL);
+}
+
+static void get_file_times( const char *filename, time_t *mtimes, off_t *sizes)
+{
+   const char *exts[3] = { "", ".gz", ".sxc" };
+   size_t i;
+
+   for( i = 0; i < 3; i++)
+      {
+      char name[260];
+      struct stat stat_buff;
+
+      snprintf_err( name, sizeof( name), "%s%s", filename, exts[i]);
+      if( stat( name, &stat_buff))
+         {
+         mtimes[i] = 0;
+         sizes[i] = 0;
+         }
+      else
+         {
+         mtimes[i] = stat_buff.st_mtime;
+         sizes[i] = stat_buff.st_size;
+         }
+      }
+}
+
+/* Reads 'filename' (or 'filename.gz') just as add_tle_to_obs( ) would,
+a trimmed line at a time,  and makes an in-memory catalog of the text. */
+
+static void *build_tle_catalog( const char *filename)
+{
+   char name[260], line[100], *text = NULL;
+   size_t text_size = 0, allocated = 0;
+   gz_pipe_t *ifile = gz_pipe_open( filename);
+   void *rval;
+
+   if( !ifile)
+      {
+      snprintf_err( name, sizeof( name), "%s.gz", filename);
+      ifile = gz_pipe_open( name);
+      }
+   if( !ifile)
+      return( NULL);
+   while( gzgets_trimmed( ifile, line, sizeof( line)))
+      {
+      const size_t len = strlen( line);
+
+      if( text_size + len + 1 > allocated)
+         {
+         allocated = 2 * allocated + sizeof( line);
+         text = (char *)realloc( text, allocated);
+         assert( text);
+         }
+      memcpy( text + text_size, line, len);
+      text_size += len;
+      text[text_size++] = '\n';
+      }
+   gz_pipe_close( ifile);
+   rval = sat_catalog_build( (text ? text : ""), text_size);
+   free( text);
+   return( rval);
+}
+
+static void preload_includes( const void *catalog, const char *filename);
+
+/* Loads 'filename' into preloaded[idx] (replacing what was there,  if
+anything),  then loads any files it includes that aren't loaded yet.  */
+
+static void load_tle_file( const size_t idx, const char *filename)
+{
+   void *catalog = open_tle_catalog( filename);
+
+   if( !catalog)
+      catalog = build_tle_catalog( filename);
+   if( preloaded[idx].catalog)
+      sat_catalog_close( preloaded[idx].catalog);
+   preloaded[idx].catalog = catalog;
+   get_file_times( filename, preloaded[idx].mtimes, preloaded[idx].sizes);
+   if( catalog)
+      preload_includes( catalog, filename);
+}
+
+static void preload_tle_file( const char *filename)
+{
+   size_t i;
+
+   for( i = 0; i < n_preloaded; i++)
+      if( !strcmp( preloaded[i].filename, filename))
+         return;
+   preloaded = (preloaded_t *)realloc( preloaded,
+                        (n_preloaded + 1) * sizeof( preloaded_t));
+   assert( preloaded);
+   memset( preloaded + n_preloaded, 0, sizeof( preloaded_t));
+   preloaded[n_preloaded].filename = strdup( filename);
+   n_preloaded++;
+   load_tle_file( n_preloaded - 1, filename);
+}
+
+/* '# Include' file names are relative to the directory of the including
+file,  as in add_tle_to_obs( ).  */
+
+static void preload_includes( const void *catalog, const char *filename)
+{
+   size_t text_size, offset = 0, line_start;
+   const char *text = sat_catalog_text( catalog, &text_size);
+   char line[100];
+
+   while( catalog_gets( text, text_size, &offset, &line_start,
+                                 line, sizeof( line)))
+      if( !memcmp( line, "# Include ", 10))
+         {
+         char iname[255];
+         size_t i = strlen( filename);
+
+         while( i && filename[i - 1] != '/' && filename[i - 1] != '\\')
+            i--;
+         memcpy( iname, filename, i);
+         strlcpy_err( iname + i, line + 10, sizeof( iname) - i);
+         preload_tle_file( iname);
+         }
+}
+
+/* If anything was reloaded,  the tree index (if we have one open) may
+also be out of date;  we write it out and read it in again.  */
+
+static void reload_changed_tle_files( void)
+{
+   size_t i, n_reloaded = 0;
+
+   for( i = 0; i < n_preloaded; i++)
+      {
+      time_t mtimes[3];
+      off_t sizes[3];
+
+      get_file_times( preloaded[i].filename, mtimes, sizes);
+      if( memcmp( mtimes, preloaded[i].mtimes, sizeof( mtimes))
+                  || memcmp( sizes, preloaded[i].sizes, sizeof( sizes)))
+         {
+         char *filename = strdup( preloaded[i].filename);
+
+         if( verbose)
+            printf( "Reloading '%s'\n", filename);
+         load_tle_file( i, filename);
+         free( filename);
+         n_reloaded++;
+         }
+      }
+   if( n_reloaded && tle_tree)
+      {
+      close_tle_tree( );
+      tle_tree = tle_tree_open( tle_tree_name);
+      }
+}
+
 /* We check astrometry first against TLEs from github.com/Bill-Gray/tles,
 then some other sources such as the amateur community's TLEs,  and
 only then against Space-Track TLEs.  If we've already checked an
@@ -1031,44 +1767,468 @@ that we know we have a good handle on.  */
 static double max_expected_error = 180.;
 static int n_tles_expected_in_file = 0;
 
-static int add_tle_to_obs( object_t *objects, const size_t n_objects,
-             const char *tle_file_name, const double search_radius,
-             const double max_revs_per_day)
+/* The radius,  in radians,  within which a TLE must come to an observation
+for us to care about it.  ('max_expected_error' can be reset by the TLE
+file as we go along.)  */
+
+static double index_radius( const double search_radius)
 {
-   char line0[100], line1[100], line2[100];
-   gzFile tle_file;
-   int rval = 0, n_tles_found = 0;
-   bool check_updates = true;
-   bool look_for_tles = true;
-   static bool error_check_date_ranges = true;
-   const clock_t time_started = clock( );
-   static already_found_t *norad_ids = NULL;
-   static size_t n_norad_ids = 0;
-   const double mjd_1970 = 40587.;     /* MJD for 1970 Jan 1 */
-   const double curr_mjd = mjd_1970 + (double)time( NULL) / 86400.;
+   return( (search_radius < max_expected_error ?
+                        search_radius : max_expected_error) * PI / 180.);
+}
 
-   if( !tle_file_name)     /* flag to free internal memory at shutdown */
-      {
-      if( norad_ids)
-         free( norad_ids);
-      norad_ids = NULL;
-      n_norad_ids = 0;
-      return( 0);
-      }
-   tle_file = gzopen( tle_file_name, "rb");
-   if( !tle_file)
-      {
-      char buff[200];      /* try again with .gz added to the filename */
+/* Checking TLEs against the observations is done in batches.  For each
+TLE,  the expensive part -- initializing it,  finding candidate objects,
+and computing where it puts each of them at the time of their first
+observations -- depends only on the TLE and the observations.  That's
+done by find_near_objects( ) for all the TLEs in a batch,  spread across
+'n_threads' threads (set with -j).  Deciding which of those near misses
+are matches depends on what earlier TLEs matched,  and means printing
+them;  add_matches( ) does that afterward,  one TLE at a time and in the
+order they were read.  So the output is the same for any number of
+threads.
+
+   '#' lines in a TLE file (other than '# MJD' lines) can change the
+settings add_matches( ) uses,  or cause output,  or include other files,
+so the batch is finished before they're handled.  But a TLE that
+doesn't match the '# ID:' line resets 'search_norad' by itself,  so each
+job keeps the value that was in effect when its TLE was read.  With -v2
+or above,  each TLE is finished as soon as it's read,  so that any
+messages about it come out next to its matches.
+
+   For resonant deep-space TLEs,  SDP4's result at a given time depends
+on the times it was computed for earlier,  unless there's a checkpoint
+table (see sxpx_init_checkpoints( )).  Each job computes positions for
+a different set of times,  so each gets a table covering the span of
+the observations ('jd_min' to 'jd_max'),  or the part of it within the
+TLE's range (if it has one).  Each position is then found from the
+nearest checkpoint,  whatever else was computed before it.  */
+
+#define TLE_BATCH_SIZE     1024
+#define MAX_THREADS         256
 
-      strlcpy_error( buff, tle_file_name);
-      strlcat_error( buff, ".gz");
-      tle_file = gzopen( buff, "rb");
-      }
-   if( !tle_file)
-      {
-#ifdef ON_LINE_VERSION
-      printf( "<h1> WARNING : '%s' not opened<br>\n", tle_file_name);
-      printf( "Please e-mail pluto\x40projectpluto\x2e\x63om about this. </h1>\n");
+typedef struct
+{
+   size_t obj_idx;
+   double radius, ra, dec, dist;
+   bool in_shadow;
+} near_object_t;
+
+typedef struct
+{
+   tle_t tle;
+   char line0[100];
+   const double *sat_params;     /* = params,  unless from a catalog */
+   double params[N_SAT_PARAMS];
+   sxpx_state_t state;
+   double tle_start, tle_range;
+   int search_norad;             /* as it was when the TLE was read */
+   near_object_t *near;
+   size_t n_near, n_alloced;
+   bool has_checkpoints;
+} tle_job_t;
+
+typedef struct
+{
+   tle_job_t *jobs;
+   size_t n_jobs, next_job;
+   object_t *objects;
+   size_t n_objects;
+   double search_radius, jd_min, jd_max;
+#ifdef USE_PTHREADS
+   pthread_mutex_t mutex;
+#endif
+} tle_batch_t;
+
+static tle_batch_t batch;
+static int n_threads = 1;
+
+/* Finds the objects that the job's TLE puts within the search radius
+at the times of their first observations.  This runs on several threads
+at once,  so it mustn't change anything except 'job' and 'candidates'.  */
+
+static void find_near_objects( tle_job_t *job, const object_t *objects,
+            const size_t n_objects, const double search_radius,
+            const double jd_min, const double jd_max, size_t *candidates)
+{
+   tle_t *tle = &job->tle;
+   size_t n_candidates = n_objects, cand;
+
+   if( !job->sat_params)
+      {
+      if( select_ephemeris( tle))
+         SDP4_init( job->params, tle);
+      else
+         SGP4_init( job->params, tle);
+      job->sat_params = job->params;
+      }
+   if( select_ephemeris( tle))
+      {
+      double t_min = jd_min, t_max = jd_max;
+
+      if( job->tle_range && job->tle_start)     /* only the part of the */
+         {                                      /* span the TLE covers */
+         if( t_min < job->tle_start)
+            t_min = job->tle_start;
+         if( t_max > job->tle_start + job->tle_range)
+            t_max = job->tle_start + job->tle_range;
+         }
+      if( t_min <= t_max)
+         {
+         if( job->sat_params != job->params)    /* catalog params are */
+            {                                   /* read-only */
+            memcpy( job->params, job->sat_params, sizeof( job->params));
+            job->sat_params = job->params;
+            }
+         job->has_checkpoints = (sxpx_init_checkpoints( job->params,
+                     (t_min - tle->epoch) * minutes_per_day,
+                     (t_max - tle->epoch) * minutes_per_day) > 0);
+         }
+      sxpx_init_state( &job->state, job->sat_params);
+      }
+   if( obs_index)
+      n_candidates = find_candidate_objects( obs_index, tle, job->sat_params,
+                  index_radius( search_radius), job->tle_start,
+                  job->tle_range, candidates);
+   job->n_near = 0;
+   for( cand = 0; cand < n_candidates; cand++)
+      {
+      const size_t obj_idx = (obs_index ? candidates[cand] : cand);
+      const object_t *obj_ptr = objects + obj_idx;
+      const OBSERVATION *optr1 = obj_ptr->obs + obj_ptr->idx1;
+      near_object_t near;
+
+      assert( obj_ptr->idx1 <= obj_ptr->idx2);
+      assert( obj_ptr->obs[obj_ptr->idx2].jd >= optr1->jd);
+      if( is_in_range( optr1->jd, job->tle_start, job->tle_range)
+               && !compute_artsat_ra_dec( &near.ra, &near.dec, &near.dist,
+                     optr1, tle, job->sat_params, &job->state, &near.in_shadow))
+         {
+         near.radius = angular_sep( near.ra - optr1->ra, near.dec,
+                                    optr1->dec, NULL) * 180. / PI;
+         if( near.radius < search_radius       /* good enough for us! */
+                     && near.radius < max_expected_error)
+            {
+            if( job->n_near == job->n_alloced)
+               {
+               job->n_alloced = (job->n_alloced ? job->n_alloced * 2 : 8);
+               job->near = (near_object_t *)realloc( job->near,
+                              job->n_alloced * sizeof( near_object_t));
+               assert( job->near);
+               }
+            near.obj_idx = obj_idx;
+            job->near[job->n_near++] = near;
+            }
+         }
+      }
+}
+
+/* Takes the job's near misses in order and adds those that aren't
+already matched to (or ruled out for) that object,  and whose motion
+matches,  to the object's list of matches,  printing each as we go. */
+
+static void add_matches( tle_job_t *job, object_t *objects,
+            const already_found_t *norad_ids, const size_t n_norad_ids)
+{
+   tle_t *tle = &job->tle;
+   size_t k;
+
+   for( k = 0; k < job->n_near; k++)
+      {
+      const near_object_t *near = job->near + k;
+      object_t *obj_ptr = objects + near->obj_idx;
+      const OBSERVATION *optr1 = obj_ptr->obs + obj_ptr->idx1;
+      const OBSERVATION *optr2 = obj_ptr->obs + obj_ptr->idx2;
+      const double ra = near->ra, dec = near->dec, radius = near->radius;
+      const bool in_shadow = near->in_shadow;
+      double dist_to_satellite = near->dist;
+      size_t i = 0;
+
+      if( !job->search_norad && already_found_desig( tle->norad_number,
+                                 n_norad_ids, norad_ids, optr1->jd))
+         continue;
+      while( i < obj_ptr->n_matches
+              && obj_ptr->matches[i].norad_number != tle->norad_number
+              && obj_ptr->matches[i].norad_number)
+         i++;
+      if( i == obj_ptr->n_matches)
+         {
+         double dt = optr2->jd - optr1->jd;
+         const double min_dt = 1e-6;   /* 0.0864 seconds */
+         double motion_diff, ra2, dec2;
+         double temp_array[8];
+         bool show_computed_motion = true;
+
+         assert( dt >= 0.);
+         if( !dt)
+            {
+            OBSERVATION temp_obs = *optr2;
+            double dist2;
+
+            temp_obs.jd += min_dt;
+            if( memcmp( temp_obs.text + 77, "247", 3))
+               set_observer_location( &temp_obs);
+            if( vector3_length( optr2->observer_loc) > 6400.)
+               show_computed_motion = false;   /* spacecraft-based obs */
+            compute_artsat_ra_dec( &ra2, &dec2, &dist2,
+                     &temp_obs, tle, job->sat_params, &job->state, NULL);
+            }
+         else
+            compute_artsat_ra_dec( &ra2, &dec2, &dist_to_satellite,
+                     optr2, tle, job->sat_params, &job->state, NULL);
+         temp_array[0] = ra;     /* starting point (computed) */
+         temp_array[1] = dec;
+         temp_array[2] = ra2;    /* ending point (computed) */
+         temp_array[3] = dec2;
+         temp_array[4] = optr1->ra;  /* starting point (observed) */
+         temp_array[5] = optr1->dec;
+         temp_array[6] = optr2->ra;  /* ending point (observed) */
+         temp_array[7] = optr2->dec;
+         if( !dt)
+            motion_diff = 0.;
+         else
+            motion_diff = relative_motion( temp_array);
+         motion_diff *= 3600. * 180. / PI;  /* cvt to arcseconds */
+         if( motion_diff < motion_mismatch_limit)
+            {
+            char obuff[200];
+            char full_intl_desig[20];
+            double motion_rate = 0., motion_pa = 0.;
+            const double arcminutes_per_radian = 60. * 180. / PI;
+
+            motion_rate = angular_sep( optr1->ra - optr2->ra,
+                                 optr1->dec, optr2->dec, &motion_pa);
+            motion_rate *= arcminutes_per_radian;
+            if( dt)
+               motion_rate /= dt * minutes_per_day;
+            i = 0;
+            while( i < obj_ptr->n_matches && radius > obj_ptr->matches[i].dist)
+               i++;
+            obj_ptr->matches = (match_t *)realloc( obj_ptr->matches,
+                           (obj_ptr->n_matches + 1) * sizeof( match_t));
+            memmove( obj_ptr->matches + i + 1, obj_ptr->matches + i,
+                     (obj_ptr->n_matches - i) * sizeof( match_t));
+            memset( obj_ptr->matches + i, 0, sizeof( match_t));
+            obj_ptr->matches[i].dist = radius;
+            obj_ptr->matches[i].norad_number = tle->norad_number;
+            obj_ptr->n_matches++;
+            strncpy( obj_ptr->matches[i].intl_desig,
+                                             tle->intl_desig, 9);
+            snprintf_err( full_intl_desig, sizeof( full_intl_desig), "%s%.2s-%s",
+                     (tle->intl_desig[0] < '5' ? "20" : "19"),
+                     tle->intl_desig, tle->intl_desig + 2);
+            snprintf_err( obuff, sizeof( obuff), "     %05dU = %-11s ",
+                  tle->norad_number, full_intl_desig);
+            if( tle->ephemeris_type != 'H')
+               snprintf_append( obuff, sizeof( obuff),
+                      "e=%.2f; P=%.1f min; i=%.1f",
+                      tle->eo, 2. * PI / tle->xno,
+                      tle->xincl * 180. / PI);
+            if( tle_checksum( job->line0))         /* object name given... */
+               {
+               char norad_desig[20];
+
+               remove_redundant_desig( job->line0, full_intl_desig);
+               snprintf( norad_desig, sizeof( norad_desig),
+                                  "NORAD %05d", tle->norad_number);
+               remove_redundant_desig( job->line0, norad_desig);
+               snprintf_append( obuff, sizeof( obuff), ": %s", job->line0);
+               }
+            strlcpy( obj_ptr->matches[i].text, obuff + 26, sizeof( obj_ptr->matches[i].text));
+            obuff[79] = '\0';    /* avoid buffer overrun */
+//          snprintf_append( obuff, sizeof( obuff), " motion %f", motion_diff);
+            strlcat_error( obuff, "\n");
+            if( !dt)
+               strlcat_error( obuff,
+                     "             no observed motion (single obs) ");
+            else
+               snprintf_append( obuff, sizeof( obuff),
+                     "             motion %7.4f\"/sec at PA %5.1f;",
+                     motion_rate, motion_pa);
+            snprintf_append( obuff, sizeof( obuff),
+                          " dist=%8.1f km; offset=%7.4f deg\n",
+                          dist_to_satellite, radius);
+                     /* "Speed" is displayed in arcminutes/second,
+                         or in degrees/minute */
+            if( verbose || !field_mode)
+               {
+               printf( "%s\n", optr1->text);
+               printf( "%s", obuff);
+#ifdef SHOW_RA_DEC_OFFSETS
+               printf( "dRA = %.3f  dDec = %.3f\n",
+                           (ra - optr1->ra) * 180. / PI,
+                           (dec - optr1->dec) * 180. / PI);
+#endif
+               }
+            motion_rate = angular_sep( ra - ra2, dec, dec2, &motion_pa);
+            motion_rate *= arcminutes_per_radian;
+            if( dt)
+               motion_rate /= dt * minutes_per_day;
+            else
+               motion_rate /= min_dt * minutes_per_day;
+            if( show_computed_motion && (verbose || !field_mode))
+               printf( "             motion %7.4f\"/sec at PA %5.1f (computed)\n\n",
+                   motion_rate, motion_pa);
+            obj_ptr->matches[i].ra = ra;
+            obj_ptr->matches[i].dec = dec;
+            obj_ptr->matches[i].motion_rate = motion_rate;
+            obj_ptr->matches[i].motion_pa = motion_pa;
+            obj_ptr->matches[i].in_shadow = in_shadow;
+            }
+         }
+      }
+}
+
+static void run_jobs( tle_batch_t *b)
+{
+   size_t *candidates = (size_t *)malloc( (b->n_objects + 1) * sizeof( size_t));
+
+   assert( candidates);
+   for( ;;)
+      {
+      size_t job_no;
+
+#ifdef USE_PTHREADS
+      pthread_mutex_lock( &b->mutex);
+#endif
+      job_no = b->next_job++;
+#ifdef USE_PTHREADS
+      pthread_mutex_unlock( &b->mutex);
+#endif
+      if( job_no >= b->n_jobs)
+         break;
+      find_near_objects( b->jobs + job_no, b->objects, b->n_objects,
+                     b->search_radius, b->jd_min, b->jd_max, candidates);
+      }
+   free( candidates);
+}
+
+#ifdef USE_PTHREADS
+static void *run_jobs_thread( void *arg)
+{
+   run_jobs( (tle_batch_t *)arg);
+   return( NULL);
+}
+#endif
+
+/* Runs find_near_objects( ) for each TLE in the batch,  on up to
+'n_threads' threads (including this one),  then adds the matches in
+order.  If a thread can't be started,  the others just do more jobs. */
+
+static void finish_batch( const already_found_t *norad_ids,
+                                const size_t n_norad_ids)
+{
+   size_t i;
+#ifdef USE_PTHREADS
+   pthread_t threads[MAX_THREADS];
+   bool started[MAX_THREADS];
+   size_t n_helpers = (size_t)n_threads - 1;
+
+   if( n_helpers >= batch.n_jobs)
+      n_helpers = (batch.n_jobs ? batch.n_jobs - 1 : 0);
+   pthread_mutex_init( &batch.mutex, NULL);
+   batch.next_job = 0;
+   for( i = 0; i < n_helpers; i++)
+      started[i] = !pthread_create( threads + i, NULL, run_jobs_thread, &batch);
+   run_jobs( &batch);
+   for( i = 0; i < n_helpers; i++)
+      if( started[i])
+         pthread_join( threads[i], NULL);
+   pthread_mutex_destroy( &batch.mutex);
+#else
+   batch.next_job = 0;
+   run_jobs( &batch);
+#endif
+   for( i = 0; i < batch.n_jobs; i++)
+      {
+      add_matches( batch.jobs + i, batch.objects, norad_ids, n_norad_ids);
+      if( batch.jobs[i].has_checkpoints)
+         sxpx_free_checkpoints( batch.jobs[i].params);
+      batch.jobs[i].has_checkpoints = false;
+      }
+   batch.n_jobs = 0;
+}
+
+static void free_batch( void)
+{
+   size_t i;
+
+   if( batch.jobs)
+      for( i = 0; i < TLE_BATCH_SIZE; i++)
+         {
+         if( batch.jobs[i].has_checkpoints)
+            sxpx_free_checkpoints( batch.jobs[i].params);
+         free( batch.jobs[i].near);
+         }
+   free( batch.jobs);
+   memset( &batch, 0, sizeof( tle_batch_t));
+}
+
+static int add_tle_to_obs( object_t *objects, const size_t n_objects,
+             const char *tle_file_name, const double search_radius,
+             const double max_revs_per_day)
+{
+   char line0[100], line1[100], line2[100];
+   gz_pipe_t *tle_file = NULL;
+   void *catalog;
+   const char *cat_text = NULL;
+   size_t cat_text_size = 0, cat_offset = 0, line_start = 0;
+   int rval = 0, n_tles_found = 0, cat_idx = 0;
+   bool check_updates = true;
+   bool look_for_tles = true;
+   bool is_preloaded;
+   static bool error_check_date_ranges = true;
+   const clock_t time_started = clock( );
+   static already_found_t *norad_ids = NULL;
+   static size_t n_norad_ids = 0;
+   const double mjd_1970 = 40587.;     /* MJD for 1970 Jan 1 */
+   const double curr_mjd = mjd_1970 + (double)time( NULL) / 86400.;
+
+   if( !tle_file_name)     /* flag to free internal memory at shutdown */
+      {
+      if( norad_ids)
+         free( norad_ids);
+      norad_ids = NULL;
+      n_norad_ids = 0;
+      free_batch( );
+      return( 0);
+      }
+   batch.objects = objects;
+   batch.n_objects = n_objects;
+   batch.search_radius = search_radius;
+   if( tle_tree && !check_all_tles)
+      {
+      const tle_tree_entry_t *entry = tle_tree_find( tle_tree, tle_file_name);
+
+      if( entry && entry->header && !got_obs_in_range( objects, n_objects,
+                                 entry->ephem_start + 2400000.5,
+                                 entry->ephem_end + 2400000.5))
+         {
+         cat_text = entry->header;
+         cat_text_size = entry->header_size;
+         }
+      }
+   catalog = (cat_text ? NULL : find_preloaded( tle_file_name));
+   is_preloaded = (catalog != NULL);
+   if( !cat_text && !catalog)
+      catalog = open_tle_catalog( tle_file_name);
+   if( catalog)
+      cat_text = sat_catalog_text( catalog, &cat_text_size);
+   else if( !cat_text)
+      tle_file = gz_pipe_open( tle_file_name);
+   if( !cat_text && !tle_file)
+      {
+      char buff[200];      /* try again with .gz added to the filename */
+
+      strlcpy_error( buff, tle_file_name);
+      strlcat_error( buff, ".gz");
+      tle_file = gz_pipe_open( buff);
+      }
+   if( !cat_text && !tle_file)
+      {
+#ifdef ON_LINE_VERSION
+      printf( "<h1> WARNING : '%s' not opened<br>\n", tle_file_name);
+      printf( "Please e-mail pluto\x40projectpluto\x2e\x63om about this. </h1>\n");
 #else
       fprintf( stderr, "WARNING : '%s' not opened\n", tle_file_name);
       fprintf( stderr, "Please e-mail pluto\x40projectpluto\x2e\x63om about this.\n");
@@ -1076,18 +2236,24 @@ static int add_tle_to_obs( object_t *objects, const size_t n_objects,
       return( -1);
       }
    if( verbose)
-      printf( "Looking through TLE file '%s', %u objs, radius %f, max %f revs/day\n",
-                 tle_file_name, (unsigned)n_objects, search_radius, max_revs_per_day);
+      printf( "Looking through TLE file '%s'%s, %u objs, radius %f, max %f revs/day\n",
+                 tle_file_name, (catalog ? " (catalog)" : (cat_text ? " (index)" : "")),
+                 (unsigned)n_objects, search_radius, max_revs_per_day);
    *line0 = *line1 = '\0';
-   while( gzgets_trimmed( tle_file, line2, sizeof( line2)))
+   while( cat_text ? catalog_gets( cat_text, cat_text_size, &cat_offset,
+                                 &line_start, line2, sizeof( line2))
+                  : gzgets_trimmed( tle_file, line2, sizeof( line2)) != NULL)
       {
       tle_t tle;  /* Structure for two-line elements set for satellite */
+      const double *sat_params = NULL;
       const double mins_per_day = 24. * 60.;
       bool is_a_tle = false;
 
       if( verbose > 3)
          printf( "%s\n", line2);
-      if( look_for_tles && parse_elements( line1, line2, &tle) >= 0)
+      if( look_for_tles && (catalog ?
+                  get_catalog_tle( catalog, line_start, &cat_idx, &tle, &sat_params)
+                  : parse_elements( line1, line2, &tle) >= 0))
          {
          is_a_tle = true;
          n_tles_found++;
@@ -1106,176 +2272,33 @@ static int add_tle_to_obs( object_t *objects, const size_t n_objects,
             *search_intl = '\0';
             }
          }
+      if( batch.n_jobs && *line2 == '#' && memcmp( line2, "# MJD ", 6))
+         finish_batch( norad_ids, n_norad_ids);
       if( is_a_tle && (tle.ephemeris_type == 'H'
                  || tle.xno < 2. * PI * max_revs_per_day / mins_per_day)
                  && (!norad_id || norad_id == tle.norad_number)
-                 && (!intl_desig || !_compare_intl_desigs( tle.intl_desig, intl_desig)))
+                 && (!intl_desig || !_compare_intl_desigs( tle.intl_desig, intl_desig))
+                 && (!obs_index || tle_may_be_observed( obs_index, &tle,
+                                       index_radius( search_radius))))
          {                           /* hey! we got a TLE! */
-         double sat_params[N_SAT_PARAMS];
-         size_t idx;
+         tle_job_t *job;
 
          if( verbose > 1)
             printf( "TLE found:\n%s\n%s\n", line1, line2);
-         if( select_ephemeris( &tle))
-            SDP4_init( sat_params, &tle);
-         else
-            SGP4_init( sat_params, &tle);
-         for( idx = 0; idx < n_objects; idx++)
+         if( !batch.jobs)
             {
-            object_t *obj_ptr = objects + idx;
-            const OBSERVATION *optr1 = obj_ptr->obs + obj_ptr->idx1;
-            const OBSERVATION *optr2 = obj_ptr->obs + obj_ptr->idx2;
-
-            assert( obj_ptr->idx1 <= obj_ptr->idx2);
-            assert( optr2->jd >= optr1->jd);
-            if( is_in_range( optr1->jd, tle_start, tle_range) &&
-                 (search_norad || !already_found_desig( tle.norad_number, n_norad_ids, norad_ids, optr1->jd)))
-               {
-               double radius;
-               double ra, dec, dist_to_satellite;
-               int sxpx_rval;
-               size_t i = 0;
-               bool in_shadow;
-
-               sxpx_rval = compute_artsat_ra_dec( &ra, &dec, &dist_to_satellite,
-                              optr1, &tle, sat_params, &in_shadow);
-               radius = angular_sep( ra - optr1->ra, dec, optr1->dec, NULL) * 180. / PI;
-               while( i < obj_ptr->n_matches
-                       && obj_ptr->matches[i].norad_number != tle.norad_number
-                       && obj_ptr->matches[i].norad_number)
-                  i++;
-               if( !sxpx_rval && radius < search_radius      /* good enough for us! */
-                       && radius < max_expected_error
-                       && i == obj_ptr->n_matches)
-                  {
-                  double dt = optr2->jd - optr1->jd;
-                  const double min_dt = 1e-6;   /* 0.0864 seconds */
-                  double motion_diff, ra2, dec2;
-                  double temp_array[8];
-                  bool show_computed_motion = true;
-
-                  assert( dt >= 0.);
-                  if( !dt)
-                     {
-                     OBSERVATION temp_obs = *optr2;
-                     double dist2;
-
-                     temp_obs.jd += min_dt;
-                     if( memcmp( temp_obs.text + 77, "247", 3))
-                        set_observer_location( &temp_obs);
-                     if( vector3_length( optr2->observer_loc) > 6400.)
-                        show_computed_motion = false;   /* spacecraft-based obs */
-                     compute_artsat_ra_dec( &ra2, &dec2, &dist2,
-                              &temp_obs, &tle, sat_params, NULL);
-                     }
-                  else
-                     compute_artsat_ra_dec( &ra2, &dec2, &dist_to_satellite,
-                              optr2, &tle, sat_params, NULL);
-                  temp_array[0] = ra;     /* starting point (computed) */
-                  temp_array[1] = dec;
-                  temp_array[2] = ra2;    /* ending point (computed) */
-                  temp_array[3] = dec2;
-                  temp_array[4] = optr1->ra;  /* starting point (observed) */
-                  temp_array[5] = optr1->dec;
-                  temp_array[6] = optr2->ra;  /* ending point (observed) */
-                  temp_array[7] = optr2->dec;
-                  if( !dt)
-                     motion_diff = 0.;
-                  else
-                     motion_diff = relative_motion( temp_array);
-                  motion_diff *= 3600. * 180. / PI;  /* cvt to arcseconds */
-                  if( motion_diff < motion_mismatch_limit)
-                     {
-                     char obuff[200];
-                     char full_intl_desig[20];
-                     double motion_rate = 0., motion_pa = 0.;
-                     const double arcminutes_per_radian = 60. * 180. / PI;
-
-                     motion_rate = angular_sep( optr1->ra - optr2->ra,
-                                          optr1->dec, optr2->dec, &motion_pa);
-                     motion_rate *= arcminutes_per_radian;
-                     if( dt)
-                        motion_rate /= dt * minutes_per_day;
-                     line1[8] = line1[16] = '\0';
-                     memcpy( line1 + 30, line1 + 11, 6);
-                     line1[11] = '\0';
-                     i = 0;
-                     while( i < obj_ptr->n_matches && radius > obj_ptr->matches[i].dist)
-                        i++;
-                     obj_ptr->matches = (match_t *)realloc( obj_ptr->matches,
-                                    (obj_ptr->n_matches + 1) * sizeof( match_t));
-                     memmove( obj_ptr->matches + i + 1, obj_ptr->matches + i,
-                              (obj_ptr->n_matches - i) * sizeof( match_t));
-                     memset( obj_ptr->matches + i, 0, sizeof( match_t));
-                     obj_ptr->matches[i].dist = radius;
-                     obj_ptr->matches[i].norad_number = tle.norad_number;
-                     obj_ptr->n_matches++;
-                     strncpy( obj_ptr->matches[i].intl_desig,
-                                                      tle.intl_desig, 9);
-                     snprintf_err( full_intl_desig, sizeof( full_intl_desig), "%s%.2s-%s",
-                              (tle.intl_desig[0] < '5' ? "20" : "19"),
-                              tle.intl_desig, tle.intl_desig + 2);
-                     snprintf_err( obuff, sizeof( obuff), "     %05dU = %-11s ",
-                           tle.norad_number, full_intl_desig);
-                     if( tle.ephemeris_type != 'H')
-                        snprintf_append( obuff, sizeof( obuff),
-                               "e=%.2f; P=%.1f min; i=%.1f",
-                               tle.eo, 2. * PI / tle.xno,
-                               tle.xincl * 180. / PI);
-                     if( tle_checksum( line0))         /* object name given... */
-                        {
-                        char norad_desig[20];
-
-                        remove_redundant_desig( line0, full_intl_desig);
-                        snprintf( norad_desig, sizeof( norad_desig),
-                                           "NORAD %05d", tle.norad_number);
-                        remove_redundant_desig( line0, norad_desig);
-                        snprintf_append( obuff, sizeof( obuff), ": %s", line0);
-                        }
-                     strlcpy( obj_ptr->matches[i].text, obuff + 26, sizeof( obj_ptr->matches[i].text));
-                     obuff[79] = '\0';    /* avoid buffer overrun */
-//                   snprintf_append( obuff, sizeof( obuff), " motion %f", motion_diff);
-                     strlcat_error( obuff, "\n");
-                     if( !dt)
-                        strlcat_error( obuff,
-                              "             no observed motion (single obs) ");
-                     else
-                        snprintf_append( obuff, sizeof( obuff),
-                              "             motion %7.4f\"/sec at PA %5.1f;",
-                              motion_rate, motion_pa);
-                     snprintf_append( obuff, sizeof( obuff),
-                                   " dist=%8.1f km; offset=%7.4f deg\n",
-                                   dist_to_satellite, radius);
-                              /* "Speed" is displayed in arcminutes/second,
-                                  or in degrees/minute */
-                     if( verbose || !field_mode)
-                        {
-                        printf( "%s\n", optr1->text);
-                        printf( "%s", obuff);
-#ifdef SHOW_RA_DEC_OFFSETS
-                        printf( "dRA = %.3f  dDec = %.3f\n",
-                                    (ra - optr1->ra) * 180. / PI,
-                                    (dec - optr1->dec) * 180. / PI);
-#endif
-                        }
-                     motion_rate = angular_sep( ra - ra2, dec, dec2, &motion_pa);
-                     motion_rate *= arcminutes_per_radian;
-                     if( dt)
-                        motion_rate /= dt * minutes_per_day;
-                     else
-                        motion_rate /= min_dt * minutes_per_day;
-                     if( show_computed_motion && (verbose || !field_mode))
-                        printf( "             motion %7.4f\"/sec at PA %5.1f (computed)\n\n",
-                            motion_rate, motion_pa);
-                     obj_ptr->matches[i].ra = ra;
-                     obj_ptr->matches[i].dec = dec;
-                     obj_ptr->matches[i].motion_rate = motion_rate;
-                     obj_ptr->matches[i].motion_pa = motion_pa;
-                     obj_ptr->matches[i].in_shadow = in_shadow;
-                     }
-                  }
-               }
+            batch.jobs = (tle_job_t *)calloc( TLE_BATCH_SIZE, sizeof( tle_job_t));
+            assert( batch.jobs);
             }
+         job = batch.jobs + batch.n_jobs++;
+         job->tle = tle;
+         strlcpy_error( job->line0, line0);
+         job->sat_params = sat_params;    /* NULL unless from a catalog */
+         job->tle_start = tle_start;
+         job->tle_range = tle_range;
+         job->search_norad = search_norad;
+         if( batch.n_jobs == TLE_BATCH_SIZE || verbose > 1)
+            finish_batch( norad_ids, n_norad_ids);
          }
       else if( !strncmp( line2, "# No updates", 12))
          check_updates = false;
@@ -1340,7 +2363,10 @@ static int add_tle_to_obs( object_t *objects, const size_t n_objects,
             if( verbose)
                fprintf( stderr, REVERSE_VIDEO "'%s' contains no TLEs for our time range\n"
                                NORMAL_VIDEO, tle_file_name);
-            gzclose( tle_file);
+            if( catalog && !is_preloaded)
+               sat_catalog_close( catalog);
+            else if( tle_file)
+               gz_pipe_close( tle_file);
             return( 0);
             }
          }
@@ -1428,6 +2454,8 @@ static int add_tle_to_obs( object_t *objects, const size_t n_objects,
       strlcpy_error( line0, line1);
       strlcpy_error( line1, line2);
       }
+   if( batch.n_jobs)
+      finish_batch( norad_ids, n_norad_ids);
    if( verbose)
       printf( "%d TLEs read from '%s', %.3f seconds\n", n_tles_found,
                 tle_file_name,
@@ -1445,7 +2473,10 @@ static int add_tle_to_obs( object_t *objects, const size_t n_objects,
 #endif
       printf( "Please e-mail the author (pluto at projectpluto dot com) about this.\n");
       }
-   gzclose( tle_file);
+   if( catalog && !is_preloaded)
+      sat_catalog_close( catalog);
+   else if( tle_file)
+      gz_pipe_close( tle_file);
    return( rval);
 }
 
@@ -1484,6 +2515,575 @@ static char *unpack_intl( const char *packed, char *unpacked)
    return( unpacked);
 }
 
+/* Runs the objects against the TLEs in 'tle_file_name' and the files it
+includes,  filling in their matches.  Used for the whole input in the
+usual case,  and for each tracklet as it becomes ready in streaming mode.
+The caller sets up 'lunar_solar' to cover the observations,  and opens
+the tree index,  if wanted;  only the observation index is built here. */
+
+static int identify_objects( object_t *objects, const size_t n_objects,
+             const char *tle_file_name, const double search_radius,
+             const double max_revs_per_day)
+{
+   size_t i, j;
+   int rval;
+
+   batch.jd_min = jan_1_2057;
+   batch.jd_max = oct_4_1957;
+   for( i = 0; i < n_objects; i++)
+      for( j = 0; j < objects[i].n_obs; j++)
+         {
+         if( batch.jd_min > objects[i].obs[j].jd)
+            batch.jd_min = objects[i].obs[j].jd;
+         if( batch.jd_max < objects[i].obs[j].jd)
+            batch.jd_max = objects[i].obs[j].jd;
+         }
+   obs_index = create_obs_index( objects, n_objects);
+   rval = add_tle_to_obs( objects, n_objects, tle_file_name, search_radius,
+                                    max_revs_per_day);
+   add_tle_to_obs( NULL, 0, NULL, 0., 0.);
+   free_obs_index( obs_index);
+   obs_index = NULL;
+   return( rval);
+}
+
+/* Shows the tracklet ID,  the NORAD number(s) and international
+designation(s) it matched,  and (if there's only one) the name. */
+
+static void show_object_ids( const object_t *obj)
+{
+   char buff[30];
+   size_t j;
+
+   printf( "%.12s ", obj->obs->text);
+   for( j = 0; j < obj->n_matches; j++)
+      printf( " %05d %s", obj->matches[j].norad_number,
+                   unpack_intl( obj->matches[j].intl_desig, buff));
+   if( obj->n_matches == 1)
+      {
+      char *tptr = strchr( obj->matches[0].text, ':');
+
+      if( tptr)                   /* if only one match,  output */
+         printf( " %s", tptr + 1);   /* the object name */
+      }
+}
+
+/* Streaming mode (-F).  Normally,  we read all the observations,  sort
+them,  group them into tracklets,  and only then look through the TLEs.
+For a live feed,  where observations trickle in all night,  we instead
+read them as they arrive (from stdin,  if the input file is '-') and
+keep the open tracklets in an array sorted by their twelve-character
+IDs.  As soon as a tracklet has a pair of observations fast enough to be
+checked (see find_good_pair( )),  it's identified and the result shown.
+The TLEs are loaded once,  at the start (see preload_tle_file( )),  and
+checked for changes at most once a minute.
+
+   A tracklet is closed (and forgotten) once we see an observation more
+than 'window' days after its last one;  if it never got a usable pair
+and is a single observation,  it's identified then (unless -1 was used).
+Later observations of an already-identified tracklet are kept,  so it
+isn't mistaken for a new one,  but don't cause it to be checked again. */
+
+typedef struct
+{
+   object_t obj;
+   size_t n_alloced;
+   bool identified;
+} tracklet_t;
+
+typedef struct
+{
+   tracklet_t *tracklets;
+   size_t n_tracklets, n_alloced;
+   const char *tle_file_name;
+   double search_radius, max_revs_per_day, speed_cutoff;
+   double window, latest_jd, last_sweep_jd;
+   double lunar_solar_start, lunar_solar_end;
+   time_t last_reload;
+} stream_t;
+
+static void identify_tracklet( stream_t *s, tracklet_t *t)
+{
+   object_t *obj = &t->obj;
+   const double jd_min = obj->obs[0].jd;
+   const double jd_max = obj->obs[obj->n_obs - 1].jd;
+
+   if( time( NULL) > s->last_reload + 60)
+      {
+      reload_changed_tle_files( );
+      s->last_reload = time( NULL);
+      }
+   if( !lunar_solar || jd_min - 1. < s->lunar_solar_start
+                    || jd_max + 1. > s->lunar_solar_end)
+      {                 /* cover the next few days,  not just this tracklet */
+      lunar_solar_free( lunar_solar);
+      s->lunar_solar_start = jd_min - 1.;
+      s->lunar_solar_end = jd_max + 3.;
+      lunar_solar = lunar_solar_init( s->lunar_solar_start, s->lunar_solar_end);
+      }
+   identify_objects( obj, 1, s->tle_file_name, s->search_radius,
+                                          s->max_revs_per_day);
+   printf( "\n");
+   show_object_ids( obj);
+   printf( "%s\n", (obj->n_matches ? "" : " (no match)"));
+   fflush( stdout);
+   free( obj->matches);
+   obj->matches = NULL;
+   obj->n_matches = 0;
+   t->identified = true;
+}
+
+/* Closes tracklets whose last observation was before 'jd_limit'. */
+
+static void close_tracklets( stream_t *s, const double jd_limit)
+{
+   size_t i, j;
+
+   for( i = j = 0; i < s->n_tracklets; i++)
+      {
+      tracklet_t *t = s->tracklets + i;
+
+      if( t->obj.obs[t->obj.n_obs - 1].jd < jd_limit)
+         {
+         if( !t->identified && t->obj.n_obs == 1 && include_singletons)
+            identify_tracklet( s, t);
+         free( t->obj.obs);
+         }
+      else
+         s->tracklets[j++] = *t;
+      }
+   s->n_tracklets = j;
+   s->last_sweep_jd = s->latest_jd;
+}
+
+static void add_stream_obs( stream_t *s, const OBSERVATION *obs)
+{
+   size_t lo = 0, hi = s->n_tracklets, i;
+   tracklet_t *t;
+
+   while( lo < hi)      /* binary search for the tracklet ID */
+      {
+      const size_t mid = (lo + hi) / 2;
+
+      if( memcmp( s->tracklets[mid].obj.obs->text, obs->text, 12) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+      }
+   if( lo == s->n_tracklets || id_compare( s->tracklets[lo].obj.obs, obs))
+      {                          /* new tracklet */
+      if( s->n_tracklets == s->n_alloced)
+         {
+         s->n_alloced = 2 * s->n_alloced + 16;
+         s->tracklets = (tracklet_t *)realloc( s->tracklets,
+                              s->n_alloced * sizeof( tracklet_t));
+         assert( s->tracklets);
+         }
+      memmove( s->tracklets + lo + 1, s->tracklets + lo,
+                        (s->n_tracklets - lo) * sizeof( tracklet_t));
+      s->n_tracklets++;
+      memset( s->tracklets + lo, 0, sizeof( tracklet_t));
+      }
+   t = s->tracklets + lo;
+   if( t->obj.n_obs == t->n_alloced)
+      {
+      t->n_alloced = 2 * t->n_alloced + 4;
+      t->obj.obs = (OBSERVATION *)realloc( t->obj.obs,
+                              t->n_alloced * sizeof( OBSERVATION));
+      assert( t->obj.obs);
+      }
+   i = t->obj.n_obs++;           /* keep the observations sorted by time */
+   while( i && t->obj.obs[i - 1].jd > obs->jd)
+      {
+      t->obj.obs[i] = t->obj.obs[i - 1];
+      i--;
+      }
+   t->obj.obs[i] = *obs;
+   if( !t->identified && t->obj.n_obs > 1)
+      {
+      t->obj.speed = find_good_pair( t->obj.obs, t->obj.n_obs,
+                                    &t->obj.idx1, &t->obj.idx2);
+      if( t->obj.speed >= s->speed_cutoff)
+         identify_tracklet( s, t);
+      }
+   if( s->latest_jd < obs->jd)
+      s->latest_jd = obs->jd;
+   if( s->latest_jd > s->last_sweep_jd + 1. / minutes_per_day)
+      close_tracklets( s, s->latest_jd - s->window);
+}
+
+/* As in get_observations_from_file( ),  except that a spacecraft or
+roving observation's 'second line' has to follow its first line. */
+
+static int run_stream( stream_t *s, FILE *ifile, const double t_low,
+                                                const double t_high)
+{
+   void *ades_context = init_ades2mpc( );
+   OBSERVATION obs, pending;
+   bool have_pending = false;
+   char buff[400];
+   int n_errors_found = 0;
+
+   assert( ades_context);
+   preload_tle_file( s->tle_file_name);
+   open_tle_tree( s->tle_file_name);
+   s->last_reload = time( NULL);
+   memset( &obs, 0, sizeof( OBSERVATION));
+   while( fgets_with_ades_xlation( buff, sizeof( buff), ades_context, ifile))
+      if( !get_mpc_data( &obs, buff) && obs.jd > t_low && obs.jd < t_high
+                   && (!_target_desig || strstr( buff, _target_desig)))
+         {
+         if( buff[14] == 's' || buff[14] == 'v')
+            {
+            offset_t toff;
+
+            get_offset_data( &toff, buff, obs.jd, &n_errors_found);
+            if( have_pending && offset_matches_obs( &toff, &pending))
+               {
+               memcpy( pending.observer_loc, toff.posn, 3 * sizeof( double));
+               add_stream_obs( s, &pending);
+               }
+            else if( n_errors_found++ < 10)
+               fprintf( stderr, REVERSE_VIDEO "Unmatched artsat obs for JD %f\n"
+                        NORMAL_VIDEO, obs.jd);
+            have_pending = false;
+            }
+         else if( !set_observer_location( &obs))
+            {
+            have_pending = (buff[14] == 'S' || buff[14] == 'V');
+            if( have_pending)
+               pending = obs;
+            else
+               add_stream_obs( s, &obs);
+            }
+         }
+      else if( !memcmp( buff, "COM Long.", 9))
+         strlcpy_error( xxx_location, buff);
+   close_tracklets( s, jan_1_2057);
+   close_tle_tree( );
+   lunar_solar_free( lunar_solar);
+   lunar_solar = NULL;
+   free( s->tracklets);
+   free_ades2mpc_context( ades_context);
+   return( 0);
+}
+
+/* Server mode.  'sat_id -D (socket)' reads ObsCodes.html and all the
+TLE files once,  then listens on a Unix-domain socket.  'sat_id -C
+(socket) (other options)' (or sat_id2 and sat_id3) connects to it,  and
+sends the command-line arguments,  one per line,  then an empty line,
+then the astrometry,  then shuts down its side of the connection.  The
+server forks a child to handle each request;  the child has its own
+copy (copy-on-write) of the already-loaded TLEs and station data,  runs
+the request just as if it had been given on the command line,  and
+sends back its standard output.  Requests are thus handled
+concurrently,  and skip nearly all the start-up cost.  */
+
+#if !defined( _WIN32) && !defined( __WATCOMC__)
+
+#define MAX_REQUEST_SIZE      (64 << 20)
+#define MAX_REQUEST_ARGS      50
+#define MAX_SERVER_CHILDREN   16
+
+static int run_sat_id( const int argc, const char **argv);
+
+static char *read_request( const int conn, size_t *request_size)
+{
+   size_t allocated = 65536, n_read = 0;
+   char *buff = (char *)malloc( allocated + 1);
+   ssize_t n;
+
+   while( buff && (n = read( conn, buff + n_read, allocated - n_read)) > 0)
+      {
+      n_read += (size_t)n;
+      if( n_read == allocated)
+         {
+         char *new_buff = NULL;
+
+         allocated *= 2;
+         if( allocated <= MAX_REQUEST_SIZE)
+            new_buff = (char *)realloc( buff, allocated + 1);
+         if( !new_buff)
+            free( buff);
+         buff = new_buff;
+         }
+      }
+   if( buff)
+      buff[n_read] = '\0';
+   *request_size = n_read;
+   return( buff);
+}
+
+static void send_error( const int conn, const char *message)
+{
+   char buff[200];
+   size_t len;
+
+   snprintf_err( buff, sizeof( buff), "sat_id server: %s\n", message);
+   len = strlen( buff);
+   if( write( conn, buff, len) != (ssize_t)len)
+      perror( "send_error");
+}
+
+/* Only options that affect what is searched for and how it's shown are
+accepted over the socket.  In particular,  -o/-O would let anyone who
+can connect have the server write to any file it can write to,  and
+-C, -D, -F, -j and -t make no sense for a request.  A parameter can be
+given as a separate argument,  following its option.  */
+
+static bool option_allowed_in_request( const char *arg)
+{
+   return( arg[0] == '-' && arg[1] && strchr( "abcmnryzl1vu", arg[1]));
+}
+
+/* Runs in the forked child.  The astrometry goes to a temporary file,
+which becomes the input file,  and the server's TLE list is used.  Only
+standard output goes back to the client;  warnings sent to standard
+error go to the server's log.  */
+
+static int serve_request( const int conn, const char *tle_file_name)
+{
+   size_t request_size, n_args = 0;
+   char *request = read_request( conn, &request_size), *tptr = request;
+   char temp_name[30], tle_arg[260];
+   const char *argv[MAX_REQUEST_ARGS + 4];
+   bool param_may_follow = false;
+   int fd, rval;
+
+   if( !request)
+      {
+      send_error( conn, "request too large,  or out of memory");
+      return( -1);
+      }
+   argv[n_args++] = "sat_id";
+   strlcpy_error( temp_name, "/tmp/sat_id_XXXXXX");
+   argv[n_args++] = temp_name;
+   while( *tptr && *tptr != '\n')
+      {
+      char *eol = strchr( tptr, '\n');
+
+      if( !eol)
+         break;
+      *eol = '\0';
+      if( option_allowed_in_request( tptr)
+                  || (param_may_follow && tptr[0] != '-'))
+         {
+         if( n_args < MAX_REQUEST_ARGS)
+            argv[n_args++] = tptr;
+         param_may_follow = (tptr[0] == '-' && !tptr[2]);
+         }
+      else
+         {
+         char message[150];
+
+         snprintf_err( message, sizeof( message),
+                     "argument '%.100s' isn't allowed", tptr);
+         send_error( conn, message);
+         free( request);
+         return( -1);
+         }
+      tptr = eol + 1;
+      }
+   if( *tptr == '\n')
+      tptr++;
+   snprintf_err( tle_arg, sizeof( tle_arg), "-t%s", tle_file_name);
+   argv[n_args++] = tle_arg;
+   argv[n_args] = NULL;
+   fd = mkstemp( temp_name);
+   if( fd < 0)
+      {
+      perror( "mkstemp");
+      send_error( conn, "couldn't create a temporary file");
+      free( request);
+      return( -1);
+      }
+   rval = (write( fd, tptr, request_size - (size_t)( tptr - request))
+                  == (ssize_t)( request_size - (size_t)( tptr - request)));
+   close( fd);
+   if( rval)
+      {
+      dup2( conn, STDOUT_FILENO);
+      verbose = 0;
+      rval = run_sat_id( (int)n_args, argv);
+      fflush( stdout);
+      }
+   else
+      {
+      perror( "write");
+      send_error( conn, "couldn't write the temporary file");
+      rval = -1;
+      }
+   unlink( temp_name);
+   free( request);
+   return( rval);
+}
+
+/* The socket is created with a umask of 077,  so only the user the
+server runs as can send it requests.  At most MAX_SERVER_CHILDREN
+requests are handled at once;  further connections wait (in the
+listen( ) queue) until one finishes.  SIGCHLD interrupts accept( ),
+so that finished children are reaped promptly.  */
+
+static void child_exited( int sig)
+{
+   INTENTIONALLY_UNUSED_PARAMETER( sig);
+}
+
+static int run_server( const char *socket_name, const char *tle_file_name)
+{
+   struct sockaddr_un addr;
+   char buff[200];
+   int listener = socket( AF_UNIX, SOCK_STREAM, 0), n_tles = 0;
+   int n_children = 0, err;
+   mode_t old_umask;
+   struct sigaction sig_act;
+   size_t i;
+
+   memset( &addr, 0, sizeof( addr));
+   addr.sun_family = AF_UNIX;
+   strlcpy_error( addr.sun_path, socket_name);
+   unlink( socket_name);
+   old_umask = umask( 077);
+   err = (listener < 0 || bind( listener, (struct sockaddr *)&addr, sizeof( addr)));
+   umask( old_umask);
+   if( err || listen( listener, SOMAXCONN))
+      {
+      fprintf( stderr, "Couldn't listen on '%s' : ", socket_name);
+      perror( NULL);
+      return( -1);
+      }
+   memset( &sig_act, 0, sizeof( sig_act));
+   sig_act.sa_handler = child_exited;    /* no SA_RESTART */
+   sigemptyset( &sig_act.sa_mask);
+   sigaction( SIGCHLD, &sig_act, NULL);
+   get_station_code_data( buff, "500");
+   preload_tle_file( tle_file_name);
+   for( i = 0; i < n_preloaded; i++)
+      if( preloaded[i].catalog)
+         n_tles += sat_catalog_n_entries( preloaded[i].catalog);
+   printf( "%u files,  %d TLEs loaded;  listening on '%s'\n",
+                  (unsigned)n_preloaded, n_tles, socket_name);
+   fflush( stdout);
+   for( ;;)
+      {
+      int conn;
+      pid_t pid;
+
+      while( n_children && waitpid( -1, NULL, WNOHANG) > 0)
+         n_children--;               /* reap finished children */
+      while( n_children >= MAX_SERVER_CHILDREN)
+         if( waitpid( -1, NULL, 0) > 0)
+            n_children--;
+         else if( errno != EINTR)
+            n_children = 0;         /* shouldn't happen;  no children left */
+      conn = accept( listener, NULL, NULL);
+      if( conn < 0)
+         {
+         if( errno == EINTR)
+            continue;
+         perror( "accept");
+         break;
+         }
+      reload_changed_tle_files( );
+      fflush( NULL);
+      pid = fork( );
+      if( !pid)
+         {
+         close( listener);
+         exit( serve_request( conn, tle_file_name));
+         }
+      if( pid == (pid_t)-1)
+         {
+         perror( "fork");
+         send_error( conn, "couldn't start a process for the request");
+         }
+      else
+         n_children++;
+      close( conn);
+      }
+   close( listener);
+   return( -1);
+}
+
+/* Sends the request to a server,  and copies its output to stdout.
+Returns -1 if there's no server,  or it fails before sending back any
+output,  or the request has options the server won't accept (see
+option_allowed_in_request( )),  so that the caller can just go ahead
+and do the work itself. */
+
+static int run_client( const char *socket_name, const int argc,
+                     const char **argv, const char *ifilename)
+{
+   struct sockaddr_un addr;
+   FILE *ifile;
+   char buff[4096];
+   size_t n;
+   ssize_t n_read;
+   int sock, i, rval = 0;
+
+   for( i = 1; i < argc; i++)       /* can the server handle this request? */
+      if( argv[i] == ifilename || option_allowed_in_request( argv[i]))
+         ;
+      else if( argv[i][0] == '-' && strchr( "Ctj", argv[i][1]))
+         {
+         if( !argv[i][2])           /* skip the separate parameter */
+            i++;
+         }
+      else if( argv[i][0] == '-' || argv[i - 1][0] != '-' || argv[i - 1][2])
+         return( -1);               /* no;  just run it locally */
+   memset( &addr, 0, sizeof( addr));
+   addr.sun_family = AF_UNIX;
+   strlcpy_error( addr.sun_path, socket_name);
+   sock = socket( AF_UNIX, SOCK_STREAM, 0);
+   if( sock < 0)
+      return( -1);
+   if( connect( sock, (struct sockaddr *)&addr, sizeof( addr)))
+      {
+      close( sock);
+      return( -1);
+      }
+   ifile = fopen( ifilename, "rb");
+   if( !ifile)
+      {
+      close( sock);
+      return( -1);
+      }
+   signal( SIGPIPE, SIG_IGN);
+   for( i = 1; !rval && i < argc; i++)
+      if( argv[i] == ifilename)
+         ;
+      else if( argv[i][0] == '-' && strchr( "Ctj", argv[i][1]))
+         {
+         if( !argv[i][2])           /* the server has its own TLEs,  and */
+            i++;                    /* -C and -j don't matter to it */
+         }
+      else
+         {
+         snprintf_err( buff, sizeof( buff), "%s\n", argv[i]);
+         n = strlen( buff);
+         if( write( sock, buff, n) != (ssize_t)n)
+            rval = -1;
+         }
+   if( !rval && write( sock, "\n", 1) != 1)
+      rval = -1;
+   while( !rval && (n = fread( buff, 1, sizeof( buff), ifile)) > 0)
+      if( write( sock, buff, n) != (ssize_t)n)
+         rval = -1;
+   fclose( ifile);
+   shutdown( sock, SHUT_WR);
+   n_read = (rval ? 0 : read( sock, buff, sizeof( buff)));
+   if( n_read <= 0)
+      rval = -1;
+   while( n_read > 0)
+      {
+      fwrite( buff, 1, (size_t)n_read, stdout);
+      n_read = read( sock, buff, sizeof( buff));
+      }
+   close( sock);
+   return( rval);
+}
+#endif
+
 /* The "on-line version",  sat_id2,  gathers data from a CGI multipart form,
    puts it into a file,  possibly adds in some options,  puts together the
    command-line arguments,  and then calls sat_id_main.  See 'sat_id2.cpp'.
@@ -1493,17 +3093,14 @@ static char *unpack_intl( const char *packed, char *unpacked)
    searched for in the current directory,  then in ~/.find_orb,  then in
    ~/.find_orb/tles,  then in ~/tles.    */
 
-#ifdef ON_LINE_VERSION
-int sat_id_main( const int argc, const char **argv)
-#else
-int main( const int argc, const char **argv)
-#endif
+static int run_sat_id( const int argc, const char **argv)
 {
    char tle_file_name[256];
    const char *tname = "tle_list.txt";
    const char *output_astrometry_filename = NULL;
    bool output_only_matches = false;
    const char *ifilename = NULL;
+   const char *server_socket = NULL, *client_socket = NULL;
    FILE *ifile;
    OBSERVATION *obs;
    object_t *objects;
@@ -1521,6 +3118,8 @@ int main( const int argc, const char **argv)
    double speed_cutoff = 0.001;
    double t_low = oct_4_1957;
    double t_high = jan_1_2057;
+   double stream_window = 0.;    /* in days;  zero = not streaming */
+   double jd_min, jd_max;
    int rval, i, j, prev_i;
    bool show_summary = false, add_new_line = false, all_single = false;
 
@@ -1531,7 +3130,7 @@ int main( const int argc, const char **argv)
       }
 
    for( i = 1; i < argc; i++)
-      if( argv[i][0] == '-')
+      if( argv[i][0] == '-' && argv[i][1])      /* '-' alone = stdin */
          {
          const char *param = argv[i] + 2;
 
@@ -1551,12 +3150,35 @@ int main( const int argc, const char **argv)
             case 'c':
                check_all_tles = true;
                break;
+            case 'C':
+               client_socket = param;
+               break;
             case 'd':
                _target_desig = param;
                break;
+            case 'D':
+               server_socket = param;
+               break;
+            case 'F':         /* stream;  default window 2.4 hours */
+               stream_window = atof( param);
+               if( stream_window <= 0.)
+                  stream_window = 144.;
+               stream_window /= minutes_per_day;
+               break;
             case 'i':
                intl_desig = param;
                break;
+            case 'j':
+               n_threads = atoi( param);
+#ifdef USE_PTHREADS
+               if( n_threads <= 0)        /* -j0 = one per CPU */
+                  n_threads = (int)sysconf( _SC_NPROCESSORS_ONLN);
+#endif
+               if( n_threads < 1)
+                  n_threads = 1;
+               if( n_threads > MAX_THREADS)
+                  n_threads = MAX_THREADS;
+               break;
             case 'l':
                lookahead_warning_days = atof( param);
                break;
@@ -1638,6 +3260,38 @@ int main( const int argc, const char **argv)
       }
 #endif
 
+#if !defined( _WIN32) && !defined( __WATCOMC__)
+   if( server_socket)
+      return( run_server( server_socket, tle_file_name));
+#endif
+   if( stream_window && ifilename)
+      {
+      stream_t stream;
+
+      memset( &stream, 0, sizeof( stream_t));
+      stream.tle_file_name = tle_file_name;
+      stream.search_radius = search_radius;
+      stream.max_revs_per_day = max_revs_per_day;
+      stream.speed_cutoff = speed_cutoff;
+      stream.window = stream_window;
+      ifile = (strcmp( ifilename, "-") ? fopen( ifilename, "rb") : stdin);
+      if( !ifile)
+         {
+         fprintf( stderr, "Couldn't open input file %s\n", ifilename);
+         perror( NULL);
+         return( -1);
+         }
+      rval = run_stream( &stream, ifile, t_low, t_high);
+      if( ifile != stdin)
+         fclose( ifile);
+      get_station_code_data( NULL, NULL);
+      return( rval);
+      }
+#if !defined( _WIN32) && !defined( __WATCOMC__)
+   if( client_socket && ifilename && !output_astrometry_filename
+               && !run_client( client_socket, argc, argv, ifilename))
+      return( 0);
+#endif
    assert( ifilename);
    ifile = fopen( ifilename, "rb");
    if( !ifile)
@@ -1685,8 +3339,19 @@ int main( const int argc, const char **argv)
       printf( "%u objects after removing slow ones\n", (unsigned)n_objects);
    else
       max_revs_per_day = 20.;   /* for field-finding,  list everything */
-   rval = add_tle_to_obs( objects, n_objects, tle_file_name, search_radius,
+   jd_min = jd_max = obs[0].jd;
+   for( i = 1; (size_t)i < n_obs; i++)
+      if( jd_min > obs[i].jd)
+         jd_min = obs[i].jd;
+      else if( jd_max < obs[i].jd)
+         jd_max = obs[i].jd;
+   lunar_solar = lunar_solar_init( jd_min - 1., jd_max + 1.);
+   open_tle_tree( tle_file_name);
+   rval = identify_objects( objects, n_objects, tle_file_name, search_radius,
                                     max_revs_per_day);
+   close_tle_tree( );
+   lunar_solar_free( lunar_solar);
+   lunar_solar = NULL;
    if( rval)
       fprintf( stderr, "Couldn't open TLE file %s\n", tname);
    else if( show_summary)
@@ -1697,21 +3362,9 @@ int main( const int argc, const char **argv)
       for( i = 0; (size_t)i < n_objects; i++)
          if( objects[i].n_matches)        /* first show those that were IDed */
             {
-            char buff[30];
-
-            printf( "\n%.12s ", objects[i].obs->text);
-            for( j = 0; j < (int)objects[i].n_matches; j++)
-               printf( " %05d %s", objects[i].matches[j].norad_number,
-                            unpack_intl( objects[i].matches[j].intl_desig, buff));
-            if( objects[i].n_matches == 1)
-               {
-               char *tptr = strchr( objects[i].matches[0].text, ':');
-
-               if( tptr)                   /* if only one match,  output */
-                  printf( " %s", tptr + 1);   /* the object name */
-               }
-            if( objects[i].n_matches)
-               n_matched++;
+            printf( "\n");
+            show_object_ids( objects + i);
+            n_matched++;
             }
       for( i = 0; (size_t)i < n_objects; i++)
          if( !objects[i].n_matches)          /* now show those _not_ IDed */
@@ -1816,7 +3469,15 @@ int main( const int argc, const char **argv)
          free( objects[i].matches);
    free( objects);
    get_station_code_data( NULL, NULL);
-   add_tle_to_obs( NULL, 0, NULL, 0., 0.);
    printf( "\n%.1f seconds elapsed\n", (double)clock( ) / (double)CLOCKS_PER_SEC);
    return( rval);
-}     /* End of main() */
+}     /* End of run_sat_id() */
+
+#ifdef ON_LINE_VERSION
+int sat_id_main( const int argc, const char **argv)
+#else
+int main( const int argc, const char **argv)
+#endif
+{
+   return( run_sat_id( argc, argv));
+}
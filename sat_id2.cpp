@@ -21,29 +21,40 @@
 
 int sat_id_main( const int argc, const char **argv);
 
-int main( const int unused_argc, const char **unused_argv)
+int main( const int cmd_argc, const char **cmd_argv)
 {
    const char *argv[20];
    const size_t max_buff_size = 400000;       /* room for 5000 obs */
    char *buff = (char *)malloc( max_buff_size), *tptr;
-   char field[30];
+   char field[30], verbosity_arg[20];
    const char *temp_obs_filename = "sat_obs.txt";
    double search_radius = 4.;     /* look 4 degrees for matches */
    double motion_cutoff = 60.;  /* up to 60" discrepancy OK */
    double low_speed_cutoff = 0.001;  /* anything slower than this is almost */
    int argc = 0;                     /* certainly not an artsat */
-   FILE *lock_file = fopen( "lock.txt", "w");
+   FILE *lock_file;
    size_t bytes_written = 0, i;
    int cgi_status, show_summary = 0;
    extern int verbose;
 #ifndef _WIN32
    extern char **environ;
 
+         /* Run from a shell (not by the web server) as 'sat_id2 -D(socket)
+         -t(TLE list)',  this is the server that requests are sent to with
+         -C below,  giving the same HTML-ready output.  See 'sat_id.txt'. */
+   if( !getenv( "REQUEST_METHOD") && cmd_argc > 1
+                  && !memcmp( cmd_argv[1], "-D", 2))
+      {
+      free( buff);
+      return( sat_id_main( cmd_argc, cmd_argv));
+      }
    avoid_runaway_process( 15);
+#else
+   INTENTIONALLY_UNUSED_PARAMETER( cmd_argc);
+   INTENTIONALLY_UNUSED_PARAMETER( cmd_argv);
 #endif         /* _WIN32 */
+   lock_file = fopen( "lock.txt", "w");
    setbuf( lock_file, NULL);
-   INTENTIONALLY_UNUSED_PARAMETER( unused_argc);
-   INTENTIONALLY_UNUSED_PARAMETER( unused_argv);
    printf( "Content-type: text/html\n\n");
    printf( "<html> <body> <pre>\n");
    if( !lock_file)
@@ -109,6 +120,7 @@ int main( const int unused_argc, const char **unused_argv)
    argv[argc++] = "sat_id";
    argv[argc++] = temp_obs_filename;
    argv[argc++] = "-t../../tles/tle_list.txt";
+   argv[argc++] = "-C../../tles/sat_id.sock";     /* if the server is running */
    snprintf_err( field, sizeof( field), "-r%.2f", search_radius);
    argv[argc++] = field;
    snprintf_err( buff, max_buff_size, "-y%f", motion_cutoff);
@@ -118,6 +130,11 @@ int main( const int unused_argc, const char **unused_argv)
    argv[argc++] = tptr;
    if( show_summary)
       argv[argc++] = "-u";
+   if( verbose)         /* the server needs to be told,  too */
+      {
+      snprintf_err( verbosity_arg, sizeof( verbosity_arg), "-v%d", verbose - 1);
+      argv[argc++] = verbosity_arg;
+      }
    argv[argc] = NULL;
    for( i = 0; argv[i]; i++)
       fprintf( lock_file, "arg %d: '%s'\n", (int)i, argv[i]);
@@ -29,27 +29,35 @@ to figure out which artsats are in that field.  */
 
 int sat_id_main( const int argc, const char **argv);
 
-int main( const int unused_argc, const char **unused_argv)
+int main( const int cmd_argc, const char **cmd_argv)
 {
    const char *argv[20];
    char buff[80];
    char field[30];
    char search_radius[10], date[50], latitude[30], longitude[30];
    char altitude[10], ra[20], dec[20];
-   const int argc = 3;
+   const int argc = 4;
    const char *output_file_name = "field.txt";
    FILE *ofile;
-   FILE *lock_file = fopen( "lock.txt", "w");
+   FILE *lock_file;
    size_t i;
    int cgi_status;
 #ifndef _WIN32
    extern char **environ;
 
+         /* Run from a shell (not by the web server) as 'sat_id3 -D(socket)
+         -t(TLE list)',  this is the server that requests are sent to with
+         -C below,  giving the same HTML-ready output.  See 'sat_id.txt'. */
+   if( !getenv( "REQUEST_METHOD") && cmd_argc > 1
+                  && !memcmp( cmd_argv[1], "-D", 2))
+      return( sat_id_main( cmd_argc, cmd_argv));
    avoid_runaway_process( 15);
+#else
+   INTENTIONALLY_UNUSED_PARAMETER( cmd_argc);
+   INTENTIONALLY_UNUSED_PARAMETER( cmd_argv);
 #endif         /* _WIN32 */
+   lock_file = fopen( "lock.txt", "w");
    setbuf( lock_file, NULL);
-   INTENTIONALLY_UNUSED_PARAMETER( unused_argc);
-   INTENTIONALLY_UNUSED_PARAMETER( unused_argv);
    printf( "Content-type: text/html\n\n");
    printf( "<html> <body> <pre>\n");
    if( !lock_file)
@@ -104,7 +112,8 @@ int main( const int unused_argc, const char **unused_argv)
    argv[0] = "sat_id";
    argv[1] = output_file_name;
    argv[2] = "-t../../tles/tle_list.txt";
-   argv[3] = NULL;
+   argv[3] = "-C../../tles/sat_id.sock";     /* if the server is running */
+   argv[4] = NULL;
    for( i = 0; argv[i]; i++)
       fprintf( lock_file, "arg %d: '%s'\n", (int)i, argv[i]);
    sat_id_main( argc, argv);
@@ -32,7 +32,7 @@ the following model,  which tries to balance accuracy and speed.  Just as
 you shouldn't try to "improve" SGP4/SDP4,  you shouldn't try to "improve"
 the following;  it'll only break backward compatibility.  */
 
-static void raw_lunar_solar_position( const double jd, double *lunar_xyzr, double *solar_xyzr)
+void raw_lunar_solar_position( const double jd, double *lunar_xyzr, double *solar_xyzr)
 {
    const double j2000 = 2451545;    /* 1.5 Jan 2000 = JD 2451545 */
    const double t_cen = (jd - j2000) / 36525.;
@@ -89,27 +89,34 @@ static void raw_lunar_solar_position( const double jd, double *lunar_xyzr, doubl
    *solar_xyzr++ = solar_r;
 }
 
-/* For the RK4 integration,  we're frequently asking for the sun and
-moon positions at the exact same time we needed for the preceding step.
-Caching those positions saves recomputing them. */
+/* lunar_solar_position( ) used to cache the last position computed,  in
+static variables.  That wasn't thread-safe,  and was of little use except
+within high_ephemeris( ),  which now keeps its own cache (below).  If you
+need many positions,  see lunar_solar_init( ) in 'lun_sol.cpp'.  */
 
 void DLL_FUNC lunar_solar_position( const double jd,
                     double *lunar_xyzr, double *solar_xyzr)
 {
-   static double curr_jd = 0., lunar[4], solar[4];
-   size_t i;
+   lunar_solar_eval( NULL, jd, lunar_xyzr, solar_xyzr);
+}
 
-   if( curr_jd != jd)
-      {
-      curr_jd = jd;
-      raw_lunar_solar_position( jd, lunar, solar);
-      }
-   for( i = 0; i < 4; i++)
+/* For the RK4 integration,  we're frequently asking for the sun and
+moon positions at the exact same time we needed for the preceding step.
+Caching those positions saves recomputing them.  The cache lives on the
+stack of high_ephemeris( ),  so this is thread-safe.  */
+
+typedef struct
+{
+   double jd, lunar[4], solar[4];
+} lunar_solar_cache_t;
+
+static void cached_lunar_solar_position( lunar_solar_cache_t *cache,
+                    const double jd)
+{
+   if( cache->jd != jd)
       {
-      if( lunar_xyzr)
-         lunar_xyzr[i] = lunar[i];
-      if( solar_xyzr)
-         solar_xyzr[i] = solar[i];
+      cache->jd = jd;
+      raw_lunar_solar_position( jd, cache->lunar, cache->solar);
       }
 }
 
@@ -149,17 +156,19 @@ static void init_high_ephemeris( double *params, const tle_t *tle)
 #define c4           params[3]
 #define xnodcf       params[4]
 #define t2cof        params[5]
-#define deep_arg     ((deep_arg_t *)( params + 10))
 
-void DLL_FUNC SDP4_init( double *params, const tle_t *tle)
+void DLL_FUNC SDP4_init_with_config( double *params, const tle_t *tle,
+                                       const sxpx_config_t *config)
 {
    init_t init;
+   deep_arg_t *deep_arg = (deep_arg_t *)( params + 10);
 
    if( tle->ephemeris_type == 'H')
       {
       init_high_ephemeris( params, tle);
       return;
       }
+   Deep_set_config( deep_arg, config);
    sxpx_common_init( params, tle, &init, deep_arg);
    deep_arg->sing = sin(tle->omegao);
    deep_arg->cosg = cos(tle->omegao);
@@ -168,13 +177,15 @@ void DLL_FUNC SDP4_init( double *params, const tle_t *tle)
    Deep_dpinit( tle, deep_arg);
 #ifdef RETAIN_PERTURBATION_VALUES_AT_EPOCH
    /* initialize lunisolar perturbations: */
-   deep_arg->t = 0.;                            /* added 30 Dec 2003 */
-   deep_arg->solar_lunar_init_flag = 1;
-   Deep_dpper( tle, deep_arg);
-   deep_arg->solar_lunar_init_flag = 0;
+   Deep_init_perturbations_at_epoch( tle, deep_arg);
 #endif
 } /*End of SDP4() initialization */
 
+void DLL_FUNC SDP4_init( double *params, const tle_t *tle)
+{
+   SDP4_init_with_config( params, tle, NULL);
+}
+
 static inline double vector_len( const double *vect)
 {
    double len2 = vect[0] * vect[0] + vect[1] * vect[1] + vect[2] * vect[2];
@@ -184,7 +195,8 @@ static inline double vector_len( const double *vect)
 
 /* Input position is in meters,  accel is in m/sec^2 */
 
-static int calc_accel( const double jd, const double *pos, double *accel)
+static int calc_accel( const double jd, const double *pos, double *accel,
+                                 lunar_solar_cache_t *cache)
 {
    size_t i;
    const double earth_gm = 3.9860044e+14;   /* in m^3/s^2 */
@@ -192,15 +204,14 @@ static int calc_accel( const double jd, const double *pos, double *accel)
    const double lunar_gm = 4.902798e+12;       /* m^3/s^2 */
    double r = vector_len( pos);
    double accel_factor = -earth_gm / (r * r * r);
-   double lunar_xyzr[4], solar_xyzr[4];
    unsigned obj_idx;
 
    for( i = 0; i < 3; i++)
       accel[i] = accel_factor * pos[i];
-   lunar_solar_position( jd, lunar_xyzr, solar_xyzr);
+   cached_lunar_solar_position( cache, jd);
    for( obj_idx = 0; obj_idx < 2; obj_idx++)
       {
-      double *opos = (obj_idx ? lunar_xyzr : solar_xyzr);
+      const double *opos = (obj_idx ? cache->lunar : cache->solar);
       double delta[3], d;
       const double gm = (obj_idx ? lunar_gm : solar_gm);
       double accel_factor2;
@@ -217,12 +228,13 @@ static int calc_accel( const double jd, const double *pos, double *accel)
 }
 
 static int calc_state_vector_deriv( const double jd,
-                       const double state_vect[6], double deriv[6])
+                       const double state_vect[6], double deriv[6],
+                       lunar_solar_cache_t *cache)
 {
    deriv[0] = state_vect[3];
    deriv[1] = state_vect[4];
    deriv[2] = state_vect[5];
-   return( calc_accel( jd, state_vect, deriv + 3));
+   return( calc_accel( jd, state_vect, deriv + 3, cache));
 }
 
 /* NOTE: t_since is in minutes,  posn is in km, vel is in km/minutes.
@@ -243,9 +255,11 @@ static int high_ephemeris( double tsince, const tle_t *tle, const double *params
                seconds_per_minute * minutes_per_day;     /* a.k.a. 86400 */
    size_t i, j;
    double jd = tle->epoch, state_vect[6];
+   lunar_solar_cache_t cache;
 
    for( i = 0; i < 6; i++)
       state_vect[i] = params[i];
+   cache.jd = 0.;
    tsince /= minutes_per_day;       /* input was in minutes;  days are */
    while( tsince)                   /* more convenient hereforth       */
       {
@@ -253,7 +267,7 @@ static int high_ephemeris( double tsince, const tle_t *tle, const double *params
       double max_step = 1.;
       double kvects[4][6];
 
-      calc_state_vector_deriv( jd, state_vect, kvects[0]);
+      calc_state_vector_deriv( jd, state_vect, kvects[0], &cache);
       for( j = 3; j < 6; j++)
          if( max_step > 1e-3 / fabs( kvects[0][j]))
             max_step = 1e-3 / fabs( kvects[0][j]);
@@ -272,7 +286,7 @@ static int high_ephemeris( double tsince, const tle_t *tle, const double *params
          for( i = 0; i < 6; i++)
             tstate[i] = state_vect[i] + step * kvects[j - 1][i];
          calc_state_vector_deriv( jd + (j == 3 ? dt : dt / 2.),
-                        tstate, kvects[j]);
+                        tstate, kvects[j], &cache);
          }
 
       for( i = 0; i < 6; i++)
@@ -297,61 +311,163 @@ static int high_ephemeris( double tsince, const tle_t *tle, const double *params
    return( 0);
 }
 
-int DLL_FUNC SDP4( const double tsince, const tle_t *tle, const double *params,
-                                         double *pos, double *vel)
+/* sdp4_secular_and_periodics( ) does everything in SDP4( ) except for
+the final conversion to position/velocity : afterward,  vars->xnode,
+em,  xinc,  omgadf,  and xll are set,  and 'a' and 'xl' are returned. */
+
+static int sdp4_secular_and_periodics( const double tsince, const tle_t *tle,
+                      const double *params, sxpx_state_t *state,
+                      deep_vars_t *vars, double *a, double *xl)
 {
   double
-      a, tempa, tsince_squared,
-      xl, xnoddf;
+      tempa, tsince_squared,
+      xnoddf;
+  const deep_arg_t *deep_arg = (const deep_arg_t *)( params + 10);
 
-   if( tle->ephemeris_type == 'H')
-      {
-      double unused_vel[3];
-
-      return( high_ephemeris( tsince, tle, params, pos, (vel ? vel : unused_vel)));
-      }
   /* Update for secular gravity and atmospheric drag */
-  deep_arg->omgadf = tle->omegao + deep_arg->omgdot * tsince;
+  vars->omgadf = tle->omegao + deep_arg->omgdot * tsince;
   xnoddf = tle->xnodeo + deep_arg->xnodot * tsince;
   tsince_squared = tsince*tsince;
-  deep_arg->xnode = xnoddf + xnodcf * tsince_squared;
-  deep_arg->xn = deep_arg->xnodp;
+  vars->xnode = xnoddf + xnodcf * tsince_squared;
+  vars->xn = deep_arg->xnodp;
 
   /* Update for deep-space secular effects */
-  deep_arg->xll = tle->xmo + deep_arg->xmdot * tsince;
-  deep_arg->t = tsince;
+  vars->xll = tle->xmo + deep_arg->xmdot * tsince;
+  vars->t = tsince;
 
-  Deep_dpsec( tle, deep_arg);
+  Deep_dpsec( tle, deep_arg, state, vars);
 
   tempa = 1-c1*tsince;
-  if( deep_arg->xn < 0.)
+  if( vars->xn < 0.)
      return( SXPX_ERR_NEGATIVE_XN);
-  a = pow(xke/deep_arg->xn,two_thirds)*tempa*tempa;
-  deep_arg->em -= tle->bstar*c4*tsince;
+  *a = pow(xke/vars->xn,two_thirds)*tempa*tempa;
+  vars->em -= tle->bstar*c4*tsince;
 
   /* Update for deep-space periodic effects */
-  deep_arg->xll += deep_arg->xnodp * t2cof * tsince_squared;
+  vars->xll += deep_arg->xnodp * t2cof * tsince_squared;
 
-  Deep_dpper( tle, deep_arg);
+  Deep_dpper( tle, deep_arg, state, vars);
 
             /* Keeping xinc positive is not really necessary,  unless        */
             /* you're displaying elements and dislike negative inclinations. */
+            /* (The errata also flipped the sign of sinio,  but that's now   */
+            /* recomputed from xinc afterward anyway.)                       */
 #ifdef KEEP_INCLINATION_POSITIVE
-  if (deep_arg->xinc < 0.)       /* Begin April 1983 errata correction: */
+  if (vars->xinc < 0.)       /* Begin April 1983 errata correction: */
      {
-     deep_arg->xinc = -deep_arg->xinc;
-     deep_arg->sinio = -deep_arg->sinio;
-     deep_arg->xnode += pi;
-     deep_arg->omgadf -= pi;
+     vars->xinc = -vars->xinc;
+     vars->xnode += pi;
+     vars->omgadf -= pi;
      }                          /* End April 1983 errata correction. */
 #endif
 
-  xl = deep_arg->xll + deep_arg->omgadf + deep_arg->xnode;
+  *xl = vars->xll + vars->omgadf + vars->xnode;
+  return( 0);
+}
+
+/* SDP4_r( ) is the reentrant version of SDP4( ) :  'params' are only
+read,  and anything carried from one call to the next is in 'state'
+(see norad.h).  For high-flying ('H' type) TLEs,  the state is unused. */
+
+int DLL_FUNC SDP4_r( const double tsince, const tle_t *tle,
+               const double *params, sxpx_state_t *state,
+               double *pos, double *vel)
+{
+   double a, xl, cosio, sinio;
+   deep_vars_t vars;
+   int rval;
+
+   if( tle->ephemeris_type == 'H')
+      {
+      double unused_vel[3];
+
+      return( high_ephemeris( tsince, tle, params, pos, (vel ? vel : unused_vel)));
+      }
+   rval = sdp4_secular_and_periodics( tsince, tle, params, state, &vars,
+                                       &a, &xl);
+   if( rval)
+      return( rval);
                /* Dundee change:  Reset cosio,  sinio for new xinc: */
-  deep_arg->cosio = cos( deep_arg->xinc);
-  deep_arg->sinio = sin( deep_arg->xinc);
+   cosio = cos( vars.xinc);
+   sinio = sin( vars.xinc);
 
-  return( sxpx_posn_vel( deep_arg->xnode, a, deep_arg->em, deep_arg->cosio,
-                deep_arg->sinio, deep_arg->xinc, deep_arg->omgadf,
+   return( sxpx_posn_vel( vars.xnode, a, vars.em, cosio,
+                sinio, vars.xinc, vars.omgadf,
                 xl, pos, vel));
+}
+
+/* SDP4( ) uses the state stored within 'params' itself.  Hence the
+casting away of 'const'... which is why SDP4_r( ) exists.  */
+
+int DLL_FUNC SDP4( const double tsince, const tle_t *tle, const double *params,
+                                         double *pos, double *vel)
+{
+   deep_arg_t *deep_arg = (deep_arg_t *)( params + 10);
+
+   return( SDP4_r( tsince, tle, params, &deep_arg->state, pos, vel));
 } /* SDP4 */
+
+/* SDP4_ephemeris( ) is to SDP4( ) as SGP4_ephemeris( ) is to SGP4( ):  it
+computes positions (and velocities,  if 'vel' is non-NULL) at 'n_times'
+times.  The deep-space secular and periodic terms are still evaluated
+one time at a time,  but the final (and more expensive) conversion to
+position and velocity is vectorized across blocks of times.  As with
+SDP4( ),  results will be slightly better if the times are in order,
+since the resonance integration can then pick up where it left off. */
+
+int DLL_FUNC SDP4_ephemeris( const double *tsince, const int n_times,
+               const tle_t *tle, const double *params, double *pos,
+               double *vel, int *rvals)
+{
+   int i, j, rval = 0;
+   deep_arg_t *deep_arg = (deep_arg_t *)( params + 10);
+
+   for( i = 0; i < n_times; i += SXPX_BLOCK_SIZE)
+      {
+      const int n = (n_times - i < SXPX_BLOCK_SIZE ? n_times - i : SXPX_BLOCK_SIZE);
+      double a[SXPX_BLOCK_SIZE], em[SXPX_BLOCK_SIZE], xinc[SXPX_BLOCK_SIZE];
+      double cosio[SXPX_BLOCK_SIZE], sinio[SXPX_BLOCK_SIZE];
+      double omgadf[SXPX_BLOCK_SIZE], xnode[SXPX_BLOCK_SIZE];
+      double xl[SXPX_BLOCK_SIZE];
+      int block_rvals[SXPX_BLOCK_SIZE], secular_rvals[SXPX_BLOCK_SIZE];
+
+      if( tle->ephemeris_type == 'H')
+         for( j = 0; j < n; j++)
+            block_rvals[j] = SDP4( tsince[i + j], tle, params, pos + (i + j) * 3,
+                           (vel ? vel + (i + j) * 3 : NULL));
+      else
+         {
+         for( j = 0; j < n; j++)
+            {
+            deep_vars_t vars;
+
+            secular_rvals[j] = sdp4_secular_and_periodics( tsince[i + j], tle,
+                                 params, &deep_arg->state, &vars, a + j, xl + j);
+            if( secular_rvals[j])      /* negative 'a' gets the posn/vel */
+               {                       /* zeroed in sxpx_posn_vel_block( ) */
+               a[j] = -1.;
+               xl[j] = 0.;
+               }
+            em[j] = vars.em;
+            xinc[j] = vars.xinc;
+            omgadf[j] = vars.omgadf;
+            xnode[j] = vars.xnode;
+            }
+         for( j = 0; j < n; j++)
+            sxpx_sincos( xinc[j], sinio + j, cosio + j);
+         sxpx_posn_vel_block( n, xnode, a, em, cosio, sinio, xinc, omgadf, xl,
+                 pos + i * 3, (vel ? vel + i * 3 : NULL), block_rvals);
+         for( j = 0; j < n; j++)
+            if( secular_rvals[j])
+               block_rvals[j] = secular_rvals[j];
+         }
+      for( j = 0; j < n; j++)
+         {
+         if( block_rvals[j])
+            rval++;
+         if( rvals)
+            rvals[i + j] = block_rvals[j];
+         }
+      }
+   return( rval);
+}
@@ -1,5 +1,6 @@
 /* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
 
+#include <stddef.h>
 #include <math.h>
 #include "norad.h"
 #include "norad_in.h"
@@ -18,7 +19,8 @@
 void sxpall_common_init( const tle_t *tle, deep_arg_t *deep_arg);
 void sxp8_common_init( double *params, const tle_t *tle, deep_arg_t *deep_arg);
 
-void DLL_FUNC SDP8_init( double *params, const tle_t *tle)
+void DLL_FUNC SDP8_init_with_config( double *params, const tle_t *tle,
+                                       const sxpx_config_t *config)
 {
    const double rho = .15696615;
    const double b = tle->bstar*2./rho;
@@ -29,6 +31,7 @@ void DLL_FUNC SDP8_init( double *params, const tle_t *tle)
          po, psim2, r1, tsi, xndtn;
    deep_arg_t *deep_arg = ((deep_arg_t *)( params + 10));
 
+   Deep_set_config( deep_arg, config);
    sxpall_common_init( tle, deep_arg);
    sxp8_common_init( params, tle, deep_arg);
    deep_arg->sinio = sin( tle->xincl);
@@ -66,15 +69,20 @@ void DLL_FUNC SDP8_init( double *params, const tle_t *tle)
    Deep_dpinit( tle, deep_arg);
 #ifdef RETAIN_PERTURBATION_VALUES_AT_EPOCH
    /* initialize lunisolar perturbations: */
-   deep_arg->t = 0.;                            /* added 30 Dec 2003 */
-   deep_arg->solar_lunar_init_flag = 1;
-   Deep_dpper( tle, deep_arg);
-   deep_arg->solar_lunar_init_flag = 0;
+   Deep_init_perturbations_at_epoch( tle, deep_arg);
 #endif
 } /* End of SDP8() initialization */
 
-int DLL_FUNC SDP8( const double tsince, const tle_t *tle, const double *params,
-                                double *pos, double *vel)
+void DLL_FUNC SDP8_init( double *params, const tle_t *tle)
+{
+   SDP8_init_with_config( params, tle, NULL);
+}
+
+/* SDP8_r( ) is the reentrant version of SDP8( ) :  see norad.h. */
+
+int DLL_FUNC SDP8_r( const double tsince, const tle_t *tle,
+               const double *params, sxpx_state_t *state,
+               double *pos, double *vel)
 {
    double
         am, aovr, axnm, aynm, beta, beta2m,
@@ -85,33 +93,34 @@ int DLL_FUNC SDP8( const double tsince, const tle_t *tle, const double *params,
         snlamb, temp, ux, uy, uz, vx, vy, vz, xlamb,
         xmam, xmamdf, y4, y5, z1, z7, zc2, zc5;
   int i;
-  deep_arg_t *deep_arg = ((deep_arg_t *)( params + 10));
+  const deep_arg_t *deep_arg = ((const deep_arg_t *)( params + 10));
+  deep_vars_t vars;
 
   /* Update for secular gravity and atmospheric drag */
   z1 = xndt*.5*tsince*tsince;
   z7 = two_thirds*3.5*z1/deep_arg->xnodp;
   xmamdf = tle->xmo+deep_arg->xmdot*tsince;
-  deep_arg->omgadf = tle->omegao+deep_arg->omgdot*tsince+z7*xgdt1;
-  deep_arg->xnode = tle->xnodeo+deep_arg->xnodot*tsince+z7*xhdt1;
-  deep_arg->xn = deep_arg->xnodp;
+  vars.omgadf = tle->omegao+deep_arg->omgdot*tsince+z7*xgdt1;
+  vars.xnode = tle->xnodeo+deep_arg->xnodot*tsince+z7*xhdt1;
+  vars.xn = deep_arg->xnodp;
 
   /* Update for deep-space secular effects */
-  deep_arg->xll = xmamdf;
-  deep_arg->t = tsince;
-  Deep_dpsec( tle, deep_arg);
-  xmamdf = deep_arg->xll;
-  deep_arg->xn += xndt*tsince;
-  deep_arg->em += edot*tsince;
+  vars.xll = xmamdf;
+  vars.t = tsince;
+  Deep_dpsec( tle, deep_arg, state, &vars);
+  xmamdf = vars.xll;
+  vars.xn += xndt*tsince;
+  vars.em += edot*tsince;
   xmam = xmamdf+z1+z7*xmdt1;
 
   /* Update for deep-space periodic effects */
-  deep_arg->xll = xmam;
-  Deep_dpper( tle, deep_arg);
-  xmam = deep_arg->xll;
+  vars.xll = xmam;
+  Deep_dpper( tle, deep_arg, state, &vars);
+  xmam = vars.xll;
   xmam = FMod2p(xmam);
 
   /* Solve Kepler's equation */
-  zc2 = xmam+deep_arg->em*sin(xmam)*(deep_arg->em*cos(xmam)+1.);
+  zc2 = xmam+vars.em*sin(xmam)*(vars.em*cos(xmam)+1.);
 
   i = 0;
   do
@@ -120,8 +129,8 @@ int DLL_FUNC SDP8( const double tsince, const tle_t *tle, const double *params,
 
       sine = sin(zc2);
       cose = cos(zc2);
-      zc5 = 1./(1.-deep_arg->em*cose);
-      cape = (xmam+deep_arg->em*sine-zc2)*zc5+zc2;
+      zc5 = 1./(1.-vars.em*cose);
+      cape = (xmam+vars.em*sine-zc2)*zc5+zc2;
       r1 = cape-zc2;
       if (fabs(r1) <= e6a) break;
       zc2 = cape;
@@ -129,12 +138,12 @@ int DLL_FUNC SDP8( const double tsince, const tle_t *tle, const double *params,
   while(i++ < 10);
 
   /* Short period preliminary quantities */
-  am = pow( xke / deep_arg->xn, two_thirds);
-  beta2m = 1.f-deep_arg->em*deep_arg->em;
-  sinos = sin(deep_arg->omgadf);
-  cosos = cos(deep_arg->omgadf);
-  axnm = deep_arg->em*cosos;
-  aynm = deep_arg->em*sinos;
+  am = pow( xke / vars.xn, two_thirds);
+  beta2m = 1.f-vars.em*vars.em;
+  sinos = sin(vars.omgadf);
+  cosos = cos(vars.omgadf);
+  axnm = vars.em*cosos;
+  aynm = vars.em*sinos;
   pm = am*beta2m;
   g1 = 1./pm;
   g2 = ck2*.5*g1;
@@ -143,7 +152,7 @@ int DLL_FUNC SDP8( const double tsince, const tle_t *tle, const double *params,
   g4 = a3ovk2*.25*deep_arg->sinio;
   g5 = a3ovk2*.25*g1;
   snf = beta*sine*zc5;
-  csf = (cose-deep_arg->em)*zc5;
+  csf = (cose-vars.em)*zc5;
   fm = atan2(snf, csf);
   if( fm < 0.)
      fm += pi + pi;
@@ -152,31 +161,31 @@ int DLL_FUNC SDP8( const double tsince, const tle_t *tle, const double *params,
   sn2f2g = snfg*2.*csfg;
   r1 = csfg;
   cs2f2g = r1*r1*2.-1.;
-  ecosf = deep_arg->em*csf;
-  g10 = fm-xmam+deep_arg->em*snf;
+  ecosf = vars.em*csf;
+  g10 = fm-xmam+vars.em*snf;
   rm = pm/(ecosf+1.);
   aovr = am/rm;
-  g13 = deep_arg->xn*aovr;
+  g13 = vars.xn*aovr;
   g14 = -g13*aovr;
   dr = g2*(unmth2*cs2f2g-tthmun*3.)-g4*snfg;
   diwc = g3*3.*deep_arg->sinio*cs2f2g-g5*aynm;
   di = diwc*deep_arg->cosio;
-  sinio2 = sin(deep_arg->xinc*.5);
+  sinio2 = sin(vars.xinc*.5);
 
   /* Update for short period periodics */
   sni2du = sini2*(g3*((1.-deep_arg->cosio2*7.)*.5*sn2f2g-unm5th*
       3.*g10)-g5*deep_arg->sinio*csfg*(ecosf+2.))-g5*.5*
            deep_arg->cosio2*axnm/cosi2;
-  xlamb = fm+deep_arg->omgadf+deep_arg->xnode+g3*((deep_arg->cosio*6.+
+  xlamb = fm+vars.omgadf+vars.xnode+g3*((deep_arg->cosio*6.+
      1.-deep_arg->cosio2*7.)*.5*sn2f2g-(unm5th+deep_arg->cosio*2.)*
      3.*g10)+g5*deep_arg->sinio*(deep_arg->cosio*axnm/
      (deep_arg->cosio+1.)-(ecosf+2.)*csfg);
   y4 = sinio2*snfg+csfg*sni2du+snfg*.5*cosi2*di;
   y5 = sinio2*csfg-snfg*sni2du+csfg*.5*cosi2*di;
   rr = rm+dr;
-  rdot = deep_arg->xn*am*deep_arg->em*snf/beta+g14*(g2*2.*unmth2*sn2f2g+g4*csfg);
+  rdot = vars.xn*am*vars.em*snf/beta+g14*(g2*2.*unmth2*sn2f2g+g4*csfg);
   r1 = am;
-  rvdot = deep_arg->xn*(r1*r1)*beta/rm+g14*dr+am*g13*deep_arg->sinio*diwc;
+  rvdot = vars.xn*(r1*r1)*beta/rm+g14*dr+am*g13*deep_arg->sinio*diwc;
 
   /* Orientation vectors */
   snlamb = sin(xlamb);
@@ -202,4 +211,14 @@ int DLL_FUNC SDP8( const double tsince, const tle_t *tle, const double *params,
      vel[2] = (rdot*uz+rvdot*vz)*earth_radius_in_km;
      }
    return( 0);
+} /* SDP8_r */
+
+/* SDP8( ) uses (and modifies) the state stored within 'params'. */
+
+int DLL_FUNC SDP8( const double tsince, const tle_t *tle, const double *params,
+                                double *pos, double *vel)
+{
+   deep_arg_t *deep_arg = (deep_arg_t *)( params + 10);
+
+   return( SDP8_r( tsince, tle, params, &deep_arg->state, pos, vel));
 } /* SDP8 */
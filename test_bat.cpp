@@ -0,0 +1,951 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/*
+ *  test_bat.cpp
+ *
+ *  Checks SGP4_batch( ) against the scalar SGP4( ) code,  and times
+ *  both.  Then does the same for SGP4_ephemeris( ) and SDP4_ephemeris( )
+ *  (one satellite,  many times) against SGP4( ) and SDP4( ).  It reads
+ *  TLEs from 'test.tle' (or the file given on the command line),
+ *  replicates them until there are 'n' satellites
+ *  (default 30000;  set with,  e.g.,  -n100000),  and propagates each
+ *  to its own time,  scattered over +/- ten days from epoch.  The
+ *  largest position/velocity differences and any mismatched return
+ *  codes are shown,  and SGP4( ) is timed with and without velocities
+ *  (the positions must match exactly).  It also compares the batch results for the SGP4
+ *  test case in Spacetrack Report #3 to the values given there,  and
+ *  checks that the reentrant SDP4_r( ) and SDP8_r( ) match SDP4( ) and
+ *  SDP8( ) exactly without modifying their 'params',  and that settings
+ *  given with SDP4_init_with_config( ) are independent of the
+ *  process-wide ones.  Finally,  it checks and times the precomputed
+ *  lunar/solar positions from lunar_solar_eval( ),  and that resonance
+ *  integrator checkpoints don't change Dundee-compliant results,  and
+ *  times the scalar and 'block' Kepler solvers,  and checks that
+ *  parse_elements_in_buffer( ) matches parse_elements( ),  that
+ *  precomputed catalogs give the same TLEs and positions as parsing and
+ *  initializing,  and that write_tles_in_tle_format( ) output matches
+ *  write_elements_in_tle_format( ) and reads back with parse_elements( ),
+ *  and that tle_index_find( ) finds the same TLEs as a linear search.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "norad.h"
+#include "norad_in.h"
+
+      /* From Spacetrack Report #3,  as used in 'test_sat.cpp' */
+static const double sgp4_test_data[5 * 6] = {
+           2328.97048951,  -5995.22076416,   1719.97067261,
+                       2.91207230,     -0.98341546,      -7.09081703,
+           2456.10705566,  -6071.93853760,   1222.89727783,
+                       2.67938992,     -0.44829041,      -7.22879231,
+           2567.56195068,  -6112.50384522,    713.96397400,
+                       2.44024599,      0.09810869,      -7.31995916,
+           2663.09078980,  -6115.48229980,    196.39640427,
+                       2.19611958,      0.65241995,      -7.36282432,
+           2742.55133057,  -6079.67144775,   -326.38095856,
+                       1.94850229,      1.21106251,      -7.35619372 };
+
+static int spacetrack_test( void)
+{
+   const char *line1 =
+      "1 88888U          80275.98708465  .00073094  13844-3  66816-4 0    87";
+   const char *line2 =
+      "2 88888  72.8435 115.9689 0086731  52.6988 110.5714 16.05824518  1058";
+   tle_t tle[5];
+   double params[5 * N_SGP4_BATCH_PARAMS], tsince[5], pos[15], vel[15];
+   double max_dpos = 0., max_dvel = 0.;
+   int i, j;
+
+   for( i = 0; i < 5; i++)
+      {
+      parse_elements( line1, line2, tle + i);
+      tsince[i] = (double)i * 360.;
+      }
+   SGP4_batch_init( params, tle, 5);
+   SGP4_batch( tsince, params, 5, pos, vel, NULL);
+   for( i = 0; i < 5; i++)
+      for( j = 0; j < 3; j++)
+         {
+         const double dpos = fabs( pos[i * 3 + j] - sgp4_test_data[i * 6 + j]);
+         const double dvel = fabs( vel[i * 3 + j] / 60.
+                                 - sgp4_test_data[i * 6 + j + 3]);
+
+         if( max_dpos < dpos)
+            max_dpos = dpos;
+         if( max_dvel < dvel)
+            max_dvel = dvel;
+         }
+   printf( "Spacetrack Report #3 SGP4 case:  max diffs %.3e km, %.3e km/s\n",
+                  max_dpos, max_dvel);
+            /* SGP4( ) itself differs from the report by up to 9.2 meters */
+            /* and 1.02 cm/s,  mostly because the report used floats.     */
+   return( max_dpos > .02 || max_dvel > 2e-5);
+}
+
+/* For each TLE,  compute an ephemeris of 'n_steps' times over +/- ten
+days,  using both the 'ephemeris' function and repeated calls to the
+scalar one,  and return the largest difference in position.   */
+
+static double ephemeris_test( const tle_t *tles, const int n_tles,
+                     const int n_steps, int *n_rval_mismatches)
+{
+   double *tsince = (double *)malloc( n_steps * 13 * sizeof( double));
+   double *pos = tsince + n_steps, *vel = pos + 3 * n_steps;
+   double *pos2 = vel + 3 * n_steps, *vel2 = pos2 + 3 * n_steps;
+   double max_dpos = 0., max_dvel = 0.;
+   double time_scalar[2], time_vector[2];
+   int *rvals = (int *)malloc( n_steps * sizeof( int));
+   int i, j, model;
+
+   for( i = 0; i < n_steps; i++)
+      tsince[i] = -14400. + 28800. * (double)i / (double)n_steps;
+   for( model = 0; model < 2; model++)
+      time_scalar[model] = time_vector[model] = 0.;
+   for( i = 0; i < n_tles; i++)
+      for( model = 0; model < 2; model++)
+         {
+         double params[N_SAT_PARAMS];
+         clock_t t0 = clock( );
+
+         if( model)
+            {
+            SDP4_init( params, tles + i);
+            for( j = 0; j < n_steps; j++)
+               SDP4( tsince[j], tles + i, params, pos + j * 3, vel + j * 3);
+            }
+         else
+            {
+            SGP4_init( params, tles + i);
+            for( j = 0; j < n_steps; j++)
+               SGP4( tsince[j], tles + i, params, pos + j * 3, vel + j * 3);
+            }
+         time_scalar[model] += (double)( clock( ) - t0);
+         t0 = clock( );
+         if( model)
+            {
+            SDP4_init( params, tles + i);
+            SDP4_ephemeris( tsince, n_steps, tles + i, params, pos2, vel2, rvals);
+            }
+         else
+            {
+            SGP4_init( params, tles + i);
+            SGP4_ephemeris( tsince, n_steps, tles + i, params, pos2, vel2, rvals);
+            }
+         time_vector[model] += (double)( clock( ) - t0);
+         if( model)
+            SDP4_init( params, tles + i);
+         for( j = 0; j < n_steps; j++)
+            {
+            const int rval = (model ?
+                     SDP4( tsince[j], tles + i, params, pos + j * 3, vel + j * 3) :
+                     SGP4( tsince[j], tles + i, params, pos + j * 3, vel + j * 3));
+            int k;
+
+            if( rval != rvals[j])
+               (*n_rval_mismatches)++;
+            else if( rval != SXPX_ERR_CONVERGENCE_FAIL)
+               for( k = j * 3; k < j * 3 + 3; k++)
+                  {
+                  const double dpos = fabs( pos[k] - pos2[k]);
+                  const double dvel = fabs( vel[k] - vel2[k]);
+
+                  if( max_dpos < dpos)
+                     max_dpos = dpos;
+                  if( max_dvel < dvel)
+                     max_dvel = dvel;
+                  }
+            }
+         }
+   for( model = 0; model < 2; model++)
+      printf( "%s : %.1f ns/step;  %s_ephemeris : %.1f ns/step\n",
+               (model ? "SDP4" : "SGP4"),
+               time_scalar[model] * 1e+9 / (double)CLOCKS_PER_SEC
+                           / (double)( n_tles * n_steps),
+               (model ? "SDP4" : "SGP4"),
+               time_vector[model] * 1e+9 / (double)CLOCKS_PER_SEC
+                           / (double)( n_tles * n_steps));
+   printf( "Ephemeris vs. scalar: max diffs %.3e km, %.3e km/min\n",
+                  max_dpos, max_dvel);
+   free( tsince);
+   free( rvals);
+   return( max_dpos > 1e-6 || max_dvel > 1e-6 ? max_dpos + 1. : max_dpos);
+}
+
+/* Run SDP4( ) and SDP4_r( ) (and SDP8( ) and SDP8_r( ) ) through the same
+scrambled sequence of times,  which exercises both the resonance integrator
+and the lunisolar perturbation cache.  Results should match to the last
+bit,  and the params given to the '_r' functions shouldn't change.
+Returns the number of failures. */
+
+static int reentrant_test( const tle_t *tles, const int n_tles)
+{
+   int i, j, model, n_failures = 0;
+
+   for( i = 0; i < n_tles; i++)
+      if( select_ephemeris( tles + i) == 1)
+         for( model = 0; model < 2; model++)
+            {
+            double params[N_SAT_PARAMS], params_r[N_SAT_PARAMS];
+            double params_copy[N_SAT_PARAMS];
+            sxpx_state_t state;
+
+            if( model)
+               {
+               SDP8_init( params, tles + i);
+               SDP8_init( params_r, tles + i);
+               }
+            else
+               {
+               SDP4_init( params, tles + i);
+               SDP4_init( params_r, tles + i);
+               }
+            sxpx_init_state( &state, params_r);
+            memcpy( params_copy, params_r, sizeof( params_copy));
+            for( j = 0; j < 200; j++)
+               {
+               const double tsince = (double)((j * 7919) % 28801 - 14400);
+               double pos[3], vel[3], pos_r[3], vel_r[3];
+
+               if( model)
+                  {
+                  SDP8( tsince, tles + i, params, pos, vel);
+                  SDP8_r( tsince, tles + i, params_r, &state, pos_r, vel_r);
+                  }
+               else
+                  {
+                  SDP4( tsince, tles + i, params, pos, vel);
+                  SDP4_r( tsince, tles + i, params_r, &state, pos_r, vel_r);
+                  }
+               if( memcmp( pos, pos_r, sizeof( pos))
+                              || memcmp( vel, vel_r, sizeof( vel)))
+                  {
+                  printf( "SDP%d_r mismatch:  NORAD %d, t=%f\n", (model ? 8 : 4),
+                               tles[i].norad_number, tsince);
+                  n_failures++;
+                  break;
+                  }
+               }
+            if( memcmp( params_copy, params_r, sizeof( params_copy)))
+               {
+               printf( "SDP%d_r modified params:  NORAD %d\n", (model ? 8 : 4),
+                               tles[i].norad_number);
+               n_failures++;
+               }
+            }
+   printf( "Reentrant SDP4_r/SDP8_r : %d failures\n", n_failures);
+   return( n_failures);
+}
+
+/* Initialize each deep-space TLE with the default settings,  and again
+with an explicit Dundee-compliant config.  Then turn on Dundee compliance
+process-wide,  initialize a third copy,  and propagate all three.  The
+first should match a non-Dundee reference,  unaffected by the change to
+the process-wide settings made after it was initialized;  the last two
+should agree exactly.  Returns the number of failures. */
+
+static int config_test( const tle_t *tles, const int n_tles)
+{
+   const int n_steps = 50;
+   sxpx_config_t config;
+   int i, j, pass, n_failures = 0, n_differences = 0;
+
+   sxpx_get_default_config( &config);
+   config.is_dundee_compliant = 1;
+   for( i = 0; i < n_tles; i++)
+      if( select_ephemeris( tles + i) == 1 && tles[i].ephemeris_type != 'H')
+         {
+         double params[4][N_SAT_PARAMS], pos[4][3];
+
+         SDP4_init( params[0], tles + i);
+         SDP4_init_with_config( params[1], tles + i, &config);
+         sxpx_set_implementation_param( SXPX_DUNDEE_COMPLIANCE, 1);
+         SDP4_init( params[2], tles + i);
+         sxpx_set_implementation_param( SXPX_DUNDEE_COMPLIANCE, 0);
+         SDP4_init( params[3], tles + i);
+         for( j = 0; j < n_steps; j++)
+            {
+            const double tsince = (double)( j * 8731 % 28801 - 14400);
+
+            if( j == n_steps / 2)
+               sxpx_set_implementation_param( SXPX_DUNDEE_COMPLIANCE, 1);
+            for( pass = 0; pass < 4; pass++)
+               SDP4( tsince, tles + i, params[pass], pos[pass], NULL);
+            if( memcmp( pos[0], pos[3], sizeof( pos[0]))
+                      || memcmp( pos[1], pos[2], sizeof( pos[0])))
+               {
+               printf( "Config mismatch:  NORAD %d, step %d\n",
+                                 tles[i].norad_number, j);
+               n_failures++;
+               break;
+               }
+            if( memcmp( pos[0], pos[1], sizeof( pos[0])))
+               n_differences++;
+            }
+         sxpx_set_implementation_param( SXPX_DUNDEE_COMPLIANCE, 0);
+         }
+   printf( "SDP4_init_with_config : %d failures;  Dundee differed %d times\n",
+                  n_failures, n_differences);
+   return( n_failures || !n_differences);
+}
+
+/* For each resonant deep-space TLE,  propagate with Dundee-compliant
+settings to times scattered over +/- 40 days,  with and without a
+checkpoint table covering +/- 30 days (so some times are beyond the
+table).  Results should match to the last bit.  Times both.  Returns the
+number of failures. */
+
+static int checkpoint_test( const tle_t *tles, const int n_tles)
+{
+   const int n_steps = 1000;
+   sxpx_config_t config;
+   int i, j, model, n_failures = 0, n_resonant = 0;
+   clock_t t_plain = 0, t_checkpointed = 0;
+
+   sxpx_get_default_config( &config);
+   config.is_dundee_compliant = 1;
+   for( i = 0; i < n_tles; i++)
+      if( select_ephemeris( tles + i) == 1 && tles[i].ephemeris_type != 'H')
+         for( model = 0; model < 2; model++)
+            {
+            double params[N_SAT_PARAMS], params_c[N_SAT_PARAMS];
+            double *pos, *vel;
+            clock_t t0;
+
+            if( model)
+               {
+               SDP8_init_with_config( params, tles + i, &config);
+               SDP8_init_with_config( params_c, tles + i, &config);
+               }
+            else
+               {
+               SDP4_init_with_config( params, tles + i, &config);
+               SDP4_init_with_config( params_c, tles + i, &config);
+               }
+            if( sxpx_init_checkpoints( params_c, -43200., 43200.) < 0)
+               continue;
+            n_resonant++;
+            pos = (double *)malloc( 12 * n_steps * sizeof( double));
+            vel = pos + 3 * n_steps;
+            for( j = 0; j < 2; j++)
+               {
+               double *tparams = (j ? params_c : params);
+               double *tpos = pos + 6 * j * n_steps;
+               double *tvel = vel + 6 * j * n_steps;
+               int k;
+
+               t0 = clock( );
+               for( k = 0; k < n_steps; k++)
+                  {
+                  const double tsince = (double)((k * 7919) % 115201 - 57600);
+
+                  if( model)
+                     SDP8( tsince, tles + i, tparams, tpos + 3 * k, tvel + 3 * k);
+                  else
+                     SDP4( tsince, tles + i, tparams, tpos + 3 * k, tvel + 3 * k);
+                  }
+               if( j)
+                  t_checkpointed += clock( ) - t0;
+               else
+                  t_plain += clock( ) - t0;
+               }
+            if( memcmp( pos, pos + 6 * n_steps, 3 * n_steps * sizeof( double))
+                  || memcmp( vel, vel + 6 * n_steps, 3 * n_steps * sizeof( double)))
+               {
+               printf( "Checkpoint mismatch:  SDP%d, NORAD %d\n",
+                           (model ? 8 : 4), tles[i].norad_number);
+               n_failures++;
+               }
+            free( pos);
+            sxpx_free_checkpoints( params_c);
+            }
+   printf( "Checkpoints : %d failures in %d runs;  %.1f us/step plain, %.1f checkpointed\n",
+         n_failures, n_resonant,
+         (double)t_plain * 1e+6 / (double)CLOCKS_PER_SEC / (double)( n_resonant * n_steps + !n_resonant),
+         (double)t_checkpointed * 1e+6 / (double)CLOCKS_PER_SEC / (double)( n_resonant * n_steps + !n_resonant));
+   return( n_failures || !n_resonant);
+}
+
+/* Microbenchmark for the Kepler solver in sxpx_posn_vel( ) (iterate to
+convergence,  element by element) and sxpx_posn_vel_block( ) (a fixed,
+eccentricity-bounded number of steps across SIMD lanes),  for synthetic
+near-circular LEO and high-eccentricity GTO sets.  Returns 1 if the two
+disagree by more than a millimeter or so,  or in their return codes.  */
+
+static int kepler_test( void)
+{
+   const int n_elems = 32 * SXPX_BLOCK_SIZE, n_reps = 100;
+   double *arrays = (double *)malloc( 16 * n_elems * sizeof( double));
+   double *xnode = arrays, *a = xnode + n_elems, *ecc = a + n_elems;
+   double *cosio = ecc + n_elems, *sinio = cosio + n_elems;
+   double *xincl = sinio + n_elems, *omega = xincl + n_elems;
+   double *xl = omega + n_elems, *pos = xl + n_elems, *pos2 = pos + 3 * n_elems;
+   int *rvals = (int *)malloc( 2 * n_elems * sizeof( int));
+   int set, i, j, rval = 0;
+
+   srand( 1);
+   for( set = 0; set < 2; set++)
+      {
+      double max_diff = 0.;
+      int n_mismatches = 0;
+      clock_t t0, t_scalar, t_block;
+
+      for( i = 0; i < n_elems; i++)
+         {
+         xnode[i] = 2. * pi * (double)rand( ) / (double)RAND_MAX;
+         omega[i] = 2. * pi * (double)rand( ) / (double)RAND_MAX;
+         xl[i] = 20. * pi * (double)rand( ) / (double)RAND_MAX;
+         xincl[i] = pi * (double)rand( ) / (double)RAND_MAX;
+         cosio[i] = cos( xincl[i]);
+         sinio[i] = sin( xincl[i]);
+         if( set)       /* GTO:  e = .70 to .75,  a = 3.8 earth radii */
+            {
+            ecc[i] = .70 + .05 * (double)rand( ) / (double)RAND_MAX;
+            a[i] = 3.8;
+            }
+         else           /* LEO:  e = 0 to .02,  a = 1.05 to 1.2 earth radii */
+            {
+            ecc[i] = .02 * (double)rand( ) / (double)RAND_MAX;
+            a[i] = 1.05 + .15 * (double)rand( ) / (double)RAND_MAX;
+            }
+         }
+      t0 = clock( );
+      for( j = 0; j < n_reps; j++)
+         for( i = 0; i < n_elems; i++)
+            rvals[i] = sxpx_posn_vel( xnode[i], a[i], ecc[i], cosio[i], sinio[i],
+                              xincl[i], omega[i], xl[i], pos + i * 3, NULL);
+      t_scalar = clock( ) - t0;
+      t0 = clock( );
+      for( j = 0; j < n_reps; j++)
+         for( i = 0; i < n_elems; i += SXPX_BLOCK_SIZE)
+            sxpx_posn_vel_block( SXPX_BLOCK_SIZE, xnode + i, a + i, ecc + i,
+                        cosio + i, sinio + i, xincl + i, omega + i, xl + i,
+                        pos2 + i * 3, NULL, rvals + n_elems + i);
+      t_block = clock( ) - t0;
+      for( i = 0; i < n_elems; i++)
+         if( rvals[i] != rvals[i + n_elems])
+            n_mismatches++;
+      for( i = 0; i < 3 * n_elems; i++)
+         if( max_diff < fabs( pos[i] - pos2[i]))
+            max_diff = fabs( pos[i] - pos2[i]);
+      printf( "Kepler %s: scalar %.1f ns, block %.1f ns;  max diff %.3e km;  %d rval mismatches\n",
+               (set ? "GTO" : "LEO"),
+               (double)t_scalar * 1e+9 / (double)CLOCKS_PER_SEC / (double)( n_reps * n_elems),
+               (double)t_block * 1e+9 / (double)CLOCKS_PER_SEC / (double)( n_reps * n_elems),
+               max_diff, n_mismatches);
+      if( max_diff > 1e-6 || n_mismatches)
+         rval = 1;
+      }
+   free( arrays);
+   free( rvals);
+   return( rval);
+}
+
+/* Compares the Chebyshev-fitted positions from lunar_solar_eval( ) to
+those from lunar_solar_position( ) over a year,  and times both.  The
+moon should be good to well under a meter;  the sun to a few meters
+(mostly roundoff,  at 1.5e+11 meters).  Returns 1 if either is off.  */
+
+static int lunar_solar_test( void)
+{
+   const double jd0 = 2458849.5;       /* 2020 Jan 1 */
+   const int n_steps = 100000;
+   void *lunar_solar = lunar_solar_init( jd0, jd0 + 366.);
+   double max_dlunar = 0., max_dsolar = 0.;
+   int i, j;
+   clock_t t0;
+
+   if( !lunar_solar)
+      {
+      printf( "lunar_solar_init( ) failed\n");
+      return( 1);
+      }
+   for( i = 0; i < n_steps; i++)
+      {
+      const double jd = jd0 + 366. * (double)i / (double)n_steps;
+      double lunar[4], solar[4], lunar2[4], solar2[4];
+
+      lunar_solar_position( jd, lunar, solar);
+      lunar_solar_eval( lunar_solar, jd, lunar2, solar2);
+      for( j = 0; j < 3; j++)
+         {
+         if( max_dlunar < fabs( lunar[j] - lunar2[j]))
+            max_dlunar = fabs( lunar[j] - lunar2[j]);
+         if( max_dsolar < fabs( solar[j] - solar2[j]))
+            max_dsolar = fabs( solar[j] - solar2[j]);
+         }
+      }
+   t0 = clock( );
+   for( i = 0; i < n_steps; i++)
+      {
+      double lunar[4], solar[4];
+
+      lunar_solar_position( jd0 + 366. * (double)i / (double)n_steps,
+                                   lunar, solar);
+      }
+   printf( "lunar_solar_position : %.1f ns\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)n_steps);
+   t0 = clock( );
+   for( i = 0; i < n_steps; i++)
+      {
+      double lunar[4], solar[4];
+
+      lunar_solar_eval( lunar_solar, jd0 + 366. * (double)i / (double)n_steps,
+                                   lunar, solar);
+      }
+   printf( "lunar_solar_eval     : %.1f ns\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)n_steps);
+   lunar_solar_free( lunar_solar);
+   printf( "Lunar/solar fit: max diffs %.3f m (moon), %.3f m (sun)\n",
+                  max_dlunar, max_dsolar);
+   return( max_dlunar > 1. || max_dsolar > 10.);
+}
+
+/* Checks that parse_elements_in_buffer( ),  run on the entire file,  gets
+the same TLEs as reading it line by line with parse_elements( ).  */
+
+static int buffer_parse_test( const char *filename)
+{
+   FILE *ifile = fopen( filename, "rb");
+   char *buff, line1[100], line2[100];
+   tle_t *tles, tle;
+   long size;
+   int n_found, n = 0, n_mismatches = 0;
+
+   if( !ifile)
+      return( -1);
+   fseek( ifile, 0L, SEEK_END);
+   size = ftell( ifile);
+   fseek( ifile, 0L, SEEK_SET);
+   buff = (char *)malloc( size);
+   if( !fread( buff, size, 1, ifile))
+      size = 0;
+   n_found = parse_elements_in_buffer( buff, (size_t)size, NULL, size, NULL);
+   tles = (tle_t *)calloc( n_found + 1, sizeof( tle_t));
+   parse_elements_in_buffer( buff, (size_t)size, tles, n_found, NULL);
+   fseek( ifile, 0L, SEEK_SET);
+   *line1 = '\0';
+   while( fgets( line2, sizeof( line2), ifile))
+      {
+      memset( &tle, 0, sizeof( tle_t));
+      if( parse_elements( line1, line2, &tle) >= 0)
+         if( n >= n_found || memcmp( &tle, tles + n++, sizeof( tle_t)))
+            n_mismatches++;
+      strcpy( line1, line2);
+      }
+   fclose( ifile);
+   if( n != n_found)
+      n_mismatches++;
+   printf( "parse_elements_in_buffer : %d TLEs,  %d mismatches\n",
+                  n_found, n_mismatches);
+   free( buff);
+   free( tles);
+   return( n_mismatches);
+}
+
+/* Makes a precomputed catalog from the file,  maps it back in,  and checks
+that its TLEs and params give the same positions as parsing the text and
+initializing each TLE.  Also times the two approaches,  and checks that
+a catalog built in memory matches the one from the file.  */
+
+static int catalog_test( const char *filename)
+{
+   FILE *ifile = fopen( filename, "rb");
+   const char *cat_filename = "test_bat.sxc";
+   char *buff;
+   tle_t *tles;
+   long size;
+   void *catalog;
+   int n_found, i, n_mismatches = 0;
+   clock_t t0;
+   double parse_and_init_time, open_time;
+
+   if( !ifile)
+      return( -1);
+   fseek( ifile, 0L, SEEK_END);
+   size = ftell( ifile);
+   fseek( ifile, 0L, SEEK_SET);
+   buff = (char *)malloc( size);
+   if( !fread( buff, size, 1, ifile))
+      size = 0;
+   fclose( ifile);
+   if( sat_catalog_create( cat_filename, buff, (size_t)size) < 0)
+      {
+      printf( "Couldn't create '%s'\n", cat_filename);
+      free( buff);
+      return( -1);
+      }
+   t0 = clock( );
+   n_found = parse_elements_in_buffer( buff, (size_t)size, NULL, size, NULL);
+   tles = (tle_t *)calloc( n_found + 1, sizeof( tle_t));
+   parse_elements_in_buffer( buff, (size_t)size, tles, n_found, NULL);
+   for( i = 0; i < n_found; i++)
+      {
+      double params[N_SAT_PARAMS];
+
+      if( select_ephemeris( tles + i))
+         SDP4_init( params, tles + i);
+      else
+         SGP4_init( params, tles + i);
+      }
+   parse_and_init_time = (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC;
+   t0 = clock( );
+   catalog = sat_catalog_open( cat_filename);
+   open_time = (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC;
+   if( !catalog || sat_catalog_n_entries( catalog) != n_found)
+      n_mismatches++;
+   else for( i = 0; i < n_found; i++)
+      {
+      const tle_t *tle;
+      const double *cat_params;
+      double params[N_SAT_PARAMS], pos[3], pos2[3];
+      size_t line2_offset, text_size;
+      const char *text = sat_catalog_text( catalog, &text_size);
+      const int is_deep = sat_catalog_entry( catalog, i, &tle, &cat_params,
+                                          &line2_offset);
+      sxpx_state_t state;
+      int j;
+
+      if( is_deep != select_ephemeris( tles + i)
+               || memcmp( tle, tles + i, sizeof( tle_t))
+               || text_size != (size_t)size
+               || line2_offset >= text_size || text[line2_offset] != '2')
+         {
+         n_mismatches++;
+         continue;
+         }
+      if( is_deep)
+         {
+         SDP4_init( params, tles + i);
+         sxpx_init_state( &state, cat_params);
+         }
+      else
+         SGP4_init( params, tles + i);
+      for( j = -2; j <= 2; j++)
+         {
+         const double tsince = (double)j * 1440.;
+
+         if( is_deep)
+            {
+            SDP4( tsince, tles + i, params, pos, NULL);
+            SDP4_r( tsince, tle, cat_params, &state, pos2, NULL);
+            }
+         else
+            {
+            SGP4( tsince, tles + i, params, pos, NULL);
+            SGP4( tsince, tle, cat_params, pos2, NULL);
+            }
+         if( memcmp( pos, pos2, 3 * sizeof( double)))
+            n_mismatches++;
+         }
+      }
+   if( catalog)
+      {
+      void *in_memory = sat_catalog_build( buff, (size_t)size);
+
+      if( !in_memory || sat_catalog_n_entries( in_memory) != n_found)
+         n_mismatches++;
+      else for( i = 0; i < n_found; i++)
+         {
+         const tle_t *tle1, *tle2;
+         const double *params1, *params2;
+         size_t offset1, offset2;
+
+         if( sat_catalog_entry( catalog, i, &tle1, &params1, &offset1)
+                  != sat_catalog_entry( in_memory, i, &tle2, &params2, &offset2)
+                  || memcmp( tle1, tle2, sizeof( tle_t)) || offset1 != offset2
+                  || memcmp( params1, params2, N_SAT_PARAMS * sizeof( double)))
+            n_mismatches++;
+         }
+      if( in_memory)
+         sat_catalog_close( in_memory);
+      }
+   printf( "Catalog : %d TLEs,  %d mismatches\n", n_found, n_mismatches);
+   printf( "   parse + init %.3f s;  open catalog %.6f s\n",
+                  parse_and_init_time, open_time);
+   if( catalog)
+      sat_catalog_close( catalog);
+   remove( cat_filename);
+   free( buff);
+   free( tles);
+   return( n_mismatches);
+}
+
+/* Checks that write_tles_in_tle_format( ) matches write_elements_in_tle_format( )
+byte for byte,  and that its output can be read back in by parse_elements( )
+(with correct checksums) and written out again unchanged.  Besides the TLEs
+from the input file,  it tries variants with randomized epochs,  angles,
+mean motions,  and so on,  to exercise the rounding.  */
+
+static int tle_writer_test( const tle_t *tles, const int n_tles)
+{
+   const int n_variants = 20000;
+   const int n = n_tles + n_variants;
+   const double two_pi = 2. * pi;
+   tle_t *test_tles = (tle_t *)malloc( n * sizeof( tle_t));
+   char *text = (char *)malloc( (size_t)n * 142 + 1), buff[200];
+   int i, n_mismatches = 0, n_round_trip_failures = 0;
+   double batch_time, single_time;
+   clock_t t0;
+
+   srand( 1);
+   memcpy( test_tles, tles, n_tles * sizeof( tle_t));
+   for( i = n_tles; i < n; i++)
+      {
+      tle_t *tle = test_tles + i;
+
+      *tle = tles[i % n_tles];
+      tle->epoch += 10000. * (double)rand( ) / (double)RAND_MAX;
+      tle->revolution_number = rand( ) % 100000;
+      tle->bulletin_number = rand( ) % 10000;
+      if( tle->ephemeris_type != 'H')
+         {
+         tle->xincl = pi * (double)rand( ) / (double)RAND_MAX;
+         tle->xnodeo = two_pi * (double)rand( ) / (double)RAND_MAX;
+         tle->omegao = two_pi * (double)rand( ) / (double)RAND_MAX;
+         tle->xmo = two_pi * (double)rand( ) / (double)RAND_MAX;
+         tle->xno *= .5 + (double)rand( ) / (double)RAND_MAX;
+         tle->eo = .9 * (double)rand( ) / (double)RAND_MAX;
+         tle->bstar *= (double)rand( ) / (double)RAND_MAX;
+         }
+      }
+   t0 = clock( );
+   write_tles_in_tle_format( text, test_tles, n);
+   batch_time = (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC;
+   t0 = clock( );
+   for( i = 0; i < n; i++)
+      write_elements_in_tle_format( buff, test_tles + i);
+   single_time = (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC;
+   for( i = 0; i < n; i++)
+      {
+      char line1[80], line2[80];
+      const char *tptr = text + (size_t)i * 142;
+      tle_t tle;
+
+      write_elements_in_tle_format( buff, test_tles + i);
+      if( memcmp( buff, tptr, 142))
+         {
+         if( !n_mismatches++)
+            printf( "TLE writer mismatch :\n%s%.142s", buff, tptr);
+         continue;
+         }
+      memcpy( line1, tptr, 71);
+      line1[71] = '\0';
+      memcpy( line2, tptr + 71, 71);
+      line2[71] = '\0';
+      if( parse_elements( line1, line2, &tle))
+         n_round_trip_failures++;
+      else
+         {
+         write_tles_in_tle_format( buff, &tle, 1);
+         if( memcmp( buff, tptr, 142))
+            n_round_trip_failures++;
+         }
+      }
+   printf( "TLE writer : %d mismatches,  %d round-trip failures in %d TLEs\n",
+                  n_mismatches, n_round_trip_failures, n);
+   printf( "   write_elements_in_tle_format %.1f ns;  write_tles_in_tle_format %.1f ns\n",
+                  single_time * 1e+9 / (double)n, batch_time * 1e+9 / (double)n);
+   free( test_tles);
+   free( text);
+   return( n_mismatches + n_round_trip_failures);
+}
+
+/* Checks tle_index_find( ) and tle_index_find_desig( ) against linear
+searches,  using the test TLEs plus many more with NORAD numbers spread
+up to the Super-5 range,  and some numbers/designations that aren't
+there at all.  */
+
+static int tle_index_test( const tle_t *tles, const int n_tles)
+{
+   const int n = n_tles + 100000;
+   tle_t *test_tles = (tle_t *)malloc( n * sizeof( tle_t));
+   void *index;
+   int i, j, n_errors = 0;
+   clock_t t0;
+
+   memcpy( test_tles, tles, n_tles * sizeof( tle_t));
+   for( i = n_tles; i < n; i++)
+      {
+      tle_t *tle = test_tles + i;
+      const unsigned u = (unsigned)i;
+
+      *tle = tles[i % n_tles];
+      tle->norad_number = 100000 + (int)( u * 9973u % 905969664u);
+      snprintf( tle->intl_desig, sizeof( tle->intl_desig), "%02u%03u%c%c",
+                  u % 100u, u / 676u % 1000u, 'A' + u % 26u, 'A' + u / 26u % 26u);
+      }
+   t0 = clock( );
+   index = tle_index_create( test_tles, n);
+   for( i = 0; i < n; i++)
+      {
+      const int idx = tle_index_find( index, test_tles[i].norad_number);
+      const int idx2 = tle_index_find_desig( index, test_tles[i].intl_desig);
+
+      if( idx < 0 || idx > i
+               || test_tles[idx].norad_number != test_tles[i].norad_number)
+         n_errors++;
+      if( idx2 < 0 || idx2 > i
+               || strcmp( test_tles[idx2].intl_desig, test_tles[i].intl_desig))
+         n_errors++;
+      }
+   printf( "TLE index : %.1f ns per TLE to build and look up\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)n);
+   for( i = 0; i < n_tles; i++)      /* the first occurrence must be found */
+      {
+      for( j = 0; test_tles[j].norad_number != test_tles[i].norad_number; j++)
+         ;
+      if( tle_index_find( index, test_tles[i].norad_number) != j)
+         n_errors++;
+      }
+   if( tle_index_find( index, 99999999) != -1
+                  || tle_index_find_desig( index, "57999ZZZ") != -1)
+      n_errors++;
+   if( tle_index_find_desig( index, "98067A") != tle_index_find_desig( index, "98067A  "))
+      n_errors++;
+   tle_index_free( index);
+   free( test_tles);
+   if( n_errors)
+      printf( "%d TLE index errors\n", n_errors);
+   return( n_errors);
+}
+
+int main( const int argc, const char **argv)
+{
+   const char *filename = "test.tle";
+   FILE *ifile;
+   char line1[100], line2[100];
+   int n_sats = 30000, n_tles = 0, i, j, n_rval_mismatches = 0;
+   int n_posn_only_mismatches = 0;
+   tle_t *tles;
+   double *tsince, *batch_params, *params, *pos, *vel, *pos2, *vel2;
+   double max_dpos = 0., max_dvel = 0.;
+   int *rvals;
+   clock_t t0;
+
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] == '-' && argv[i][1] == 'n')
+         n_sats = atoi( argv[i] + 2);
+      else
+         filename = argv[i];
+   ifile = fopen( filename, "rb");
+   if( !ifile)
+      {
+      printf( "Couldn't open '%s'\n", filename);
+      return( -1);
+      }
+   tles = (tle_t *)malloc( n_sats * sizeof( tle_t));
+   *line1 = '\0';
+   while( n_tles < n_sats && fgets( line2, sizeof( line2), ifile))
+      {
+      if( !parse_elements( line1, line2, tles + n_tles))
+         n_tles++;
+      strcpy( line1, line2);
+      }
+   fclose( ifile);
+   if( !n_tles)
+      {
+      printf( "No TLEs found in '%s'\n", filename);
+      return( -1);
+      }
+   printf( "%d distinct TLEs read\n", n_tles);
+   for( i = n_tles; i < n_sats; i++)
+      tles[i] = tles[i % n_tles];
+   tsince = (double *)malloc( n_sats * sizeof( double));
+   for( i = 0; i < n_sats; i++)
+      tsince[i] = (double)((i * 7919) % 28801 - 14400);
+   batch_params = (double *)malloc( n_sats * N_SGP4_BATCH_PARAMS * sizeof( double));
+   params = (double *)malloc( n_sats * N_SGP4_PARAMS * sizeof( double));
+   pos = (double *)malloc( 12 * n_sats * sizeof( double));
+   vel = pos + 3 * n_sats;
+   pos2 = vel + 3 * n_sats;
+   vel2 = pos2 + 3 * n_sats;
+   rvals = (int *)malloc( n_sats * sizeof( int));
+
+   t0 = clock( );
+   for( i = 0; i < n_sats; i++)
+      SGP4_init( params + i * N_SGP4_PARAMS, tles + i);
+   printf( "SGP4_init       : %.1f ns/satellite\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)n_sats);
+   t0 = clock( );
+   SGP4_batch_init( batch_params, tles, n_sats);
+   printf( "SGP4_batch_init : %.1f ns/satellite\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)n_sats);
+
+   t0 = clock( );
+   for( i = 0; i < n_sats; i++)
+      SGP4( tsince[i], tles + i, params + i * N_SGP4_PARAMS,
+                                 pos + i * 3, vel + i * 3);
+   printf( "SGP4            : %.1f ns/satellite\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)n_sats);
+   t0 = clock( );
+   for( i = 0; i < n_sats; i++)
+      SGP4( tsince[i], tles + i, params + i * N_SGP4_PARAMS,
+                                 pos2 + i * 3, NULL);
+   printf( "SGP4 (posn only): %.1f ns/satellite\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)n_sats);
+   for( i = 0; i < 3 * n_sats; i++)
+      if( pos[i] != pos2[i])
+         n_posn_only_mismatches++;
+   if( n_posn_only_mismatches)
+      printf( "%d position-only mismatches\n", n_posn_only_mismatches);
+   t0 = clock( );
+   SGP4_batch( tsince, batch_params, n_sats, pos2, vel2, rvals);
+   printf( "SGP4_batch      : %.1f ns/satellite\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)n_sats);
+
+   for( i = 0; i < n_sats; i++)
+      {
+      const int rval = SGP4( tsince[i], tles + i, params + i * N_SGP4_PARAMS,
+                                 pos + i * 3, vel + i * 3);
+
+      if( rval != rvals[i])
+         n_rval_mismatches++;
+      else if( rval != SXPX_ERR_CONVERGENCE_FAIL)
+         for( j = i * 3; j < i * 3 + 3; j++)
+            {
+            const double dpos = fabs( pos[j] - pos2[j]);
+            const double dvel = fabs( vel[j] - vel2[j]);
+
+            if( max_dpos < dpos)
+               max_dpos = dpos;
+            if( max_dvel < dvel)
+               max_dvel = dvel;
+            }
+      }
+   printf( "Batch vs. scalar: max diffs %.3e km, %.3e km/min;  %d return code mismatches\n",
+                  max_dpos, max_dvel, n_rval_mismatches);
+   i = spacetrack_test( );
+   if( ephemeris_test( tles, n_tles, 10000, &n_rval_mismatches) > 1.)
+      i = 1;
+   if( reentrant_test( tles, n_tles))
+      i = 1;
+   if( config_test( tles, n_tles))
+      i = 1;
+   if( lunar_solar_test( ))
+      i = 1;
+   if( kepler_test( ))
+      i = 1;
+   if( buffer_parse_test( filename))
+      i = 1;
+   if( checkpoint_test( tles, n_tles))
+      i = 1;
+   if( catalog_test( filename))
+      i = 1;
+   if( tle_writer_test( tles, n_tles))
+      i = 1;
+   if( tle_index_test( tles, n_tles))
+      i = 1;
+   if( n_rval_mismatches)
+      printf( "%d return code mismatches\n", n_rval_mismatches);
+   free( tles);
+   free( tsince);
+   free( batch_params);
+   free( params);
+   free( pos);
+   free( rvals);
+   return( i || n_rval_mismatches || n_posn_only_mismatches || max_dpos > 1e-6 || max_dvel > 1e-6);
+}
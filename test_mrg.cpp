@@ -0,0 +1,129 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/*
+ *  test_mrg.cpp
+ *
+ *  Checks that 'mergetle' gives the same output when sorting in memory
+ *  as with the streaming (external) merge of -x,  for every sort method,
+ *  both with small runs (so that several temporary files get merged) and
+ *  with one run holding everything.  It's run on 'test.tle' (or the file
+ *  given on the command line),  and on an empty file,  since nothing is
+ *  read or sorted then.  'mergetle' is expected in the current directory;
+ *  the temporary files 'test_mrg?.tle' are made there,  too,  and removed
+ *  afterward.  Returns zero if everything matched.
+ *
+ *     The in-memory sort keeps only the first TLE for each NORAD number,
+ *  while -x keeps every epoch;  so the input shouldn't have more than
+ *  one epoch for any object.  ('test.tle' only has exact duplicates.)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+   #define MERGETLE     "mergetle"
+   #define NULL_DEVICE  "NUL"
+#else
+   #define MERGETLE     "./mergetle"
+   #define NULL_DEVICE  "/dev/null"
+#endif
+
+/* Returns 0 if the files are identical,  1 if they differ,  -1 if
+either can't be read. */
+
+static int compare_files( const char *name1, const char *name2)
+{
+   FILE *ifile1 = fopen( name1, "rb"), *ifile2 = fopen( name2, "rb");
+   int rval = -1;
+
+   if( ifile1 && ifile2)
+      {
+      int c1, c2;
+
+      do
+         {
+         c1 = getc( ifile1);
+         c2 = getc( ifile2);
+         }
+         while( c1 == c2 && c1 != EOF);
+      rval = (c1 != c2);
+      }
+   if( ifile1)
+      fclose( ifile1);
+   if( ifile2)
+      fclose( ifile2);
+   return( rval);
+}
+
+/* Runs mergetle on 'input_file' with the given options,  writing
+to 'output_file'.  Returns mergetle's exit status. */
+
+static int run_mergetle( const char *input_file, const char *options,
+                                       const char *output_file)
+{
+   char command[300];
+
+   snprintf( command, sizeof( command), "%s %s %s -o%s >%s",
+                  MERGETLE, input_file, options, output_file, NULL_DEVICE);
+   return( system( command));
+}
+
+static int test_file( const char *input_file)
+{
+   const char *sort_methods = "nNcCmepioq";
+   const char *run_options[2] = { "-x7", "-x100000" };
+   const char *in_memory = "test_mrg1.tle", *streamed = "test_mrg2.tle";
+   int n_failures = 0, i, j;
+
+   for( i = 0; sort_methods[i]; i++)
+      {
+      char options[20];
+
+      snprintf( options, sizeof( options), "-s%c", sort_methods[i]);
+      if( run_mergetle( input_file, options, in_memory))
+         {
+         printf( "'%s' %s failed\n", input_file, options);
+         n_failures++;
+         continue;
+         }
+      for( j = 0; j < 2; j++)
+         {
+         snprintf( options, sizeof( options), "-s%c %s",
+                                 sort_methods[i], run_options[j]);
+         if( run_mergetle( input_file, options, streamed))
+            {
+            printf( "'%s' %s failed\n", input_file, options);
+            n_failures++;
+            }
+         else if( compare_files( in_memory, streamed))
+            {
+            printf( "'%s' %s : output differs from in-memory sort\n",
+                                 input_file, options);
+            n_failures++;
+            }
+         }
+      }
+   remove( in_memory);
+   remove( streamed);
+   printf( "'%s' : %d failures\n", input_file, n_failures);
+   return( n_failures);
+}
+
+int main( const int argc, const char **argv)
+{
+   const char *filename = (argc > 1 ? argv[1] : "test.tle");
+   const char *empty_file = "test_mrg0.tle";
+   FILE *ofile = fopen( empty_file, "wb");
+   int n_failures;
+
+   if( !ofile)
+      {
+      printf( "Couldn't create '%s'\n", empty_file);
+      return( -1);
+      }
+   fclose( ofile);
+   n_failures = test_file( filename) + test_file( empty_file);
+   remove( empty_file);
+   return( n_failures ? 1 : 0);
+}
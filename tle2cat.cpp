@@ -0,0 +1,107 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/* Converts TLE files to precomputed catalogs (see 'sat_cat.cpp'),  so
+that sat_id can skip parsing and initializing each TLE.  Usage:
+
+tle2cat (TLE file) [(TLE file) ...]
+
+   The catalog for 'foo.tle' (or 'foo.tle.gz') is written to
+'foo.tle.sxc',  which is where sat_id looks for it.  sat_id only uses
+the catalog if it's at least as new as the TLE file;  re-run this
+whenever the TLEs are updated.  Files mentioned in '# Include' lines
+aren't converted automatically;  give them on the command line,  too.
+
+   The text is stored as sat_id reads it :  in lines of at most 99
+bytes,  with trailing spaces and control characters removed.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined( _WIN32) || defined( __WATCOMC__)
+   #include "zlibstub.h"
+#else
+   #include <zlib.h>
+#endif
+#include "norad.h"
+
+#define LINE_BUFF_SIZE     100      /* as in sat_id.cpp */
+
+static char *read_trimmed_text( const char *filename, size_t *text_size)
+{
+   gzFile ifile = gzopen( filename, "rb");
+   char *text = NULL, line[LINE_BUFF_SIZE];
+   size_t allocated = 0;
+
+   *text_size = 0;
+   if( !ifile)
+      return( NULL);
+   while( gzgets( ifile, line, LINE_BUFF_SIZE))
+      {
+      size_t len = strlen( line);
+
+      while( len && line[len - 1] <= ' ')
+         len--;
+      if( *text_size + len + 1 > allocated)
+         {
+         allocated = 2 * allocated + LINE_BUFF_SIZE;
+         text = (char *)realloc( text, allocated);
+         }
+      memcpy( text + *text_size, line, len);
+      text[*text_size + len] = '\n';
+      *text_size += len + 1;
+      }
+   gzclose( ifile);
+   if( !text)                      /* empty file */
+      text = (char *)calloc( 1, 1);
+   return( text);
+}
+
+int main( const int argc, const char **argv)
+{
+   int i, rval = 0;
+
+   if( argc < 2)
+      {
+      printf( "Usage:  tle2cat (TLE file) [(TLE file) ...]\n"
+              "Writes a precomputed catalog for each TLE file,  with '.sxc'\n"
+              "added to the name.  See 'tle2cat.cpp'.\n");
+      return( -1);
+      }
+   for( i = 1; i < argc; i++)
+      {
+      const clock_t t0 = clock( );
+      char ofilename[255];
+      size_t text_size, len = strlen( argv[i]);
+      char *text = read_trimmed_text( argv[i], &text_size);
+      void *catalog;
+      long n_bytes;
+
+      if( !text)
+         {
+         printf( "Couldn't read '%s'\n", argv[i]);
+         rval = -1;
+         continue;
+         }
+      if( len > 3 && !strcmp( argv[i] + len - 3, ".gz"))
+         len -= 3;
+      if( len + 5 > sizeof( ofilename))
+         len = sizeof( ofilename) - 5;
+      memcpy( ofilename, argv[i], len);
+      strcpy( ofilename + len, ".sxc");
+      n_bytes = sat_catalog_create( ofilename, text, text_size);
+      free( text);
+      catalog = (n_bytes < 0 ? NULL : sat_catalog_open( ofilename));
+      if( !catalog)
+         {
+         printf( "Couldn't write '%s'\n", ofilename);
+         rval = -1;
+         continue;
+         }
+      printf( "%s: %d TLEs,  %ld bytes,  %.3f seconds\n", ofilename,
+                  sat_catalog_n_entries( catalog), n_bytes,
+                  (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+      sat_catalog_close( catalog);
+      }
+   return( rval);
+}
@@ -0,0 +1,179 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/* Compiles a TLE into a Chebyshev ephemeris file (see 'cheb_eph.cpp'),
+then reloads the file and checks it against SGP4/SDP4 at random times,
+timing both.  Usage:
+
+tle2cheb (TLE file) (output file) [options]
+
+   -n(number)   Use the TLE with this NORAD number (default is the first)
+   -s(days)     Start of span,  in days from the TLE epoch (default 0)
+   -e(days)     End of span,  in days from the TLE epoch (default 7)
+   -t(meters)   Tolerance (default 1 meter)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "norad.h"
+
+#define N_CHECKS     100000
+#define minutes_per_day 1440.
+
+static void error_exit( void)
+{
+   printf( "Usage:  tle2cheb (TLE file) (output file) [-n(NORAD number)]\n"
+           "         [-s(start day)] [-e(end day)] [-t(tolerance in meters)]\n"
+           "Days are relative to the TLE epoch.  See 'tle2cheb.cpp'.\n");
+   exit( -1);
+}
+
+int main( const int argc, const char **argv)
+{
+   FILE *ifile;
+   char line1[100], line2[100];
+   double day_start = 0., day_end = 7., tolerance = 1.;
+   double params[N_SAT_PARAMS], max_dpos = 0., max_dvel = 0.;
+   double tsince_start, tsince_end;
+   int i, norad_number = 0, got_it = 0, is_deep;
+   tle_t tle;
+   void *ephem;
+   long n_bytes;
+   clock_t t0;
+
+   if( argc < 3)
+      error_exit( );
+   for( i = 3; i < argc; i++)
+      if( argv[i][0] == '-')
+         switch( argv[i][1])
+            {
+            case 'n':
+               norad_number = atoi( argv[i] + 2);
+               break;
+            case 's':
+               day_start = atof( argv[i] + 2);
+               break;
+            case 'e':
+               day_end = atof( argv[i] + 2);
+               break;
+            case 't':
+               tolerance = atof( argv[i] + 2);
+               break;
+            default:
+               printf( "Unrecognized option '%s'\n", argv[i]);
+               error_exit( );
+               break;
+            }
+   ifile = fopen( argv[1], "rb");
+   if( !ifile)
+      {
+      printf( "Couldn't open '%s'\n", argv[1]);
+      return( -1);
+      }
+   *line1 = '\0';
+   while( !got_it && fgets( line2, sizeof( line2), ifile))
+      {
+      if( parse_elements( line1, line2, &tle) >= 0)
+         got_it = (!norad_number || tle.norad_number == norad_number);
+      strcpy( line1, line2);
+      }
+   fclose( ifile);
+   if( !got_it)
+      {
+      printf( "TLE not found\n");
+      return( -1);
+      }
+   tsince_start = day_start * minutes_per_day;
+   tsince_end = day_end * minutes_per_day;
+   t0 = clock( );
+   ephem = cheby_ephem_compile( &tle, tsince_start, tsince_end,
+                                     tolerance / 1000.);
+   if( !ephem)
+      {
+      printf( "Couldn't fit NORAD %d over that span\n", tle.norad_number);
+      return( -1);
+      }
+   printf( "NORAD %05d:  compiled in %.3f seconds\n", tle.norad_number,
+                  (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+   n_bytes = cheby_ephem_save( ephem, argv[2]);
+   cheby_ephem_free( ephem);
+   if( n_bytes < 0)
+      {
+      printf( "Couldn't write '%s'\n", argv[2]);
+      return( -1);
+      }
+   printf( "%ld bytes written to '%s'\n", n_bytes, argv[2]);
+
+   ephem = cheby_ephem_load( argv[2]);
+   if( !ephem)
+      {
+      printf( "Couldn't reload '%s'\n", argv[2]);
+      return( -1);
+      }
+   is_deep = select_ephemeris( &tle);
+   if( is_deep)
+      {
+      sxpx_config_t config;
+
+      sxpx_get_default_config( &config);
+      config.is_dundee_compliant = 1;        /* as cheby_ephem_compile( ) */
+      SDP4_init_with_config( params, &tle, &config);     /* does */
+      }
+   else
+      SGP4_init( params, &tle);
+   srand( 1);
+   for( i = 0; i < N_CHECKS; i++)
+      {
+      const double tsince = tsince_start + (tsince_end - tsince_start)
+                  * (double)rand( ) / (double)RAND_MAX;
+      double pos[3], vel[3], pos2[3], vel2[3];
+      double dpos = 0., dvel = 0.;
+      int j;
+
+      if( is_deep)
+         SDP4( tsince, &tle, params, pos, vel);
+      else
+         SGP4( tsince, &tle, params, pos, vel);
+      cheby_ephem_eval( ephem, tsince, pos2, vel2);
+      for( j = 0; j < 3; j++)
+         {
+         dpos += (pos[j] - pos2[j]) * (pos[j] - pos2[j]);
+         dvel += (vel[j] - vel2[j]) * (vel[j] - vel2[j]);
+         }
+      if( max_dpos < dpos)
+         max_dpos = dpos;
+      if( max_dvel < dvel)
+         max_dvel = dvel;
+      }
+   printf( "Max errors %.3f m,  %.6f m/s\n", sqrt( max_dpos) * 1000.,
+                  sqrt( max_dvel) * 1000. / 60.);
+   t0 = clock( );
+   for( i = 0; i < N_CHECKS; i++)
+      {
+      double pos[3], vel[3];
+      const double tsince = tsince_start + (tsince_end - tsince_start)
+                  * (double)i / (double)N_CHECKS;
+
+      if( is_deep)
+         SDP4( tsince, &tle, params, pos, vel);
+      else
+         SGP4( tsince, &tle, params, pos, vel);
+      }
+   printf( "SGP4/SDP4        : %.1f ns/step\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)N_CHECKS);
+   t0 = clock( );
+   for( i = 0; i < N_CHECKS; i++)
+      {
+      double pos[3], vel[3];
+      const double tsince = tsince_start + (tsince_end - tsince_start)
+                  * (double)i / (double)N_CHECKS;
+
+      cheby_ephem_eval( ephem, tsince, pos, vel);
+      }
+   printf( "cheby_ephem_eval : %.1f ns/step\n",
+        (double)( clock( ) - t0) * 1e+9 / (double)CLOCKS_PER_SEC / (double)N_CHECKS);
+   cheby_ephem_free( ephem);
+   return( 0);
+}
@@ -5,9 +5,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/stat.h>
 #include "watdefs.h"
 #include "afuncs.h"
 #include "date.h"
+#include "tle_tree.h"
 
 /* Code to extract TLEs for a particular date (MJD).  It looks
 through all TLEs listed in 'tle_list.txt' and outputs those matching
@@ -16,6 +18,78 @@ the MJD given on the command line.  */
 char path[100];
 int verbose;
 
+/* If there's a 'tle_list.txt.sxi' index (see 'tle_tree.c'),  we use it to
+find the '# MJD' block covering our date by binary search,  and seek
+straight to it,  instead of reading through the file.  That only works
+if the blocks are in order and after the '# Ephem range:' line,  and
+there are no '# Include' lines;  otherwise,  we read the file as usual. */
+
+static tle_tree_t *tle_tree = NULL;
+
+/* Sets 'prev_line' to the line before 'offset',  as fgets( ) with a
+100-byte buffer would have read it.  Returns 0 on success.  */
+
+static int get_prev_line( FILE *ifile, const long offset, char *prev_line)
+{
+   char buff[1000];
+   const long start = (offset > (long)sizeof( buff) ? offset - (long)sizeof( buff) : 0L);
+   const size_t n_bytes = (size_t)( offset - start);
+   size_t line_start, line_len;
+
+   *prev_line = '\0';
+   if( !n_bytes)
+      return( 0);
+   if( fseek( ifile, start, SEEK_SET)
+               || fread( buff, 1, n_bytes, ifile) != n_bytes)
+      return( -1);
+   line_start = n_bytes - 1;        /* buff[n_bytes - 1] ends the line */
+   while( line_start && buff[line_start - 1] != '\n')
+      line_start--;
+   if( !line_start && start)        /* line too long to find its start */
+      return( -1);
+   line_len = n_bytes - line_start;
+   line_start += (line_len - 1) / 99 * 99;   /* fgets( ) reads in pieces */
+   memcpy( prev_line, buff + line_start, n_bytes - line_start);
+   prev_line[n_bytes - line_start] = '\0';
+   return( 0);
+}
+
+/* Returns 1 if the index let us handle this file,  0 if it has to be
+read as usual.  */
+
+static int extract_tle_using_index( FILE *ifile, const char *fname,
+                  const char *full_name, const double mjd)
+{
+   const tle_tree_entry_t *entry = tle_tree_find( tle_tree, full_name);
+   const int needed_flags = TLE_TREE_SORTED_BLOCKS | TLE_TREE_RANGE_FIRST;
+   char prev_line[100], buff[100];
+   int idx;
+
+   if( !entry || entry->is_gz || entry->ephem_step <= 0.
+            || (entry->flags & (needed_flags | TLE_TREE_HAS_INCLUDES)) != needed_flags)
+      return( 0);
+   if( mjd < entry->ephem_start || mjd > entry->ephem_end)
+      {
+      if( verbose)
+         printf( "'%s': outside range\n", fname);
+      return( 1);
+      }
+   idx = tle_tree_first_block( entry, 0., entry->ephem_step, mjd);
+   if( idx == entry->n_blocks || entry->blocks[idx].mjd > mjd)
+      return( 1);             /* no block covers 'mjd' */
+   if( get_prev_line( ifile, (long)entry->blocks[idx].offset, prev_line)
+         || fseek( ifile, (long)entry->blocks[idx].offset, SEEK_SET)
+         || !fgets( buff, sizeof( buff), ifile) || memcmp( buff, "# MJD ", 6))
+      {           /* shouldn't happen,  unless the file changed under us */
+      fseek( ifile, 0L, SEEK_SET);
+      return( 0);
+      }
+   printf( "%s", prev_line);    /* show 'worst residual' data */
+   for( idx = 0; idx < 3 && fgets( buff, sizeof( buff), ifile); idx++)
+      printf( "%s", buff);   /* obj name,  lines 1 and 2 of TLE */
+   return( 1);
+}
+
 static void extract_tle_for_date( const char *fname, const double mjd)
 {
    char prev_line[100], buff[100];
@@ -34,6 +108,11 @@ static void extract_tle_for_date( const char *fname, const double mjd)
       }
    if( verbose)
       printf( "Looking at '%s' for %f\n", fname, mjd);
+   if( tle_tree && extract_tle_using_index( ifile, fname, buff, mjd))
+      {
+      fclose( ifile);
+      return;
+      }
    *prev_line = '\0';
    while( fgets( buff, sizeof( buff), ifile))
       {
@@ -98,6 +177,8 @@ int main( const int argc, const char **argv)
 {
    const double jan_1_1970 = 2440587.5;
    const double curr_t = jan_1_1970 + (double)time( NULL) / seconds_per_day;
+   char tree_name[120];
+   struct stat stat_buff;
    double mjd;
 
    if( argc < 2)
@@ -111,7 +192,12 @@ int main( const int argc, const char **argv)
       strcpy( path, argv[2]);
    if( argc > 3)
       verbose = 1;
+   snprintf( tree_name, sizeof( tree_name), "%stle_list.txt.sxi", path);
+   if( !stat( tree_name, &stat_buff))
+      tle_tree = tle_tree_open( tree_name);
    extract_tle_for_date( "tle_list.txt", mjd);
+   if( tle_tree)
+      tle_tree_close( tle_tree);
    return( 0);
 }
 
@@ -0,0 +1,208 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/* Index for looking up TLEs by NORAD number or by international (COSPAR)
+designation.  Finding a given object in a TLE file used to mean a linear
+scan through the whole file,  and 'mergetle' kept a flag for each
+possible NORAD number in an array sized for five-digit numbers.  Alpha-5
+and Super-5 designations (see get_norad_number( ) in 'get_el.cpp') can
+decode to nine-digit numbers,  so neither approach scales.
+
+   Instead,  each key is hashed into an open-addressed table (linear
+probing;  the table size is a power of two,  doubled whenever it gets
+two-thirds full).  A table slot is an eight-byte key and a four-byte
+index,  so the memory used is proportional to the number of objects,
+not to the largest NORAD number.  Each key maps to the index of the
+_first_ TLE added with it;  later TLEs for the same object (say,  from
+an archive with many epochs per object) don't replace it.  */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "norad.h"
+
+#define INITIAL_TABLE_BITS    8
+
+typedef struct
+{
+   uint64_t *keys;
+   int32_t *values;           /* -1 = empty slot */
+   int n_bits, n_used;
+} hash_table_t;
+
+typedef struct
+{
+   hash_table_t norad, desig;
+} tle_index_t;
+
+static inline size_t hash_slot( const uint64_t key, const int n_bits)
+{
+   return( (size_t)( (key * (uint64_t)0x9e3779b97f4a7c15) >> (64 - n_bits)));
+}
+
+static int init_table( hash_table_t *table, const int n_bits)
+{
+   const size_t size = (size_t)1 << n_bits;
+
+   table->keys = (uint64_t *)malloc( size * sizeof( uint64_t));
+   table->values = (int32_t *)malloc( size * sizeof( int32_t));
+   if( !table->keys || !table->values)
+      {
+      free( table->keys);
+      free( table->values);
+      table->keys = NULL;
+      table->values = NULL;
+      return( -1);
+      }
+   memset( table->values, 0xff, size * sizeof( int32_t));
+   table->n_bits = n_bits;
+   table->n_used = 0;
+   return( 0);
+}
+
+/* Returns the slot holding 'key',  or the empty slot where it would go. */
+
+static size_t find_slot( const hash_table_t *table, const uint64_t key)
+{
+   const size_t mask = ((size_t)1 << table->n_bits) - 1;
+   size_t slot = hash_slot( key, table->n_bits);
+
+   while( table->values[slot] >= 0 && table->keys[slot] != key)
+      slot = (slot + 1) & mask;
+   return( slot);
+}
+
+static int grow_table( hash_table_t *table)
+{
+   hash_table_t new_table;
+   const size_t old_size = (size_t)1 << table->n_bits;
+   size_t i;
+
+   if( init_table( &new_table, table->n_bits + 1))
+      return( -1);
+   for( i = 0; i < old_size; i++)
+      if( table->values[i] >= 0)
+         {
+         const size_t slot = find_slot( &new_table, table->keys[i]);
+
+         new_table.keys[slot] = table->keys[i];
+         new_table.values[slot] = table->values[i];
+         }
+   new_table.n_used = table->n_used;
+   free( table->keys);
+   free( table->values);
+   *table = new_table;
+   return( 0);
+}
+
+/* Returns the index already stored for 'key',  or -1 if there wasn't one
+(in which case 'idx' is stored),  or -2 if we ran out of memory.  */
+
+static int add_key( hash_table_t *table, const uint64_t key, const int idx)
+{
+   size_t slot;
+
+   if( 3 * (table->n_used + 1) > 2 << table->n_bits)
+      if( grow_table( table))
+         return( -2);
+   slot = find_slot( table, key);
+   if( table->values[slot] >= 0)
+      return( table->values[slot]);
+   table->keys[slot] = key;
+   table->values[slot] = (int32_t)idx;
+   table->n_used++;
+   return( -1);
+}
+
+static int find_key( const hash_table_t *table, const uint64_t key)
+{
+   return( table->values[find_slot( table, key)]);
+}
+
+/* International designations are eight bytes,  padded with spaces,  such
+as '98067A  '.  We'll accept them either padded or null-terminated,  and
+pack them into a 64-bit key.  */
+
+static uint64_t desig_key( const char *intl_desig)
+{
+   char buff[8];
+   size_t i;
+   uint64_t rval;
+
+   for( i = 0; i < 8 && intl_desig[i] > ' '; i++)
+      buff[i] = intl_desig[i];
+   while( i < 8)
+      buff[i++] = ' ';
+   memcpy( &rval, buff, 8);
+   return( rval);
+}
+
+/* Creates an index of the 'n_tles' TLEs in 'tles',  which may be NULL if
+n_tles == 0 (TLEs can then be added with tle_index_add( )).  Returns NULL
+if memory runs out.  */
+
+void * DLL_FUNC tle_index_create( const tle_t *tles, const int n_tles)
+{
+   tle_index_t *index = (tle_index_t *)calloc( 1, sizeof( tle_index_t));
+   int n_bits = INITIAL_TABLE_BITS, i;
+
+   if( !index)
+      return( NULL);
+   while( 3 * n_tles > 2 << n_bits)
+      n_bits++;
+   if( init_table( &index->norad, n_bits) || init_table( &index->desig, n_bits))
+      {
+      tle_index_free( index);
+      return( NULL);
+      }
+   for( i = 0; i < n_tles; i++)
+      if( tle_index_add( index, tles + i, i) == -2)
+         {
+         tle_index_free( index);
+         return( NULL);
+         }
+   return( index);
+}
+
+/* Adds 'tle',  as index 'idx',  under both its NORAD number and its
+international designation.  Returns the index previously stored for its
+NORAD number,  or -1 if that number is new,  or -2 if memory runs out.  */
+
+int DLL_FUNC tle_index_add( void *index, const tle_t *tle, const int idx)
+{
+   tle_index_t *iptr = (tle_index_t *)index;
+   const int rval = add_key( &iptr->norad, (uint64_t)(uint32_t)tle->norad_number,
+                                    idx);
+
+   if( rval != -2 && add_key( &iptr->desig, desig_key( tle->intl_desig), idx) == -2)
+      return( -2);
+   return( rval);
+}
+
+/* Return the index of the first TLE added for the given NORAD number or
+international designation,  or -1 if there isn't one.  */
+
+int DLL_FUNC tle_index_find( const void *index, const int norad_number)
+{
+   return( find_key( &((const tle_index_t *)index)->norad,
+                           (uint64_t)(uint32_t)norad_number));
+}
+
+int DLL_FUNC tle_index_find_desig( const void *index, const char *intl_desig)
+{
+   return( find_key( &((const tle_index_t *)index)->desig,
+                           desig_key( intl_desig)));
+}
+
+void DLL_FUNC tle_index_free( void *index)
+{
+   tle_index_t *iptr = (tle_index_t *)index;
+
+   if( iptr)
+      {
+      free( iptr->norad.keys);
+      free( iptr->norad.values);
+      free( iptr->desig.keys);
+      free( iptr->desig.values);
+      free( iptr);
+      }
+}
@@ -291,3 +291,287 @@ void DLL_FUNC write_elements_in_tle_format( char *buff, const tle_t *tle)
    snprintf( line2 + 63, 8, "%5dZ\n", tle->revolution_number);
    add_tle_checksum_data( line2);
 }
+
+/* write_elements_in_tle_format( ) spends most of its time in snprintf( ).
+The following functions do the same formatting by hand,  which is several
+times faster when writing out many TLEs (see write_tles_in_tle_format( )
+below).  The output is byte-for-byte identical.  printf( ) rounds the
+exact binary value,  whereas value * 10^n is (very slightly) rounded
+before we round it;  so when the result is very close to a tie,  or
+anything is unusual (out of range,  NaN,  strange characters),  we fall
+back to write_elements_in_tle_format( ).  That happens for about one TLE
+in a thousand.  */
+
+#define TLE_TEXT_SIZE   142      /* two lines,  each 69 bytes plus CR/LF */
+
+static void put_digits( char *obuff, uint64_t value, int n_digits)
+{
+   while( n_digits--)
+      {
+      obuff[n_digits] = (char)( '0' + (int)( value % 10));
+      value /= 10;
+      }
+}
+
+/* Writes 'value' right-justified in 'width' bytes,  as "%(width)d" would.
+Caller makes sure the value is non-negative and fits. */
+
+static void put_padded_int( char *obuff, int value, int width)
+{
+   do
+      {
+      obuff[--width] = (char)( '0' + value % 10);
+      value /= 10;
+      }
+      while( value && width);
+   while( width)
+      obuff[--width] = ' ';
+}
+
+/* Returns 'value * scale',  rounded to an integer just as printf( ) would
+round 'value' to log10( scale) places,  or -1 if that's uncertain or
+'value * scale' isn't between 0 and 'max_scaled'.  */
+
+static int64_t scale_and_round( const double value, const double scale,
+                                        const double max_scaled)
+{
+   const double scaled = value * scale;
+   double ipart, frac;
+
+   if( !( scaled >= 0. && scaled < max_scaled))   /* also catches NaNs */
+      return( -1);
+   ipart = floor( scaled);
+   frac = scaled - ipart;
+   if( fabs( frac - .5) < 1e-4)
+      return( -1);
+   return( (int64_t)ipart + (frac > .5 ? 1 : 0));
+}
+
+/* Writes 'scaled' (value times 10^n_places) as "%0(width).(n_places)f"
+would,  where 'width' = n_int_digits + n_places + 1.  */
+
+static void put_fixed( char *obuff, const int64_t scaled,
+                     const int n_int_digits, const int n_places)
+{
+   int64_t power = 1;
+   int i;
+
+   for( i = 0; i < n_places; i++)
+      power *= 10;
+   put_digits( obuff, (uint64_t)( scaled / power), n_int_digits);
+   obuff[n_int_digits] = '.';
+   put_digits( obuff + n_int_digits + 1, (uint64_t)( scaled % power), n_places);
+}
+
+/* Same as put_sci( ),  except that it returns 0 (instead of going into an
+infinite loop or writing garbage) for non-finite values or exponents
+beyond one digit,  and doesn't use snprintf( ).  */
+
+static int fast_put_sci( char *obuff, double ival)
+{
+   int oval, exponent = 0;
+
+   if( !ival)
+      {
+      memcpy( obuff, " 00000-0", 8);
+      return( 1);
+      }
+   if( !( fabs( ival) < 1e+10 && fabs( ival) > 1e-10))
+      return( 0);
+   if( ival > 0.)
+      *obuff++ = ' ';
+   else
+      {
+      *obuff++ = '-';
+      ival = -ival;
+      }
+   while( 1)
+      {
+      if( ival > 1.)    /* avoid integer overflow */
+         oval = 100000;
+      else
+         oval = (int)( ival * 100000. + .5);
+      if( oval > 99999)
+         {
+         ival /= 10;
+         exponent++;
+         }
+      else if( oval < 10000)
+         {
+         ival *= 10;
+         exponent--;
+         }
+      else
+         break;
+      }
+   if( exponent > 9 || exponent < -9)
+      return( 0);
+   put_digits( obuff, (uint64_t)oval, 5);
+   obuff[5] = (exponent > 0 ? '+' : '-');
+   obuff[6] = (char)( '0' + (exponent > 0 ? exponent : -exponent));
+   return( 1);
+}
+
+/* Equivalent to add_tle_checksum_data( ) for lines built below,  which
+are known to be 68 bytes of valid characters,  with CR/LF following. */
+
+static void add_fast_checksum( char *line)
+{
+   int i, sum = 0;
+
+   for( i = 0; i < 68; i++)
+      {
+      const unsigned digit = (unsigned)( line[i] - '0');
+
+      sum += (digit < 10 ? (int)digit : 0) + (line[i] == '-' ? 1 : 0);
+      }
+   line[68] = (char)( '0' + sum % 10);
+   line[69] = 13;
+   line[70] = 10;
+   line[71] = '\0';
+}
+
+static int is_valid_tle_char( const char c)
+{
+   return( c >= ' ' && c <= 'z');
+}
+
+/* Formats an angle as "%08.4f" (degrees),  after zero_to_two_pi( ). */
+
+static int put_angle( char *obuff, const double angle)
+{
+   const int64_t scaled = scale_and_round(
+                  zero_to_two_pi( angle) * 180. / PI, 10000., 1e+7);
+
+   if( scaled < 0)
+      return( 0);
+   put_fixed( obuff, scaled, 3, 4);
+   return( 1);
+}
+
+/* Returns 0 if it can't be sure of matching write_elements_in_tle_format( ),
+leaving 'buff' in an undefined state. */
+
+static int fast_write_elements( char *buff, const tle_t *tle)
+{
+   long year = (long)( tle->epoch - J1900) / 365 + 1;
+   double day_of_year;
+   char *line2 = buff + TLE_TEXT_SIZE / 2;
+   int64_t scaled;
+   size_t i, len;
+
+   if( !( tle->epoch > J1900 && tle->epoch < J1900 + 200. * 365.))
+      return( 0);
+   do
+      {
+      double start_of_year;
+
+      year--;
+      start_of_year = J1900 + (double)year * 365. + (double)((year - 1) / 4);
+      day_of_year = tle->epoch - start_of_year;
+      }
+      while( day_of_year < 1.);
+   if( year < 0 || year > 200)
+      return( 0);
+   len = strlen( tle->intl_desig);
+   for( i = 0; i < len; i++)
+      if( !is_valid_tle_char( tle->intl_desig[i]))
+         return( 0);
+   if( len > 8 || !is_valid_tle_char( tle->classification)
+           || !is_valid_tle_char( tle->ephemeris_type)
+           || tle->norad_number < 0 || tle->norad_number >= 1000000000
+           || tle->bulletin_number < 0 || tle->bulletin_number > 9999
+           || tle->revolution_number < 0 || tle->revolution_number > 99999)
+      return( 0);
+   memcpy( buff, "1 ", 2);
+   store_norad_number_in_alpha5( buff + 2, tle->norad_number);
+   buff[7] = tle->classification;
+   buff[8] = ' ';
+   memcpy( buff + 9, tle->intl_desig, len);
+   memset( buff + 9 + len, ' ', 9 - len);
+   put_digits( buff + 18, (uint64_t)( year % 100L), 2);
+   scaled = scale_and_round( day_of_year, 100000000., 1e+11);
+   if( scaled < 0)
+      return( 0);
+   put_fixed( buff + 20, scaled, 3, 8);
+   buff[32] = ' ';
+   if( tle->ephemeris_type != 'H')
+      {
+      const double deriv_mean_motion =
+                     tle->xndt2o * MINUTES_PER_DAY_SQUARED / (2. * PI);
+      const double lderiv = fabs( deriv_mean_motion * 100000000.) + .5;
+
+      if( !( lderiv < 100000000.))
+         return( 0);
+      buff[33] = (deriv_mean_motion >= 0 ? ' ' : '-');
+      buff[34] = '.';
+      put_digits( buff + 35, (uint64_t)lderiv, 8);
+      buff[43] = ' ';
+      if( !fast_put_sci( buff + 44, tle->xndd6o * MINUTES_PER_DAY_CUBED / (2. * PI))
+               || !fast_put_sci( buff + 53, tle->bstar / AE))
+         return( 0);
+      buff[52] = buff[61] = ' ';
+      }
+   else
+      {
+      const double *posn = &tle->xincl;
+
+      for( i = 0; i < 3; i++)
+         set_high_value( buff + 33 + i * 10, posn[i]);
+      }
+   buff[62] = tle->ephemeris_type;
+   buff[63] = ' ';
+   put_padded_int( buff + 64, tle->bulletin_number, 4);
+   add_fast_checksum( buff);
+
+   memcpy( line2, "2 ", 2);
+   memcpy( line2 + 2, buff + 2, 5);
+   line2[7] = ' ';
+   if( tle->ephemeris_type != 'H')
+      {
+      const double revs_per_day = tle->xno * MINUTES_PER_DAY / (2. * PI);
+      const double ecc = tle->eo * 10000000. + .5;
+
+      if( !put_angle( line2 + 8, tle->xincl)
+               || !put_angle( line2 + 17, tle->xnodeo)
+               || !( ecc >= 0. && ecc < 10000000.)
+               || !put_angle( line2 + 34, tle->omegao)
+               || !put_angle( line2 + 43, tle->xmo))
+         return( 0);
+      put_digits( line2 + 26, (uint64_t)(long)ecc, 7);
+      scaled = scale_and_round( revs_per_day, 100000000., 1e+10);
+      if( scaled <= 0)
+         return( 0);
+      put_fixed( line2 + 52, scaled, 2, 8);
+      line2[16] = line2[25] = line2[33] = line2[42] = line2[51] = ' ';
+      }
+   else
+      {
+      const double *vel = &tle->xincl + 3;
+
+      memset( line2 + 8, ' ', 25);     /* reserved for future use */
+      for( i = 0; i < 3; i++)
+         set_high_value( line2 + 33 + i * 10, vel[i] * 1e+4);
+      }
+   put_padded_int( line2 + 63, tle->revolution_number, 5);
+   add_fast_checksum( line2);
+   return( 1);
+}
+
+/* Writes 'n_tles' TLEs to 'buff',  one after another,  exactly as
+write_elements_in_tle_format( ) would write each of them.  Each TLE takes
+142 bytes (two 69-byte lines,  each followed by CR/LF);  'buff' must
+have room for 142 * n_tles bytes plus a null terminator.  Returns the
+number of bytes written,  not counting the terminator.  */
+
+long DLL_FUNC write_tles_in_tle_format( char *buff, const tle_t *tles,
+                                                   const int n_tles)
+{
+   int i;
+
+   for( i = 0; i < n_tles; i++, buff += TLE_TEXT_SIZE)
+      if( !fast_write_elements( buff, tles + i))
+         write_elements_in_tle_format( buff, tles + i);
+   *buff = '\0';
+   return( (long)n_tles * TLE_TEXT_SIZE);
+}
@@ -0,0 +1,585 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+/* 'tle_list.txt' (see github.com/Bill-Gray/tles) pulls in thousands of
+TLE files with '# Include' lines.  Finding out whether a given file has
+anything of interest means opening it (usually decompressing it,  too)
+and reading its '# Ephem range:' line.  'summarize.c' helps by putting
+'# Range:' lines in tle_list.txt,  but those aren't always there.
+
+   This keeps a persistent index of the whole tree,  in a single binary
+file ('tle_list.txt.sxi',  for sat_id,  sat_eph and tle_date).  For each
+TLE file,  it has the file's '# Ephem range:',  '# Max error',  the NORAD
+numbers and number of TLEs in it,  and the MJD and offset of each '# MJD'
+line,  so that a program can seek straight to the TLEs for a given date
+(see tle_tree_first_block( )).  It also has the file's 'header' :
+everything up to and including the '# Ephem range:' line,  if there are
+no TLEs or '# Include' lines before it.  If the range shows the file
+isn't needed,  a program can read the header instead of the file,
+getting the same '#' directives (and hence warnings,  etc.) without
+opening the file at all.  Lines are stored as sat_id reads them :  at
+most 99 bytes,  with trailing spaces and control characters removed.
+
+   Each entry is checked against the size and modification time of the
+file (or of 'file.gz',  if there's no uncompressed version).  Missing or
+out-of-date entries are rebuilt when looked up,  and the index is
+rewritten when it's closed.  The index is in native byte order;  if it's
+empty,  or unreadable,  or from an incompatible build,  we start from
+scratch.  Nothing is written if no entries changed.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "norad.h"
+#include "gz_pipe.h"
+#include "tle_tree.h"
+
+#define TLE_TREE_MAGIC        "SxPxTre3"
+#define TLE_TREE_BYTE_ORDER   0x01020304
+#define LINE_BUFF_SIZE        100         /* as in sat_id.cpp */
+
+   /* A file could be changed twice in one second,  without changing its
+      size;  so we use nanosecond modification times where we have them. */
+#ifdef __linux__
+   #define MTIME_NS( s) ((int64_t)(s).st_mtim.tv_sec * 1000000000 + (s).st_mtim.tv_nsec)
+#else
+   #define MTIME_NS( s) ((int64_t)(s).st_mtime * 1000000000)
+#endif
+
+struct tle_tree
+{
+   char *filename;
+   tle_tree_entry_t **entries;
+   int n_entries, n_sorted, n_alloced;
+   int changed;
+};
+
+   /* On-disk,  each entry is this fixed part,  followed by the filename
+      and header text,  the IDs,  and the blocks.   */
+typedef struct
+{
+   int64_t mtime, size;
+   double ephem_start, ephem_end, ephem_step, max_error;
+   int32_t name_len, header_len, is_gz, n_tles, n_ids, n_blocks;
+   int32_t flags, unused;
+} tle_tree_record_t;
+
+static void free_entry( tle_tree_entry_t *entry)
+{
+   if( entry)
+      {
+      free( entry->filename);
+      free( entry->ids);
+      free( entry->blocks);
+      free( entry->header);
+      free( entry);
+      }
+}
+
+static int compare_entries( const void *a, const void *b)
+{
+   return( strcmp( (*(const tle_tree_entry_t * const *)a)->filename,
+                   (*(const tle_tree_entry_t * const *)b)->filename));
+}
+
+/* Callers build file names in different ways ('path/name',  'path//name',
+'./path/name',  'path\name'),  so names are stored and looked up in
+a standard form :  backslashes become slashes,  and repeated slashes
+and '.' components are dropped.  '..' is left alone,  since 'dir/..'
+needn't be the same as '.' if 'dir' is a symlink.  The result is never
+longer than 'iname'.  */
+
+static void normalize_filename( char *oname, const char *iname)
+{
+   char *optr = oname;
+
+   while( *iname)
+      {
+      const char c = (*iname == '\\' ? '/' : *iname);
+
+      if( c == '/' && optr > oname + 1 && optr[-1] == '/')
+         iname++;            /* skip repeated slash,  except for a */
+                             /* leading '\\' (Windows UNC path)   */
+      else if( c == '.' && (optr == oname || optr[-1] == '/')
+               && (iname[1] == '/' || iname[1] == '\\' || !iname[1]))
+         {                                /* skip './' component */
+         iname++;
+         if( *iname)
+            iname++;
+         }
+      else
+         {
+         *optr++ = c;
+         iname++;
+         }
+      }
+   if( optr > oname + 1 && optr[-1] == '/')
+      optr--;                             /* drop a trailing slash */
+   if( optr == oname)
+      *optr++ = '.';
+   *optr = '\0';
+}
+
+static int add_entry( tle_tree_t *tree, tle_tree_entry_t *entry)
+{
+   if( tree->n_entries == tree->n_alloced)
+      {
+      const int new_size = 2 * tree->n_alloced + 64;
+      tle_tree_entry_t **new_entries = (tle_tree_entry_t **)realloc(
+                  tree->entries, new_size * sizeof( tle_tree_entry_t *));
+
+      if( !new_entries)
+         return( -1);
+      tree->entries = new_entries;
+      tree->n_alloced = new_size;
+      }
+   tree->entries[tree->n_entries++] = entry;
+   return( 0);
+}
+
+static void *read_bytes( const char **tptr, const char *end, const size_t n_bytes)
+{
+   void *rval;
+
+   if( (size_t)( end - *tptr) < n_bytes)
+      return( NULL);
+   rval = malloc( n_bytes + 1);
+   if( rval)
+      {
+      memcpy( rval, *tptr, n_bytes);
+      ((char *)rval)[n_bytes] = '\0';
+      *tptr += n_bytes;
+      }
+   return( rval);
+}
+
+static int load_entries( tle_tree_t *tree, const char *buff, const size_t size)
+{
+   const char *tptr = buff + 16, *end = buff + size;
+   int32_t byte_order, n_entries, i;
+
+   if( size < 16 || memcmp( buff, TLE_TREE_MAGIC, 8))
+      return( -1);
+   memcpy( &byte_order, buff + 8, 4);
+   memcpy( &n_entries, buff + 12, 4);
+   if( byte_order != TLE_TREE_BYTE_ORDER)
+      return( -1);
+   for( i = 0; i < n_entries; i++)
+      {
+      tle_tree_record_t rec;
+      tle_tree_entry_t *entry;
+
+      if( (size_t)( end - tptr) < sizeof( rec))
+         return( -1);
+      memcpy( &rec, tptr, sizeof( rec));
+      tptr += sizeof( rec);
+      if( rec.name_len <= 0 || rec.header_len < -1
+                  || rec.n_ids < 0 || rec.n_blocks < 0)
+         return( -1);
+      entry = (tle_tree_entry_t *)calloc( 1, sizeof( tle_tree_entry_t));
+      if( !entry || add_entry( tree, entry))
+         {
+         free( entry);
+         return( -1);
+         }
+      entry->mtime = rec.mtime;
+      entry->size = rec.size;
+      entry->is_gz = rec.is_gz;
+      entry->n_tles = rec.n_tles;
+      entry->n_ids = rec.n_ids;
+      entry->n_blocks = rec.n_blocks;
+      entry->flags = rec.flags;
+      entry->ephem_start = rec.ephem_start;
+      entry->ephem_end = rec.ephem_end;
+      entry->ephem_step = rec.ephem_step;
+      entry->max_error = rec.max_error;
+      entry->filename = (char *)read_bytes( &tptr, end, rec.name_len);
+      if( !entry->filename)
+         return( -1);
+      if( rec.header_len >= 0)
+         {
+         entry->header = (char *)read_bytes( &tptr, end, rec.header_len);
+         entry->header_size = (size_t)rec.header_len;
+         if( !entry->header)
+            return( -1);
+         }
+      entry->ids = (int *)read_bytes( &tptr, end, rec.n_ids * sizeof( int));
+      entry->blocks = (tle_tree_block_t *)read_bytes( &tptr, end,
+                           rec.n_blocks * sizeof( tle_tree_block_t));
+      if( !entry->ids || !entry->blocks)
+         return( -1);
+      }
+   return( 0);
+}
+
+/* Loads the index from 'index_filename'.  If the file doesn't exist (or
+isn't an index),  you get an empty index,  which will be written to that
+file by tle_tree_close( ).  */
+
+tle_tree_t *tle_tree_open( const char *index_filename)
+{
+   tle_tree_t *tree = (tle_tree_t *)calloc( 1, sizeof( tle_tree_t));
+   FILE *ifile;
+
+   if( !tree)
+      return( NULL);
+   tree->filename = (char *)malloc( strlen( index_filename) + 1);
+   if( !tree->filename)
+      {
+      free( tree);
+      return( NULL);
+      }
+   strcpy( tree->filename, index_filename);
+   ifile = fopen( index_filename, "rb");
+   if( ifile)
+      {
+      long size;
+      char *buff = NULL;
+
+      if( !fseek( ifile, 0L, SEEK_END) && (size = ftell( ifile)) > 0)
+         {
+         buff = (char *)malloc( (size_t)size);
+         fseek( ifile, 0L, SEEK_SET);
+         if( buff && fread( buff, (size_t)size, 1, ifile) == 1
+                  && load_entries( tree, buff, (size_t)size))
+            {
+            while( tree->n_entries)          /* bad file : start over */
+               free_entry( tree->entries[--tree->n_entries]);
+            tree->changed = 1;
+            }
+         }
+      free( buff);
+      fclose( ifile);
+      }
+   if( tree->n_entries)
+      qsort( tree->entries, tree->n_entries, sizeof( tle_tree_entry_t *),
+                                          compare_entries);
+   tree->n_sorted = tree->n_entries;
+   return( tree);
+}
+
+static int add_id( tle_tree_entry_t *entry, void *index, const tle_t *tle)
+{
+   const int prev = tle_index_add( index, tle, entry->n_ids);
+
+   if( prev != -1)            /* already got it,  or out of memory */
+      return( prev == -2 ? -1 : 0);
+   if( !(entry->n_ids & (entry->n_ids - 1)))
+      {
+      int *new_ids = (int *)realloc( entry->ids,
+                  (entry->n_ids ? 2 * entry->n_ids : 1) * sizeof( int));
+
+      if( !new_ids)
+         return( -1);
+      entry->ids = new_ids;
+      }
+   entry->ids[entry->n_ids++] = tle->norad_number;
+   return( 0);
+}
+
+static int add_block( tle_tree_entry_t *entry, const double mjd,
+                                       const int64_t offset)
+{
+   if( !(entry->n_blocks & (entry->n_blocks - 1)))
+      {
+      tle_tree_block_t *new_blocks = (tle_tree_block_t *)realloc(
+                  entry->blocks, (entry->n_blocks ? 2 * entry->n_blocks : 1)
+                                    * sizeof( tle_tree_block_t));
+
+      if( !new_blocks)
+         return( -1);
+      entry->blocks = new_blocks;
+      }
+   entry->blocks[entry->n_blocks].mjd = mjd;
+   entry->blocks[entry->n_blocks].offset = offset;
+   entry->n_blocks++;
+   return( 0);
+}
+
+/* Reads through 'filename' (or 'filename.gz'),  gathering what goes
+into its index entry.  Returns 0 on success.  */
+
+static int scan_file( tle_tree_entry_t *entry, const char *filename,
+                                    const int is_gz)
+{
+   char line1[LINE_BUFF_SIZE], line2[LINE_BUFF_SIZE];
+   gz_pipe_t *ifile;
+   void *index = tle_index_create( NULL, 0);
+   int64_t offset = 0;
+   size_t header_alloced = 0;
+   int header_done = 0, got_range = 0, rval = 0;
+
+   if( is_gz)
+      {
+      char gz_name[255];
+
+      snprintf( gz_name, sizeof( gz_name), "%s.gz", filename);
+      ifile = gz_pipe_open( gz_name);
+      }
+   else
+      ifile = gz_pipe_open( filename);
+   if( !ifile || !index)
+      {
+      if( ifile)
+         gz_pipe_close( ifile);
+      tle_index_free( index);
+      return( -1);
+      }
+   *line1 = '\0';
+   entry->flags = TLE_TREE_SORTED_BLOCKS | TLE_TREE_RANGE_FIRST
+                              | TLE_TREE_TLES_IN_BLOCKS;
+   while( !rval && gz_pipe_gets( ifile, line2, LINE_BUFF_SIZE))
+      {
+      const int64_t line_offset = offset;
+      size_t len = strlen( line2);
+      tle_t tle;
+
+      offset += (int64_t)len;
+      while( len && line2[len - 1] <= ' ')
+         len--;
+      line2[len] = '\0';
+      if( parse_elements( line1, line2, &tle) >= 0)
+         {
+         entry->n_tles++;
+         rval = add_id( entry, index, &tle);
+         if( !entry->n_blocks)
+            entry->flags &= ~TLE_TREE_TLES_IN_BLOCKS;
+         if( !header_done)          /* TLE before '# Ephem range' : */
+            {                       /* no usable header */
+            free( entry->header);
+            entry->header = NULL;
+            header_done = 1;
+            }
+         }
+      else if( !memcmp( line2, "# MJD ", 6))
+         {
+         const double mjd = atof( line2 + 6);
+
+         if( entry->n_blocks && mjd < entry->blocks[entry->n_blocks - 1].mjd)
+            entry->flags &= ~TLE_TREE_SORTED_BLOCKS;
+         if( !got_range)
+            entry->flags &= ~TLE_TREE_RANGE_FIRST;
+         rval = add_block( entry, mjd, line_offset);
+         }
+      else if( !memcmp( line2, "# Max error", 11) && !entry->max_error)
+         entry->max_error = atof( line2 + 12);
+      else if( !memcmp( line2, "# Include ", 10))
+         {
+         entry->flags |= TLE_TREE_HAS_INCLUDES;
+         if( !header_done)
+            {
+            free( entry->header);
+            entry->header = NULL;
+            header_done = 1;
+            }
+         }
+      if( !header_done)
+         {
+         if( entry->header_size + len + 1 > header_alloced)
+            {
+            char *new_header;
+
+            header_alloced = 2 * header_alloced + LINE_BUFF_SIZE;
+            new_header = (char *)realloc( entry->header, header_alloced);
+            if( !new_header)
+               rval = -1;
+            else
+               entry->header = new_header;
+            }
+         if( !rval)
+            {
+            memcpy( entry->header + entry->header_size, line2, len);
+            entry->header[entry->header_size + len] = '\n';
+            entry->header_size += len + 1;
+            }
+         }
+      if( *line2 == '#' && strstr( line2, " H "))
+         entry->flags |= TLE_TREE_H_LINES;
+      if( !memcmp( line2, "# Ephem range:", 14) && !got_range)
+         {
+         got_range = (sscanf( line2 + 14, "%lf %lf %lf", &entry->ephem_start,
+                     &entry->ephem_end, &entry->ephem_step) == 3);
+         if( !got_range)
+            entry->ephem_start = entry->ephem_end = entry->ephem_step = 0.;
+         else
+            header_done = 1;
+         }
+      strcpy( line1, line2);
+      }
+   if( !got_range)
+      {           /* a header's no use without a range at the end of it */
+      free( entry->header);
+      entry->header = NULL;
+      }
+   if( !entry->header)
+      entry->header_size = 0;
+   gz_pipe_close( ifile);
+   tle_index_free( index);
+   return( rval);
+}
+
+/* Returns the first block for which (block MJD + offset) + step > limit,
+or n_blocks if there are none,  by binary search.  This only makes sense
+if the blocks are sorted (TLE_TREE_SORTED_BLOCKS).  tle_date wants the
+block covering 'mjd',  i.e.,  the first one with MJD + step > mjd,  if that
+block's MJD <= mjd;  sat_eph wants to skip blocks with JD + 1 <= the start
+of the ephemeris.  The sum is computed just as they compute it,  and
+rounding is monotonic,  so the result matches a linear search.  */
+
+int tle_tree_first_block( const tle_tree_entry_t *entry, const double offset,
+                              const double step, const double limit)
+{
+   int lo = 0, hi = entry->n_blocks;
+
+   while( lo < hi)
+      {
+      const int mid = (lo + hi) / 2;
+
+      if( (entry->blocks[mid].mjd + offset) + step > limit)
+         hi = mid;
+      else
+         lo = mid + 1;
+      }
+   return( lo);
+}
+
+/* Returns the index entry for 'name',  first (re)building it if it's
+missing or out of date.  Returns NULL if neither 'name' nor 'name.gz'
+can be read.  'name' is normalized first,  so different spellings of
+the same path share one entry.  */
+
+const tle_tree_entry_t *tle_tree_find( tle_tree_t *tree, const char *name)
+{
+   tle_tree_entry_t key, *key_ptr = &key, **found = NULL, *entry;
+   struct stat stat_buff;
+   char filename[255], gz_name[255];
+   int is_gz = 0, i;
+
+   if( strlen( name) >= sizeof( filename))
+      return( NULL);
+   normalize_filename( filename, name);
+   if( stat( filename, &stat_buff))
+      {
+      snprintf( gz_name, sizeof( gz_name), "%s.gz", filename);
+      if( stat( gz_name, &stat_buff))
+         return( NULL);
+      is_gz = 1;
+      }
+   key.filename = filename;
+   if( tree->n_sorted)
+      found = (tle_tree_entry_t **)bsearch( &key_ptr, tree->entries,
+                  tree->n_sorted, sizeof( tle_tree_entry_t *), compare_entries);
+   for( i = tree->n_sorted; !found && i < tree->n_entries; i++)
+      if( !strcmp( tree->entries[i]->filename, filename))
+         found = tree->entries + i;
+   if( found && (*found)->is_gz == is_gz
+               && (*found)->mtime == MTIME_NS( stat_buff)
+               && (*found)->size == (int64_t)stat_buff.st_size)
+      return( *found);
+   entry = (tle_tree_entry_t *)calloc( 1, sizeof( tle_tree_entry_t));
+   if( !entry)
+      return( NULL);
+   entry->filename = (char *)malloc( strlen( filename) + 1);
+   if( !entry->filename || scan_file( entry, filename, is_gz))
+      {
+      free_entry( entry);
+      return( NULL);
+      }
+   strcpy( entry->filename, filename);
+   entry->is_gz = is_gz;
+   entry->mtime = MTIME_NS( stat_buff);
+   entry->size = (int64_t)stat_buff.st_size;
+   if( found)
+      {
+      free_entry( *found);
+      *found = entry;
+      }
+   else if( add_entry( tree, entry))
+      {
+      free_entry( entry);
+      return( NULL);
+      }
+   tree->changed = 1;
+   return( entry);
+}
+
+static int write_tree( const tle_tree_t *tree, FILE *ofile)
+{
+   const int32_t byte_order = TLE_TREE_BYTE_ORDER;
+   const int32_t n_entries = tree->n_entries;
+   int i, err = 0;
+
+   fwrite( TLE_TREE_MAGIC, 8, 1, ofile);
+   fwrite( &byte_order, sizeof( int32_t), 1, ofile);
+   fwrite( &n_entries, sizeof( int32_t), 1, ofile);
+   for( i = 0; !err && i < n_entries; i++)
+      {
+      const tle_tree_entry_t *entry = tree->entries[i];
+      tle_tree_record_t rec;
+
+      memset( &rec, 0, sizeof( rec));
+      rec.mtime = entry->mtime;
+      rec.size = entry->size;
+      rec.ephem_start = entry->ephem_start;
+      rec.ephem_end = entry->ephem_end;
+      rec.ephem_step = entry->ephem_step;
+      rec.max_error = entry->max_error;
+      rec.name_len = (int32_t)strlen( entry->filename);
+      rec.header_len = (entry->header ? (int32_t)entry->header_size : -1);
+      rec.is_gz = entry->is_gz;
+      rec.n_tles = entry->n_tles;
+      rec.n_ids = entry->n_ids;
+      rec.n_blocks = entry->n_blocks;
+      rec.flags = entry->flags;
+      fwrite( &rec, sizeof( rec), 1, ofile);
+      fwrite( entry->filename, rec.name_len, 1, ofile);
+      if( entry->header)
+         fwrite( entry->header, entry->header_size, 1, ofile);
+      fwrite( entry->ids, sizeof( int), entry->n_ids, ofile);
+      fwrite( entry->blocks, sizeof( tle_tree_block_t), entry->n_blocks, ofile);
+      err = ferror( ofile);
+      }
+   return( err);
+}
+
+/* Writes the index back out,  if anything's changed (via a temporary
+file,  so that an interrupted write can't leave a damaged index),  and
+frees it.  Returns 0 on success.  */
+
+int tle_tree_close( tle_tree_t *tree)
+{
+   int rval = 0, i;
+
+   if( tree->changed)
+      {
+      char temp_name[255];
+      FILE *ofile;
+
+      snprintf( temp_name, sizeof( temp_name), "%s.tmp", tree->filename);
+      if( tree->n_entries)
+         qsort( tree->entries, tree->n_entries, sizeof( tle_tree_entry_t *),
+                                          compare_entries);
+      ofile = fopen( temp_name, "wb");
+      if( !ofile)
+         rval = -1;
+      else
+         {
+         rval = write_tree( tree, ofile);
+         if( fclose( ofile))
+            rval = -1;
+         if( !rval && rename( temp_name, tree->filename))
+            {        /* Windows won't rename over an existing file */
+            remove( tree->filename);
+            rval = rename( temp_name, tree->filename);
+            }
+         if( rval)
+            remove( temp_name);
+         }
+      }
+   for( i = 0; i < tree->n_entries; i++)
+      free_entry( tree->entries[i]);
+   free( tree->entries);
+   free( tree->filename);
+   free( tree);
+   return( rval);
+}
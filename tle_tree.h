@@ -0,0 +1,58 @@
+/* Copyright (C) 2018, Project Pluto.  See LICENSE.  */
+
+#ifndef TLE_TREE_H_INCLUDED
+#define TLE_TREE_H_INCLUDED
+
+/* Persistent index of the TLE files in a 'tle_list.txt' include tree;
+see 'tle_tree.c'.  Times are MJDs.  */
+
+#include <stdint.h>
+
+typedef struct
+{
+   double mjd;                /* from a '# MJD' line */
+   int64_t offset;            /* of that line within the (uncompressed) file */
+} tle_tree_block_t;
+
+typedef struct
+{
+   char *filename;            /* normalized;  see tle_tree.c */
+   int64_t mtime, size;       /* of the file when indexed;  mtime in ns */
+   int is_gz;                 /* 1 if it's 'filename.gz' that was read */
+   int n_tles, n_ids, n_blocks;
+   int flags;                 /* TLE_TREE_xxx bits,  below */
+   double ephem_start, ephem_end, ephem_step;   /* all zero if no range */
+   double max_error;          /* zero if there's no '# Max error' line */
+   int *ids;                  /* distinct NORAD numbers,  in file order */
+   tle_tree_block_t *blocks;
+   char *header;              /* NULL if there's no usable header */
+   size_t header_size;
+} tle_tree_entry_t;
+
+typedef struct tle_tree tle_tree_t;
+
+      /* '# MJD' lines are in increasing order : */
+#define TLE_TREE_SORTED_BLOCKS      1
+      /* '# Ephem range:' comes before any '# MJD' line : */
+#define TLE_TREE_RANGE_FIRST        2
+      /* there are no TLEs before the first '# MJD' line : */
+#define TLE_TREE_TLES_IN_BLOCKS     4
+      /* some '#' lines have magnitudes (' H ') in them : */
+#define TLE_TREE_H_LINES            8
+      /* the file has '# Include' lines : */
+#define TLE_TREE_HAS_INCLUDES      16
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+tle_tree_t *tle_tree_open( const char *index_filename);
+const tle_tree_entry_t *tle_tree_find( tle_tree_t *tree, const char *filename);
+int tle_tree_first_block( const tle_tree_entry_t *entry, const double offset,
+                              const double step, const double limit);
+int tle_tree_close( tle_tree_t *tree);
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+#endif  /* #ifndef TLE_TREE_H_INCLUDED */
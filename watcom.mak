@@ -19,8 +19,8 @@ obs_tes2.exe: obs_tes2.obj wsatlib.lib
 
 WAT_LIB=../watlib
 
-sat_id.exe: sat_id.obj sat_util.obj wsatlib.lib $(WAT_LIB)/wafuncs.lib
-   wcl386 -zq -k10000 sat_id.obj sat_util.obj wsatlib.lib $(WAT_LIB)/wafuncs.lib
+sat_id.exe: sat_id.obj sat_util.obj gz_pipe.obj tle_tree.obj wsatlib.lib $(WAT_LIB)/wafuncs.lib
+   wcl386 -zq -k10000 sat_id.obj sat_util.obj gz_pipe.obj tle_tree.obj wsatlib.lib $(WAT_LIB)/wafuncs.lib
 
 test_out.exe: test_out.obj wsatlib.lib
    wcl386 -zq -k10000 test_out.obj wsatlib.lib
@@ -29,10 +29,12 @@ test_out.exe: test_out.obj wsatlib.lib
 CFLAGS=-W4 -Ox -j -zq -i=..\include
 
 wsatlib.lib: sgp.obj sgp4.obj sgp8.obj sdp4.obj sdp8.obj deep.obj &
-     basics.obj get_el.obj observe.obj common.obj tle_out.obj
+     basics.obj get_el.obj observe.obj common.obj tle_out.obj lun_sol.obj &
+     cheb_eph.obj sat_cat.obj tle_idx.obj
    wlib -q wsatlib.lib  +sgp.obj +sgp4.obj +sgp8.obj +sdp4.obj +sdp8.obj
    wlib -q wsatlib.lib  +deep.obj +basics.obj +get_el.obj +observe.obj
-   wlib -q wsatlib.lib  +common.obj +tle_out.obj
+   wlib -q wsatlib.lib  +common.obj +tle_out.obj +lun_sol.obj +cheb_eph.obj
+   wlib -q wsatlib.lib  +sat_cat.obj +tle_idx.obj
 
 .cpp.obj:
    wcc386 $(CFLAGS) $<
@@ -58,6 +60,10 @@ sat_id.obj:
 
 sat_util.obj:
 
+gz_pipe.obj:
+
+tle_tree.obj:
+
 tle_out.obj:
 
 test_sat.obj:
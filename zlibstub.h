@@ -2,3 +2,4 @@
 #define gzopen fopen
 #define gzgets( ifile, buff, buffsize)    fgets( buff, buffsize, ifile)
 #define gzclose fclose
+#define gzseek( ifile, offset, whence)  (fseek( ifile, offset, whence) ? -1L : ftell( ifile))